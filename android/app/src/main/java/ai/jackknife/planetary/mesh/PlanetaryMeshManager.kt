@@ -73,6 +73,7 @@ class PlanetaryMeshManager(
     // Message counter for throughput tracking
     private var messageCount = 0
     private var lastStatUpdate = System.currentTimeMillis()
+    private var txSeqNum = 0
 
     /**
      * Initialize the mesh manager
@@ -259,10 +260,11 @@ class PlanetaryMeshManager(
     // -------------------------------------------------------------------------
 
     private fun sendVendorMessage(opcode: Byte, data: ByteArray) {
+        val params = GossipHeader.encode(txSeqNum++ and 0xFF, body = data)
         // TODO: Use Nordic mesh API
-        // val message = VendorModelMessage(VendorIds.MODEL_ID, VendorIds.COMPANY_ID, opcode, data)
+        // val message = VendorModelMessage(VendorIds.MODEL_ID, VendorIds.COMPANY_ID, opcode, params)
         // meshManagerApi.createMeshPdu(0xFFFF, message)
-        Log.d(TAG, "Sending vendor message: opcode=0x${opcode.toString(16)}, size=${data.size}")
+        Log.d(TAG, "Sending vendor message: opcode=0x${opcode.toString(16)}, size=${params.size}")
     }
 
     private fun updateStats() {
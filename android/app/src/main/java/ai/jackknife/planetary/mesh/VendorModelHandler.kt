@@ -18,7 +18,7 @@ import java.nio.ByteOrder
  * Opcodes matching mesh_gossip.h GossipOpcode enum
  */
 object PlanetaryOpcodes {
-    const val WEIGHT_UPDATE: Byte = 0xC0.toByte()
+    const val WEIGHT_UPDATE: Byte = 0xC0.toByte()  // Reserved by the firmware (shard > MTU)
     const val WEIGHT_REQUEST: Byte = 0xC1.toByte()
     const val HEARTBEAT: Byte = 0xC2.toByte()
     const val BACKPRESSURE: Byte = 0xC3.toByte()
@@ -34,6 +34,17 @@ object VendorIds {
     const val MODEL_ID: Int = 0x0211
 }
 
+/**
+ * Leading parameters of every message (gossip_codec.h GossipHeader):
+ * [seq_num][flags]. TTL and source travel in the network PDU.
+ */
+object GossipHeader {
+    const val SIZE: Int = 2
+
+    fun encode(seqNum: Int, flags: Int = 0, body: ByteArray): ByteArray =
+        byteArrayOf(seqNum.toByte(), flags.toByte()) + body
+}
+
 /**
  * Heartbeat payload from a neuron node
  */
@@ -81,7 +92,9 @@ class VendorModelHandler(
      */
     fun handleMessage(message: VendorModelMessageStatus): Boolean {
         val opCode = message.opCode
-        val params = message.parameters ?: return false
+        val raw = message.parameters ?: return false
+        if (raw.size < GossipHeader.SIZE) return false
+        val params = raw.copyOfRange(GossipHeader.SIZE, raw.size)
         val srcAddress = message.src
 
         Log.d(TAG, "Received opcode: 0x${opCode.toString(16)} from 0x${srcAddress.toString(16)}")
@@ -13,6 +13,7 @@ __author__ = 'JackKnife AI / Claudia / Claude'
 from .ble_mesh import PlanetaryMeshClient, NeuronDevice, MeshNode
 from .vendor_model import (
     GossipOpcode, GossipHeader, HeartbeatPayload,
-    ShardHeader, FragmentInfo, compute_crc16
+    ShardHeader, FragmentInfo, DeltaInfo, NackInfo, StatsRequest,
+    StatsPayload, compute_crc16
 )
 from .training_monitor import TrainingMonitor
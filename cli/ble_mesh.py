@@ -10,7 +10,7 @@ using the bleak library for cross-platform BLE support.
 import asyncio
 import struct
 from dataclasses import dataclass, field
-from typing import Optional, List, Dict, Callable, Any
+from typing import Optional, List, Dict, Callable, Any, BinaryIO
 from enum import IntEnum
 from bleak import BleakScanner, BleakClient
 from bleak.backends.device import BLEDevice
@@ -18,7 +18,8 @@ from bleak.backends.characteristic import BleakGATTCharacteristic
 
 from vendor_model import (
     GossipOpcode, GossipHeader, HeartbeatPayload, ShardHeader,
-    FragmentInfo, parse_message, COMPANY_ID, VENDOR_MODEL_ID
+    FragmentInfo, ShardRequest, StatsRequest, parse_message, encode_message,
+    encode_tap_record, COMPANY_ID, VENDOR_MODEL_ID, VENDOR_OPCODE_SIZE
 )
 
 
@@ -74,6 +75,9 @@ class MeshNode:
     neighbors: int = 0
     last_seen: float = 0.0
     rssi: int = 0
+    held_shards: List[int] = field(default_factory=list)  # Shards it can serve
+    resident: Dict[int, int] = field(default_factory=dict)  # Shard ID -> version, in RAM
+    temp_c: int = 0  # Filtered die temperature
 
     def is_healthy(self) -> bool:
         return self.load_percent < 80
@@ -94,9 +98,11 @@ class PlanetaryMeshClient:
         self.client: Optional[BleakClient] = None
         self.connected_device: Optional[NeuronDevice] = None
         self.nodes: Dict[int, MeshNode] = {}
+        self.profiles: Dict[int, dict] = {}  # Latest STATS reply per node
         self.message_handlers: List[Callable[[dict], None]] = []
         self._rx_buffer: bytes = b''
         self._seq_num: int = 0
+        self.tap: Optional[BinaryIO] = None  # Tap stream for planetary-gateway
 
     async def scan(self, timeout: float = 5.0) -> List[NeuronDevice]:
         """
@@ -181,25 +187,18 @@ class PlanetaryMeshClient:
         Send a vendor model message to the mesh.
 
         Args:
-            opcode: Vendor opcode (0xC0-0xC5)
+            opcode: Vendor opcode (0xC0-0xC9)
             payload: Message payload
             dst_addr: Destination address (0xFFFF for broadcast)
         """
         if not self.is_connected():
             return False
 
-        # Build vendor model message
-        header = GossipHeader(
-            opcode=opcode,
-            ttl=3,
-            src_addr=0x0001,  # Proxy uses provisioner address
-            seq_num=self._seq_num & 0xFF,
-            flags=0
-        )
+        # Build vendor model access payload; TTL and source (the
+        # provisioner address) go in the network header
+        message = encode_message(opcode, payload, seq_num=self._seq_num & 0xFF)
         self._seq_num += 1
 
-        message = header.pack() + payload
-
         # Wrap in mesh proxy PDU
         proxy_pdu = self._build_proxy_pdu(message, dst_addr)
 
@@ -275,17 +274,88 @@ class PlanetaryMeshClient:
             print(f"OnOff failed: {e}")
             return False
 
+    async def send_scene(self, scene: int, store: bool = False, transition_ms: int = 0,
+                         dst_addr: int = 0xFFFF) -> bool:
+        """
+        Send Scene Store or Scene Recall. Sent to a group address, one
+        recall moves every subscribed bulb along the same transition.
+
+        Args:
+            scene: Scene number 1-65535
+            store: Store the current target instead of recalling
+            transition_ms: Recall transition time
+            dst_addr: Destination (0xFFFF for all)
+        """
+        if not self.is_connected() or not 0 < scene <= 0xFFFF:
+            return False
+
+        if store:
+            # Scene Store Unacknowledged (0x8247)
+            message = struct.pack('<H', scene)
+            opcode_bytes = struct.pack('<H', 0x8247)
+        else:
+            # Scene Recall Unacknowledged (0x8243)
+            trans_steps = min(transition_ms // 100, 62)
+            message = struct.pack('<HBBB',
+                scene,
+                0,            # TID
+                trans_steps,  # 100ms resolution
+                0             # Delay
+            )
+            opcode_bytes = struct.pack('<H', 0x8243)
+        full_message = opcode_bytes + message
+
+        proxy_pdu = self._build_proxy_pdu(full_message, dst_addr)
+
+        try:
+            await self.client.write_gatt_char(MESH_PROXY_DATA_IN, proxy_pdu)
+            return True
+        except Exception as e:
+            print(f"Scene failed: {e}")
+            return False
+
     async def request_heartbeats(self) -> bool:
         """Request heartbeat from all nodes."""
         return await self.send_vendor_message(GossipOpcode.HEARTBEAT)
 
-    async def request_shard(self, shard_id: int) -> bool:
-        """Request a specific weight shard."""
+    def best_holder(self, shard_id: int) -> Optional[int]:
+        """Node to ask for a shard, as the firmware picks: in RAM, least load, best RSSI."""
+        holders = [n for n in self.nodes.values() if shard_id in n.held_shards]
+        if not holders:
+            return None
+        best = min(holders, key=lambda n: (shard_id not in n.resident, n.load_percent, -n.rssi))
+        return best.address
+
+    async def request_shard(self, shard_id: int, dst_addr: Optional[int] = None) -> bool:
+        """
+        Request a specific weight shard.
+
+        Unicast to dst_addr, else to the best holder seen in heartbeats; with
+        no known holder the request is broadcast and only nodes with the
+        shard in RAM answer.
+        """
+        if dst_addr is None:
+            dst_addr = self.best_holder(shard_id)
+        if dst_addr is None:
+            dst_addr = 0xFFFF
         return await self.send_vendor_message(
             GossipOpcode.WEIGHT_REQUEST,
-            bytes([shard_id])
+            ShardRequest(shard_id, dst_addr).pack(),
+            dst_addr
+        )
+
+    async def request_stats(self, dst_addr: int = 0xFFFF, reset: bool = False) -> bool:
+        """Request trace profiles (one node, or 0xFFFF for all)."""
+        return await self.send_vendor_message(
+            GossipOpcode.STATS,
+            StatsRequest(dst_addr, reset).pack(),
+            dst_addr
         )
 
+    def get_profiles(self) -> Dict[int, dict]:
+        """Latest STATS reply per node address."""
+        return dict(self.profiles)
+
     async def send_backpressure(self) -> bool:
         """Send backpressure signal to slow down mesh."""
         return await self.send_vendor_message(GossipOpcode.BACKPRESSURE)
@@ -391,8 +461,12 @@ class PlanetaryMeshClient:
             # Look for vendor model messages in the payload
             payload = data[9:]  # Skip network header
 
-            if len(payload) >= GossipHeader.SIZE:
-                parsed = parse_message(payload)
+            if len(payload) >= VENDOR_OPCODE_SIZE + GossipHeader.SIZE:
+                if self.tap is not None:
+                    self.tap.write(encode_tap_record(src_addr, payload))
+                    self.tap.flush()
+
+                parsed = parse_message(payload, src_addr)
 
                 # Update node tracking
                 if 'heartbeat' in parsed:
@@ -404,9 +478,15 @@ class PlanetaryMeshClient:
                         shards_held=hb['shards_held'],
                         epoch=hb['epoch'],
                         neighbors=hb['neighbors'],
-                        last_seen=time.time()
+                        last_seen=time.time(),
+                        held_shards=hb['held_shards'],
+                        resident=hb['resident'],
+                        temp_c=hb['temp_c']
                     )
 
+                if 'stats' in parsed:
+                    self.profiles[src_addr] = parsed['stats']
+
                 # Notify handlers
                 for handler in self.message_handlers:
                     try:
@@ -11,6 +11,7 @@ Usage:
     python planetary_cli.py light on      # Turn on lights
     python planetary_cli.py train status  # Show training status
     python planetary_cli.py mesh nodes    # List mesh nodes
+    python planetary_cli.py mesh profile  # Pull hot-path profiles
 
 π×φ = 5.083203692315260 | PHOENIX-TESLA-369-AURORA
 """
@@ -304,6 +305,46 @@ def light_set(brightness: int, temp: int):
     ctx.invoke(light_on, brightness=brightness, temp=temp, transition=500, address='0xFFFF')
 
 
+@light.command('scene')
+@click.argument('scene', type=int)
+@click.option('--store', is_flag=True, help='Store the current state as this scene')
+@click.option('--transition', '-tr', default=500, help='Recall transition time (ms)')
+@click.option('--address', '-a', default='0xFFFF', help='Target address or group (hex)')
+def light_scene(scene: int, store: bool, transition: int, address: str):
+    """Store or recall a scene.
+
+    \b
+    SCENE: 1-65535
+    """
+
+    async def do_scene():
+        client = get_client()
+
+        if not client.is_connected():
+            state = load_state()
+            if 'last_device' in state:
+                devices = await client.scan(timeout=3.0)
+                device = next((d for d in devices if d.address == state['last_device']), None)
+                if device:
+                    await client.connect(device)
+
+        if not client.is_connected():
+            console.print("[red]Not connected[/red]")
+            return
+
+        dst = int(address, 16) if address.startswith('0x') else int(address)
+        action = "Storing" if store else "Recalling"
+
+        console.print(f"[cyan]{action} scene {scene}...[/cyan]")
+
+        if await client.send_scene(scene, store, transition, dst):
+            console.print("[green]✓ Scene command sent[/green]")
+        else:
+            console.print("[red]✗ Failed[/red]")
+
+    asyncio.run(do_scene())
+
+
 # ============================================================================
 # Train Commands
 # ============================================================================
@@ -466,6 +507,87 @@ def mesh_backpressure():
     asyncio.run(do_bp())
 
 
+@mesh.command('tap')
+@click.argument('output', type=click.Path(dir_okay=False, writable=True))
+def mesh_tap(output: str):
+    """Forward every vendor message heard to a planetary-gateway tap stream."""
+
+    async def do_tap():
+        client = get_client()
+
+        if not client.is_connected():
+            console.print("[red]Not connected[/red]")
+            return
+
+        with open(output, 'ab', buffering=0) as tap:
+            client.tap = tap
+            console.print(f"[cyan]Tapping vendor messages into {output} (Ctrl-C to stop)[/cyan]")
+            try:
+                while client.is_connected():
+                    await asyncio.sleep(1.0)
+            finally:
+                client.tap = None
+
+    try:
+        asyncio.run(do_tap())
+    except KeyboardInterrupt:
+        console.print("\n[yellow]Tap stopped[/yellow]")
+
+
+@mesh.command('profile')
+@click.option('--address', '-a', default='0xFFFF', help='Node address (default: all)')
+@click.option('--reset', is_flag=True, help='Clear node histograms after reading')
+@click.option('--wait', default=2.0, help='Seconds to collect replies')
+@click.option('--json', 'as_json', is_flag=True, help='Output as JSON')
+def mesh_profile(address: str, reset: bool, wait: float, as_json: bool):
+    """Pull hot-path latency and duty-cycle profiles from nodes."""
+
+    async def do_profile():
+        client = get_client()
+
+        if not client.is_connected():
+            console.print("[red]Not connected[/red]")
+            return
+
+        dst = int(address, 0)
+        await client.request_stats(dst, reset)
+        await asyncio.sleep(wait)
+
+        profiles = client.get_profiles()
+        if dst != 0xFFFF:
+            profiles = {a: p for a, p in profiles.items() if a == dst}
+
+        if as_json:
+            output = {f'0x{a:04X}': p for a, p in profiles.items()}
+            click.echo(json.dumps(output, indent=2))
+            return
+
+        if not profiles:
+            console.print("[yellow]No STATS replies received[/yellow]")
+            return
+
+        for addr, prof in sorted(profiles.items()):
+            duty = ' '.join(f'{d}%' for d in prof['task_duty'])
+            table = Table(
+                title=f"Node 0x{addr:04X}  AI duty {prof['ai_duty']}%  tasks [{duty}]",
+                box=box.SIMPLE
+            )
+            table.add_column("Point", style="cyan")
+            table.add_column("Count", justify="right")
+            table.add_column("Avg µs", justify="right")
+            table.add_column("p99 µs", justify="right")
+            table.add_column("Max µs", justify="right")
+
+            for name, p in prof['points'].items():
+                if p['count'] == 0:
+                    continue
+                table.add_row(name, str(p['count']), str(p['avg_us']),
+                              f"<{p['p99_us']}", str(p['max_us']))
+            console.print(table)
+
+    asyncio.run(do_profile())
+
+
 # ============================================================================
 # Shard Commands
 # ============================================================================
@@ -478,7 +600,8 @@ def shard():
 
 @shard.command('request')
 @click.argument('shard_id', type=int)
-def shard_request(shard_id: int):
+@click.option('--address', '-a', default=None, help='Holder address (hex, default: best holder)')
+def shard_request(shard_id: int, address: Optional[str]):
     """Request a specific weight shard from the mesh."""
 
     async def do_request():
@@ -493,7 +616,10 @@ def shard_request(shard_id: int):
             return
 
         console.print(f"[cyan]Requesting shard {shard_id}...[/cyan]")
-        if await client.request_shard(shard_id):
+        dst = None
+        if address:
+            dst = int(address, 16) if address.startswith('0x') else int(address)
+        if await client.request_shard(shard_id, dst):
             console.print(f"[green]✓ Requested shard {shard_id}[/green]")
         else:
             console.print("[red]✗ Failed[/red]")
@@ -530,12 +656,16 @@ def info():
   Model ID:   0x0211
 
 [bold]Opcodes:[/bold]
-  WEIGHT_UPDATE   = 0xC0
+  WEIGHT_UPDATE   = 0xC0  (reserved)
   WEIGHT_REQUEST  = 0xC1
   HEARTBEAT       = 0xC2
   BACKPRESSURE    = 0xC3
   SHARD_FRAGMENT  = 0xC4
   ACK             = 0xC5
+  WEIGHT_DELTA    = 0xC6
+  NACK            = 0xC7
+  STATS           = 0xC8
+  LEASE           = 0xC9
 
 [bold]Architecture:[/bold]
   Shards:     64 × 4KB = 256KB model
@@ -8,20 +8,24 @@ matching the C++ firmware (mesh_gossip.h) and Android app.
 """
 
 import struct
-from dataclasses import dataclass
+from dataclasses import dataclass, field
 from enum import IntEnum
-from typing import Optional, List
+from typing import Optional, List, Dict
 import zlib
 
 
 class GossipOpcode(IntEnum):
     """Opcodes matching mesh_gossip.h"""
-    WEIGHT_UPDATE = 0xC0
+    WEIGHT_UPDATE = 0xC0  # Reserved: a whole shard exceeds the MTU
     WEIGHT_REQUEST = 0xC1
     HEARTBEAT = 0xC2
     BACKPRESSURE = 0xC3
     SHARD_FRAGMENT = 0xC4
     ACK = 0xC5
+    WEIGHT_DELTA = 0xC6
+    NACK = 0xC7
+    STATS = 0xC8
+    LEASE = 0xC9
 
 
 class LightOpcode(IntEnum):
@@ -32,6 +36,10 @@ class LightOpcode(IntEnum):
     LIGHT_CTL_STATUS = 0x8264
     ONOFF_SET = 0x8202
     ONOFF_SET_UNACK = 0x8203
+    SCENE_RECALL = 0x8242
+    SCENE_RECALL_UNACK = 0x8243
+    SCENE_STORE = 0x8246
+    SCENE_STORE_UNACK = 0x8247
 
 
 # Telink Vendor IDs
@@ -39,34 +47,53 @@ COMPANY_ID = 0x0211  # Telink
 VENDOR_MODEL_ID = 0x0211
 
 
+# Every vendor message starts with the 3-byte access opcode (gossip_codec.h)
+VENDOR_OPCODE_SIZE = 3
+
+
+def vendor_opcode(opcode: int) -> bytes:
+    """Access-layer vendor opcode: opcode byte, then the company ID (LE)"""
+    return struct.pack('<BH', opcode, COMPANY_ID)
+
+
 @dataclass
 class GossipHeader:
-    """Message header for vendor model messages"""
-    opcode: int
-    ttl: int
-    src_addr: int
+    """Leading parameters of every vendor model message.
+
+    TTL and source address travel in the network PDU, not here.
+    """
     seq_num: int
     flags: int
 
-    FORMAT = '<BBHBB'  # Little-endian: u8, u8, u16, u8, u8
+    FORMAT = '<BB'  # u8 seq_num, u8 flags
     SIZE = struct.calcsize(FORMAT)
 
     def pack(self) -> bytes:
-        return struct.pack(
-            self.FORMAT,
-            self.opcode,
-            self.ttl,
-            self.src_addr,
-            self.seq_num,
-            self.flags
-        )
+        return struct.pack(self.FORMAT, self.seq_num, self.flags)
 
     @classmethod
     def unpack(cls, data: bytes) -> 'GossipHeader':
         if len(data) < cls.SIZE:
             raise ValueError(f"Data too short: {len(data)} < {cls.SIZE}")
-        opcode, ttl, src_addr, seq_num, flags = struct.unpack(cls.FORMAT, data[:cls.SIZE])
-        return cls(opcode, ttl, src_addr, seq_num, flags)
+        return cls(*struct.unpack(cls.FORMAT, data[:cls.SIZE]))
+
+
+def encode_message(opcode: int, payload: bytes = b'', seq_num: int = 0, flags: int = 0) -> bytes:
+    """Access payload of a vendor message: opcode, GossipHeader, body"""
+    return vendor_opcode(opcode) + GossipHeader(seq_num, flags).pack() + payload
+
+
+# Tap stream record for planetary-gateway (gateway/tap_stream.h):
+# [u16 length][u16 src][u16 dst][u8 ttl][access payload]
+TAP_RECORD_FORMAT = '<HHHB'
+TAP_FIXED_SIZE = struct.calcsize(TAP_RECORD_FORMAT) - 2
+
+
+def encode_tap_record(src_addr: int, access_payload: bytes, dst_addr: int = 0xFFFF,
+                      ttl: int = 0) -> bytes:
+    """Frame one heard vendor message for the gateway"""
+    return struct.pack(TAP_RECORD_FORMAT, TAP_FIXED_SIZE + len(access_payload),
+                       src_addr, dst_addr, ttl) + access_payload
 
 
 @dataclass
@@ -77,25 +104,56 @@ class HeartbeatPayload:
     epoch: int
     neighbors: int
     source_addr: int = 0
-
-    FORMAT = '<BBHB3x'  # u8, u8, u16, u8, 3 reserved
+    tx_backlog: int = 0  # Shard fragments still queued on the node
+    ble_guard_us: int = 0  # Adaptive BLE guard band (32us resolution)
+    ble_overruns: int = 0  # BLE events touched since the last heartbeat
+    cluster_head: int = 0xFFFF  # Head it aggregates through (own addr if head), 0xFFFF flooding
+    held_shards: int = 0  # Bit per shard it can serve (RAM or flash)
+    resident: Dict[int, int] = field(default_factory=dict)  # Shard ID -> version, in RAM
+    temp_c: int = 0  # Filtered die temperature
+    temp_ahead_c: int = 0  # Governor's prediction a few seconds ahead
+    offer_shard: int = 0xFF  # Resident shard up for lease, 0xFF none
+
+    RESIDENT_SLOTS = 6  # HEARTBEAT_RESIDENT_SLOTS
+    FORMAT = '<BBHBBBBHQ' + 'BB' * RESIDENT_SLOTS + 'BBB'  # ..., (id, version)*6, temp, ahead, offer
     SIZE = struct.calcsize(FORMAT)
+    NO_SHARD_ID = 0xFF
+
+    def holds(self, shard_id: int) -> bool:
+        return bool(self.held_shards >> shard_id & 1)
 
     def pack(self) -> bytes:
+        resident = list(self.resident.items())[:self.RESIDENT_SLOTS]
+        resident += [(self.NO_SHARD_ID, 0)] * (self.RESIDENT_SLOTS - len(resident))
         return struct.pack(
             self.FORMAT,
             self.load_percent,
             self.shards_held,
             self.epoch,
-            self.neighbors
+            self.neighbors,
+            self.tx_backlog,
+            min(self.ble_guard_us // 32, 255),
+            self.ble_overruns,
+            self.cluster_head,
+            self.held_shards,
+            *[b for pair in resident for b in pair],
+            self.temp_c,
+            self.temp_ahead_c,
+            self.offer_shard
         )
 
     @classmethod
     def unpack(cls, data: bytes, src_addr: int = 0) -> 'HeartbeatPayload':
         if len(data) < cls.SIZE:
             raise ValueError(f"Data too short for heartbeat: {len(data)}")
-        load, shards, epoch, neighbors = struct.unpack('<BBHB', data[:5])
-        return cls(load, shards, epoch, neighbors, src_addr)
+        fields = struct.unpack(cls.FORMAT, data[:cls.SIZE])
+        load, shards, epoch, neighbors, backlog, guard, overruns, head, held = fields[:9]
+        pairs = fields[9:-3]
+        temp, ahead, offer = fields[-3:]
+        resident = {pairs[i]: pairs[i + 1] for i in range(0, len(pairs), 2)
+                    if pairs[i] != cls.NO_SHARD_ID}
+        return cls(load, shards, epoch, neighbors, src_addr, backlog, guard * 32, overruns, head,
+                   held, resident, temp, ahead, offer)
 
 
 @dataclass
@@ -107,7 +165,7 @@ class ShardHeader:
     global_epoch: int
     contributors: int
 
-    FORMAT = '<BBHIB3x'  # u8, u8, u16, u32, u8, 3 reserved
+    FORMAT = '<BBHIH2x'  # u8, u8, u16, u32, u16 contributors, 2 reserved
     SIZE = struct.calcsize(FORMAT)
 
     def pack(self) -> bytes:
@@ -125,7 +183,7 @@ class ShardHeader:
         if len(data) < cls.SIZE:
             raise ValueError(f"Data too short for shard header: {len(data)}")
         shard_id, version, checksum, epoch, contributors = struct.unpack(
-            '<BBHIB', data[:9]
+            '<BBHIH', data[:10]
         )
         return cls(shard_id, version, checksum, epoch, contributors)
 
@@ -136,8 +194,9 @@ class FragmentInfo:
     shard_id: int
     fragment_idx: int
     total_fragments: int
+    content_tag: int = 0  # Low byte of the sender's shard checksum
 
-    FORMAT = '<BBBx'  # u8, u8, u8, 1 reserved
+    FORMAT = '<BBBB'  # u8 x4
     SIZE = struct.calcsize(FORMAT)
 
     def pack(self) -> bytes:
@@ -145,15 +204,190 @@ class FragmentInfo:
             self.FORMAT,
             self.shard_id,
             self.fragment_idx,
-            self.total_fragments
+            self.total_fragments,
+            self.content_tag
         )
 
     @classmethod
     def unpack(cls, data: bytes) -> 'FragmentInfo':
         if len(data) < cls.SIZE:
             raise ValueError(f"Data too short for fragment info: {len(data)}")
-        shard_id, frag_idx, total = struct.unpack('<BBB', data[:3])
-        return cls(shard_id, frag_idx, total)
+        return cls(*struct.unpack(cls.FORMAT, data[:cls.SIZE]))
+
+
+@dataclass
+class NackInfo:
+    """Missing fragments of a stalled shard reassembly"""
+    target_addr: int
+    shard_id: int
+    content_tag: int
+    missing: int
+
+    FORMAT = '<HBBH'  # u16 target, u8, u8, u16 missing-fragment bitmap
+    SIZE = struct.calcsize(FORMAT)
+
+    def pack(self) -> bytes:
+        return struct.pack(
+            self.FORMAT,
+            self.target_addr,
+            self.shard_id,
+            self.content_tag,
+            self.missing
+        )
+
+    @classmethod
+    def unpack(cls, data: bytes) -> 'NackInfo':
+        if len(data) < cls.SIZE:
+            raise ValueError(f"Data too short for NACK: {len(data)}")
+        return cls(*struct.unpack(cls.FORMAT, data[:cls.SIZE]))
+
+
+class LeaseOp(IntEnum):
+    """LeaseInfo.op"""
+    CLAIM = 0
+    GRANT = 1
+    RETURN = 2
+
+
+@dataclass
+class LeaseInfo:
+    """LEASE: claim, grant or return the training of one shard (unicast)"""
+    target_addr: int
+    shard_id: int
+    op: int
+
+    FORMAT = '<HBB'  # u16 target, u8 shard, u8 LeaseOp
+    SIZE = struct.calcsize(FORMAT)
+
+    def pack(self) -> bytes:
+        return struct.pack(self.FORMAT, self.target_addr, self.shard_id, self.op)
+
+    @classmethod
+    def unpack(cls, data: bytes) -> 'LeaseInfo':
+        if len(data) < cls.SIZE:
+            raise ValueError(f"Data too short for LEASE: {len(data)}")
+        return cls(*struct.unpack(cls.FORMAT, data[:cls.SIZE]))
+
+
+@dataclass
+class ShardRequest:
+    """WEIGHT_REQUEST: ask one holder (or 0xFFFF for any node with it in RAM)"""
+    shard_id: int
+    target_addr: int = 0xFFFF
+
+    FORMAT = '<HB'  # u16 target, u8 shard
+    SIZE = struct.calcsize(FORMAT)
+
+    def pack(self) -> bytes:
+        return struct.pack(self.FORMAT, self.target_addr, self.shard_id)
+
+
+@dataclass
+class StatsRequest:
+    """Ask one node (or 0xFFFF for all) for its trace profile"""
+    target_addr: int = 0xFFFF
+    reset: bool = False  # Clear the node's histograms after it replies
+
+    FORMAT = '<HB'  # u16 target, u8 flags
+    SIZE = struct.calcsize(FORMAT)
+    FLAG_RESET = 0x01
+
+    def pack(self) -> bytes:
+        return struct.pack(self.FORMAT, self.target_addr,
+                           self.FLAG_RESET if self.reset else 0)
+
+
+# Trace points in firmware order (TracePoint in trace.h)
+TRACE_POINTS = [
+    'forward', 'backward', 'apply', 'crc',
+    'fedavg', 'flash_erase', 'flash_write', 'fragment'
+]
+TRACE_BUCKETS = 12  # log2(us): <2, [2,4), ... [1024,2048), >=2048
+TRACE_MAX_TASKS = 8
+
+
+@dataclass
+class StatsPayload:
+    """STATS reply: duty cycle and per-point latency histograms"""
+    ai_duty: int
+    task_duty: List[int]
+    points: Dict[str, dict]
+
+    HEADER_FORMAT = f'<BBBx{TRACE_MAX_TASKS}B'  # duty, tasks, points, reserved, per-task duty
+    POINT_FORMAT = f'<HHH{TRACE_BUCKETS}H'      # count, avg, max, histogram
+    HEADER_SIZE = struct.calcsize(HEADER_FORMAT)
+    POINT_SIZE = struct.calcsize(POINT_FORMAT)
+    SIZE = HEADER_SIZE + len(TRACE_POINTS) * POINT_SIZE
+
+    @staticmethod
+    def percentile_us(hist: List[int], pct: float) -> int:
+        """Upper edge of the log2 bucket holding the given percentile"""
+        total = sum(hist)
+        if total == 0:
+            return 0
+        seen = 0
+        for b, n in enumerate(hist):
+            seen += n
+            if seen * 100 >= total * pct:
+                return 2 << b
+        return 2 << (len(hist) - 1)
+
+    @classmethod
+    def unpack(cls, data: bytes) -> 'StatsPayload':
+        if len(data) < cls.SIZE:
+            raise ValueError(f"Data too short for stats: {len(data)}")
+        fields = struct.unpack(cls.HEADER_FORMAT, data[:cls.HEADER_SIZE])
+        ai_duty, task_count, point_count = fields[:3]
+        task_duty = list(fields[3:3 + min(task_count, TRACE_MAX_TASKS)])
+
+        points = {}
+        offset = cls.HEADER_SIZE
+        for name in TRACE_POINTS[:point_count]:
+            values = struct.unpack(cls.POINT_FORMAT, data[offset:offset + cls.POINT_SIZE])
+            offset += cls.POINT_SIZE
+            hist = list(values[3:])
+            points[name] = {
+                'count': values[0],
+                'avg_us': values[1],
+                'max_us': values[2],
+                'p99_us': cls.percentile_us(hist, 99),
+                'hist': hist
+            }
+        return cls(ai_duty, task_duty, points)
+
+
+@dataclass
+class DeltaInfo:
+    """Sparse weight delta block info (followed by bitmap + values)"""
+    shard_id: int
+    base_version: int
+    version: int
+    block_idx: int
+    contributors: int
+    blocks: int          # Every block of this delta, a bit per block_idx
+    crc: int
+
+    FORMAT = '<BBBBHHH'  # u8 x4, u16 contributors, u16 blocks, u16 CRC over bitmap + values
+    SIZE = struct.calcsize(FORMAT)
+    BITMAP_SIZE = 32     # 256 weights per block
+
+    def pack(self) -> bytes:
+        return struct.pack(
+            self.FORMAT,
+            self.shard_id,
+            self.base_version,
+            self.version,
+            self.block_idx,
+            self.contributors,
+            self.blocks,
+            self.crc
+        )
+
+    @classmethod
+    def unpack(cls, data: bytes) -> 'DeltaInfo':
+        if len(data) < cls.SIZE:
+            raise ValueError(f"Data too short for delta info: {len(data)}")
+        return cls(*struct.unpack(cls.FORMAT, data[:cls.SIZE]))
 
 
 def compute_crc16(data: bytes) -> int:
@@ -171,38 +405,22 @@ def compute_crc16(data: bytes) -> int:
 
 def create_heartbeat_request() -> bytes:
     """Create a heartbeat request message"""
-    header = GossipHeader(
-        opcode=GossipOpcode.HEARTBEAT,
-        ttl=3,
-        src_addr=0x0001,  # Hub address
-        seq_num=0,
-        flags=0
-    )
-    return header.pack()
+    return encode_message(GossipOpcode.HEARTBEAT)
 
 
-def create_weight_request(shard_id: int) -> bytes:
-    """Create a weight request message"""
-    header = GossipHeader(
-        opcode=GossipOpcode.WEIGHT_REQUEST,
-        ttl=2,
-        src_addr=0x0001,
-        seq_num=0,
-        flags=0
-    )
-    return header.pack() + bytes([shard_id])
+def create_weight_request(shard_id: int, target_addr: int = 0xFFFF) -> bytes:
+    """Create a weight request message for one holder (0xFFFF: any with it in RAM)"""
+    return encode_message(GossipOpcode.WEIGHT_REQUEST, ShardRequest(shard_id, target_addr).pack())
 
 
 def create_backpressure() -> bytes:
     """Create a backpressure signal"""
-    header = GossipHeader(
-        opcode=GossipOpcode.BACKPRESSURE,
-        ttl=1,
-        src_addr=0x0001,
-        seq_num=0,
-        flags=0
-    )
-    return header.pack()
+    return encode_message(GossipOpcode.BACKPRESSURE)
+
+
+def create_stats_request(target_addr: int = 0xFFFF, reset: bool = False) -> bytes:
+    """Create a STATS (profile) request message"""
+    return encode_message(GossipOpcode.STATS, StatsRequest(target_addr, reset).pack())
 
 
 def create_light_ctl_set(brightness: int, color_temp: int, transition_ms: int = 0) -> bytes:
@@ -230,50 +448,96 @@ def create_light_ctl_set(brightness: int, color_temp: int, transition_ms: int =
     )
 
 
-def parse_message(data: bytes) -> dict:
-    """Parse an incoming vendor model message"""
-    if len(data) < GossipHeader.SIZE:
+def parse_message(data: bytes, src_addr: int = 0) -> dict:
+    """Parse an incoming vendor model access payload from network source src_addr"""
+    if len(data) < VENDOR_OPCODE_SIZE + GossipHeader.SIZE:
         return {'error': 'Message too short'}
 
-    header = GossipHeader.unpack(data)
-    payload = data[GossipHeader.SIZE:]
+    opcode, company = struct.unpack('<BH', data[:VENDOR_OPCODE_SIZE])
+    if company != COMPANY_ID:
+        return {'error': f'Not a vendor message for company 0x{COMPANY_ID:04X}'}
+
+    header = GossipHeader.unpack(data[VENDOR_OPCODE_SIZE:])
+    payload = data[VENDOR_OPCODE_SIZE + GossipHeader.SIZE:]
 
     result = {
-        'opcode': GossipOpcode(header.opcode).name if header.opcode in GossipOpcode._value2member_map_ else f'0x{header.opcode:02X}',
-        'ttl': header.ttl,
-        'src_addr': f'0x{header.src_addr:04X}',
+        'opcode': GossipOpcode(opcode).name if opcode in GossipOpcode._value2member_map_ else f'0x{opcode:02X}',
+        'src_addr': f'0x{src_addr:04X}',
         'seq_num': header.seq_num,
         'flags': header.flags
     }
 
     try:
-        if header.opcode == GossipOpcode.HEARTBEAT:
-            hb = HeartbeatPayload.unpack(payload, header.src_addr)
+        if opcode == GossipOpcode.HEARTBEAT:
+            hb = HeartbeatPayload.unpack(payload, src_addr)
             result['heartbeat'] = {
                 'load_percent': hb.load_percent,
                 'shards_held': hb.shards_held,
                 'epoch': hb.epoch,
-                'neighbors': hb.neighbors
+                'neighbors': hb.neighbors,
+                'tx_backlog': hb.tx_backlog,
+                'ble_guard_us': hb.ble_guard_us,
+                'ble_overruns': hb.ble_overruns,
+                'cluster_head': f'0x{hb.cluster_head:04X}',
+                'held_shards': [i for i in range(64) if hb.holds(i)],
+                'resident': hb.resident,
+                'temp_c': hb.temp_c,
+                'temp_ahead_c': hb.temp_ahead_c,
+                'offer_shard': None if hb.offer_shard == HeartbeatPayload.NO_SHARD_ID else hb.offer_shard
             }
-        elif header.opcode == GossipOpcode.SHARD_FRAGMENT:
+        elif opcode == GossipOpcode.SHARD_FRAGMENT:
             frag = FragmentInfo.unpack(payload)
             result['fragment'] = {
                 'shard_id': frag.shard_id,
                 'fragment_idx': frag.fragment_idx,
                 'total_fragments': frag.total_fragments,
+                'content_tag': frag.content_tag,
+                'retransmit': bool(header.flags & 0x01),
+                'reply': bool(header.flags & 0x02),
+                'packed': bool(header.flags & 0x04),
                 'data_size': len(payload) - FragmentInfo.SIZE
             }
-        elif header.opcode == GossipOpcode.WEIGHT_UPDATE:
-            if len(payload) >= ShardHeader.SIZE:
-                shard = ShardHeader.unpack(payload)
-                result['shard'] = {
-                    'shard_id': shard.shard_id,
-                    'version': shard.version,
-                    'checksum': f'0x{shard.checksum:04X}',
-                    'global_epoch': shard.global_epoch,
-                    'contributors': shard.contributors,
-                    'weight_bytes': len(payload) - ShardHeader.SIZE
+        elif opcode == GossipOpcode.NACK:
+            nack = NackInfo.unpack(payload)
+            result['nack'] = {
+                'target_addr': f'0x{nack.target_addr:04X}',
+                'shard_id': nack.shard_id,
+                'content_tag': nack.content_tag,
+                'delta': bool(header.flags & 0x08),
+                'missing': [i for i in range(16) if nack.missing & (1 << i)]
+            }
+        elif opcode == GossipOpcode.LEASE:
+            lease = LeaseInfo.unpack(payload)
+            result['lease'] = {
+                'target_addr': f'0x{lease.target_addr:04X}',
+                'shard_id': lease.shard_id,
+                'op': LeaseOp(lease.op).name if lease.op <= LeaseOp.RETURN else lease.op
+            }
+        elif opcode == GossipOpcode.WEIGHT_DELTA:
+            delta = DeltaInfo.unpack(payload)
+            body = payload[DeltaInfo.SIZE:]
+            result['delta'] = {
+                'shard_id': delta.shard_id,
+                'base_version': delta.base_version,
+                'version': delta.version,
+                'block_idx': delta.block_idx,
+                'contributors': delta.contributors,
+                'blocks': f'0x{delta.blocks:04X}',
+                'repair': bool(header.flags & 0x01),
+                'last': (delta.blocks >> delta.block_idx) == 1,
+                'changed_weights': max(len(body) - DeltaInfo.BITMAP_SIZE, 0),
+                'crc_ok': compute_crc16(body) == delta.crc
+            }
+        elif opcode == GossipOpcode.STATS:
+            if len(payload) >= StatsPayload.SIZE:
+                stats = StatsPayload.unpack(payload)
+                result['stats'] = {
+                    'ai_duty': stats.ai_duty,
+                    'task_duty': stats.task_duty,
+                    'points': stats.points
                 }
+            else:
+                result['stats_request'] = True
     except Exception as e:
         result['parse_error'] = str(e)
 
@@ -0,0 +1,594 @@
+/**
+ * Gateway Aggregator - see aggregator.h
+ */
+
+#include "aggregator.h"
+#include <chrono>
+
+namespace planetary {
+namespace gateway {
+
+namespace {
+
+constexpr uint16_t ALL_FRAGMENTS = MeshGossip::ALL_FRAGMENTS;
+constexpr size_t   FRAGMENT_SIZE = MeshGossip::FRAGMENT_SIZE;
+
+constexpr uint32_t peerKey(uint16_t src, uint8_t shard_id) {
+    return (static_cast<uint32_t>(src) << 8) | shard_id;
+}
+
+size_t blockWeights(uint8_t block) {
+    size_t first = static_cast<size_t>(block) * DELTA_BLOCK_WEIGHTS;
+    size_t n = WeightShard::MODEL_WEIGHTS - first;
+    return n < DELTA_BLOCK_WEIGHTS ? n : DELTA_BLOCK_WEIGHTS;
+}
+
+}  // namespace
+
+Aggregator::Aggregator(const GatewayConfig& config, ShardHistory& history)
+    : config_(config), history_(history), pool_(new Contribution[CONTRIBUTION_POOL]),
+      free_(new FreeList), control_(new ControlQueue) {
+    if (config_.workers == 0) config_.workers = 1;
+    for (auto& r : route_) r.store(NO_LINK, std::memory_order_relaxed);
+    for (auto& q : queues_) q.reset(new ShardQueue);
+    for (auto& s : push_score_) s.store(0, std::memory_order_relaxed);
+    for (uint32_t i = 0; i < CONTRIBUTION_POOL; i++) free_->push(i);
+}
+
+Aggregator::~Aggregator() = default;
+
+uint64_t Aggregator::nowMs() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+bool Aggregator::addLink(int in_fd, int out_fd) {
+    if (links_.size() >= NO_LINK) return false;
+    links_.emplace_back(new Link(in_fd, out_fd));
+    return true;
+}
+
+void Aggregator::run() {
+    std::vector<std::thread> workers;
+    for (uint8_t w = 0; w < config_.workers; w++) workers.emplace_back(&Aggregator::mergeLoop, this, w);
+    std::thread egress(&Aggregator::egressLoop, this);
+    for (uint8_t i = 0; i < links_.size(); i++) {
+        links_[i]->reader = std::thread(&Aggregator::readLink, this, i);
+    }
+
+    // Streams end -> open rounds commit -> their pushes go out
+    for (auto& l : links_) l->reader.join();
+    draining_.store(true);
+    for (auto& w : workers) w.join();
+    stop_.store(true);
+    egress.join();
+    history_.sync();
+}
+
+//-----------------------------------------------------------------------------
+// Ingest
+//-----------------------------------------------------------------------------
+
+void Aggregator::readLink(uint8_t index) {
+    Link& link = *links_[index];
+    TapReader reader(link.in_fd);
+    TapMessage m;
+    uint64_t last_sweep = nowMs();
+
+    while (reader.next(m)) {
+        stats_.messages.fetch_add(1, std::memory_order_relaxed);
+        if (m.src == config_.addr) continue;  // Our own, relayed back by a proxy
+        route_[m.src].store(index, std::memory_order_relaxed);
+
+        const OpcodeSpec* spec = opcodeSpec(m.opcode);
+        if (!spec || m.len < sizeof(GossipHeader) + spec->min_body) continue;
+        RxMessage msg = {m.src, m.opcode, m.params[offsetof(GossipHeader, seq_num)],
+                         m.params[offsetof(GossipHeader, flags)]};
+        TapMessage body = m;
+        body.params += sizeof(GossipHeader);
+        body.len -= sizeof(GossipHeader);
+
+        switch (static_cast<GossipOpcode>(m.opcode)) {
+            case GossipOpcode::SHARD_FRAGMENT: onFragment(link, body, msg); break;
+            case GossipOpcode::WEIGHT_DELTA:   onDelta(link, body, msg); break;
+            case GossipOpcode::WEIGHT_REQUEST: onRequest(body, msg); break;
+            default: break;
+        }
+
+        uint64_t now = nowMs();
+        if (now - last_sweep >= FRAGMENT_NACK_MS) {
+            sweepPeers(link, now);
+            last_sweep = now;
+        }
+    }
+}
+
+// As MeshGossip::handleFragment(), into the node's copy instead of a
+// resident shard or staging sector
+void Aggregator::onFragment(Link& link, const TapMessage& m, const RxMessage& msg) {
+    FragmentView frag(m.params);
+    if (frag.shardId() >= TOTAL_MODEL_SHARDS || frag.totalFragments() != MeshGossip::TOTAL_FRAGMENTS ||
+        frag.fragmentIdx() >= frag.totalFragments()) {
+        stats_.rejected.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    std::unique_ptr<PeerShard>& entry = link.peers[peerKey(msg.src_addr, frag.shardId())];
+    bool repair = msg.flags & GOSSIP_FLAG_RETRANSMIT;
+    if (!entry) {
+        if (repair) return;  // Repairs only fill transfers in progress
+        entry.reset(new PeerShard);
+        memset(entry.get(), 0, sizeof(PeerShard));
+        entry->content_tag = static_cast<uint8_t>(~frag.contentTag());
+    }
+    PeerShard& p = *entry;
+    p.last_ms = nowMs();
+
+    // Fresh transfer, or the node's shard changed under it: start over
+    if (p.content_tag != frag.contentTag()) {
+        if (repair) return;
+        memset(&p.shard, 0, sizeof(p.shard));  // Bytes past WIRE_SIZE stay zero
+        p.content_tag = frag.contentTag();
+        p.received = 0;
+        p.nacks = 0;
+        p.complete = false;
+    }
+
+    uint16_t bit = 1u << frag.fragmentIdx();
+    if (p.received & bit) return;  // Duplicate, or a copy we already hold
+    p.nacks = 0;
+
+    size_t offset = frag.fragmentIdx() * FRAGMENT_SIZE;
+    const uint8_t* data = m.params + sizeof(FragmentInfo);
+    size_t data_len = m.len - sizeof(FragmentInfo);
+    alignas(4) int8_t unpacked[FRAGMENT_SIZE];
+    if (msg.flags & GOSSIP_FLAG_PACKED) {
+        size_t raw_len = WeightShard::WIRE_SIZE - offset;
+        if (raw_len > FRAGMENT_SIZE) raw_len = FRAGMENT_SIZE;
+        if (!data_len || kernels::unpack_s8(data, data_len, unpacked, raw_len) != data_len) {
+            stats_.rejected.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        data = reinterpret_cast<const uint8_t*>(unpacked);
+        data_len = raw_len;
+    }
+    if (offset + data_len > WeightShard::WIRE_SIZE) {
+        stats_.rejected.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    memcpy(reinterpret_cast<uint8_t*>(&p.shard) + offset, data, data_len);
+    p.received |= bit;
+    if (p.received != ALL_FRAGMENTS) return;
+
+    if (p.shard.header.shard_id != frag.shardId() || !p.shard.verifyChecksum()) {
+        stats_.rejected.fetch_add(1, std::memory_order_relaxed);
+        p.received = 0;
+        p.content_tag = static_cast<uint8_t>(~p.content_tag);  // Take the next send whole
+        return;
+    }
+    p.complete = true;
+    p.delta_pending = 0;
+    stats_.shards_in.fetch_add(1, std::memory_order_relaxed);
+    contribute(p.shard, msg.src_addr);
+}
+
+// As MeshGossip::handleDelta(): blocks apply on top of the copy at the
+// sender's base version or later, and the copy takes the new version once
+// every block the delta lists is in. Missing blocks are not NACKed here;
+// an overheard repair fills them, else the next delta fetches the shard.
+// The copy is the node's own shard, so the marked weights are overwritten,
+// not blended.
+void Aggregator::onDelta(Link& link, const TapMessage& m, const RxMessage& msg) {
+    DeltaView view(m.params);
+    DeltaInfo info = view.info();
+    const uint8_t* bitmap = view.bitmap();
+    size_t value_count = m.len - sizeof(DeltaInfo) - DELTA_BITMAP_BYTES;
+    uint16_t bit = info.block_idx < DELTA_BLOCKS ? 1u << info.block_idx : 0;
+    if (info.shard_id >= TOTAL_MODEL_SHARDS || !bit || !(info.blocks & bit) ||
+        crc16::update(crc16::INIT, bitmap, DELTA_BITMAP_BYTES + value_count) != info.crc) {
+        stats_.rejected.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    auto it = link.peers.find(peerKey(msg.src_addr, info.shard_id));
+    PeerShard* p = it != link.peers.end() ? it->second.get() : nullptr;
+    if (msg.flags & GOSSIP_FLAG_RETRANSMIT) {
+        // A dense resend of a block some node NACKed; fills our copy too
+        if (!p || p->delta_version != info.version || !(p->delta_pending & bit)) return;
+    } else {
+        uint8_t held = p ? p->shard.header.version : 0;
+        if (!p || !p->complete || WeightShard::versionBefore(held, info.base_version)) {
+            // No base here: the sender holds the full shard, so ask it
+            if ((info.blocks >> info.block_idx) == 1) {
+                control({ControlKind::REQUEST, info.shard_id, 0, msg.src_addr, 0});
+            }
+            return;
+        }
+        if (!WeightShard::versionBefore(held, info.version)) return;  // Nothing new
+        if (!p->delta_pending || p->delta_version != info.version) {
+            p->delta_pending = info.blocks;
+            p->delta_version = info.version;
+        }
+        if (!(p->delta_pending & bit)) return;
+    }
+
+    size_t first = static_cast<size_t>(info.block_idx) * DELTA_BLOCK_WEIGHTS;
+    size_t n = blockWeights(info.block_idx);
+    size_t marked = 0;
+    for (size_t k = 0; k < n; k++) marked += (bitmap[k >> 3] >> (k & 7)) & 1;
+    if (marked != value_count) {
+        stats_.rejected.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    const int8_t* values = reinterpret_cast<const int8_t*>(bitmap + DELTA_BITMAP_BYTES);
+    for (size_t k = 0, v = 0; k < n; k++) {
+        if (bitmap[k >> 3] & (1u << (k & 7))) p->shard.weights[first + k] = values[v++];
+    }
+    p->delta_pending &= ~bit;
+    p->last_ms = nowMs();
+    if (p->delta_pending) return;
+
+    p->shard.header.version = info.version;
+    p->shard.header.contributors = info.contributors;
+    p->shard.updateChecksum();
+    p->content_tag = static_cast<uint8_t>(p->shard.header.checksum);
+    stats_.deltas_in.fetch_add(1, std::memory_order_relaxed);
+    contribute(p->shard, msg.src_addr);
+}
+
+void Aggregator::onRequest(const TapMessage& m, const RxMessage& msg) {
+    RequestView req(m.params);
+    if (req.targetAddr() != config_.addr || req.shardId() >= TOTAL_MODEL_SHARDS) return;
+    control({ControlKind::REPLY_FULL, req.shardId(), 0, msg.src_addr, 0});
+}
+
+// NACK transfers idle for FRAGMENT_NACK_MS, give up after
+// FRAGMENT_MAX_NACKS, and forget copies no node has touched in a while
+void Aggregator::sweepPeers(Link& link, uint64_t now) {
+    for (auto it = link.peers.begin(); it != link.peers.end();) {
+        PeerShard& p = *it->second;
+        if (now - p.last_ms >= PEER_COPY_TTL_MS) {
+            it = link.peers.erase(it);
+            continue;
+        }
+        if (!p.complete && p.received && now - p.last_ms >= FRAGMENT_NACK_MS) {
+            if (p.nacks >= FRAGMENT_MAX_NACKS) {
+                p.received = 0;
+                p.content_tag = static_cast<uint8_t>(~p.content_tag);
+            } else {
+                uint16_t src = static_cast<uint16_t>(it->first >> 8);
+                control({ControlKind::NACK, static_cast<uint8_t>(it->first), p.content_tag, src,
+                         static_cast<uint16_t>(ALL_FRAGMENTS & ~p.received)});
+                p.nacks++;
+                p.last_ms = now;
+            }
+        }
+        ++it;
+    }
+}
+
+void Aggregator::contribute(const WeightShard& shard, uint16_t src) {
+    uint32_t idx;
+    if (!free_->pop(idx)) {
+        stats_.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    memcpy(&pool_[idx].shard, &shard, sizeof(shard));
+    pool_[idx].src = src;
+    if (!queues_[shard.header.shard_id]->push(idx)) {
+        free_->push(idx);
+        stats_.dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Aggregator::control(const ControlJob& job) {
+    if (!control_->push(job)) stats_.dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+//-----------------------------------------------------------------------------
+// Merge
+//-----------------------------------------------------------------------------
+
+void Aggregator::mergeLoop(uint8_t worker) {
+    std::unique_ptr<Accumulator> acc(new Accumulator);
+    std::unique_ptr<Round[]> rounds(new Round[TOTAL_MODEL_SHARDS]);
+
+    for (;;) {
+        // Read before draining: once set, no link pushes anything more
+        bool last_pass = draining_.load();
+        bool busy = false;
+        uint64_t now = nowMs();
+        for (uint8_t s = worker; s < TOTAL_MODEL_SHARDS; s += config_.workers) {
+            Round& r = rounds[s];
+            busy |= drainShard(s, r);
+            if (!r.latest.empty() && (last_pass || now - r.opened_ms >= config_.round_ms)) {
+                commitRound(s, r, *acc);
+            }
+        }
+        if (last_pass) return;
+        if (!busy) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+// Move queued contributions into the round; a node's newer copy
+// replaces its older one
+bool Aggregator::drainShard(uint8_t shard_id, Round& round) {
+    bool any = false;
+    uint32_t idx;
+    while (queues_[shard_id]->pop(idx)) {
+        if (round.latest.empty()) round.opened_ms = nowMs();
+        auto ins = round.latest.emplace(pool_[idx].src, idx);
+        if (!ins.second) {
+            free_->push(ins.first->second);
+            ins.first->second = idx;
+        }
+        any = true;
+    }
+    return any;
+}
+
+void Aggregator::commitRound(uint8_t shard_id, Round& round, Accumulator& acc) {
+    WeightShard prev;
+    bool has_prev = history_.head(shard_id, prev);
+
+    acc.reset();
+    uint32_t epoch = has_prev ? prev.header.global_epoch : 0;
+    uint32_t contributors = 0;
+    for (const auto& kv : round.latest) {
+        const WeightShard& c = pool_[kv.second].shard;
+        acc.add(c.weights, c.header.contributors);
+        contributors += c.header.contributors;
+        if (c.header.global_epoch > epoch) epoch = c.header.global_epoch;
+    }
+    size_t folded = round.latest.size();
+    for (const auto& kv : round.latest) free_->push(kv.second);
+    round.latest.clear();
+    if (acc.weight == 0) return;
+
+    WeightShard merged;
+    merged.clear();
+    acc.finish(merged.weights);
+    merged.header.shard_id = shard_id;
+    merged.header.version = has_prev ? static_cast<uint8_t>(prev.header.version + 1) : 1;
+    merged.header.global_epoch = epoch;
+    merged.header.contributors = static_cast<uint16_t>(
+        contributors > CONTRIBUTORS_MAX ? CONTRIBUTORS_MAX : contributors);
+    merged.updateChecksum();
+    history_.commit(merged);
+
+    // Priority for egress: how far this commit moved the shard
+    uint32_t moved = 1;
+    if (has_prev) {
+        for (size_t i = 0; i < WeightShard::MODEL_WEIGHTS; i++) {
+            int d = merged.weights[i] - prev.weights[i];
+            moved += static_cast<uint32_t>(d < 0 ? -d : d);
+        }
+    } else {
+        moved = UINT32_MAX / 2;  // Never sent: ahead of any delta
+    }
+    uint32_t score = push_score_[shard_id].load(std::memory_order_relaxed);
+    uint32_t next;
+    do {
+        next = score > UINT32_MAX - moved ? UINT32_MAX : score + moved;
+    } while (!push_score_[shard_id].compare_exchange_weak(score, next, std::memory_order_release,
+                                                          std::memory_order_relaxed));
+
+    stats_.rounds.fetch_add(1, std::memory_order_relaxed);
+    stats_.contributions.fetch_add(folded, std::memory_order_relaxed);
+}
+
+//-----------------------------------------------------------------------------
+// Egress
+//-----------------------------------------------------------------------------
+
+// Token bucket of egress_bytes_per_s, a second deep. A message may take
+// the bucket negative; nothing more goes out until it refills. After the
+// links close, what is left goes out unpaced.
+void Aggregator::egressLoop() {
+    double tokens = config_.egress_bytes_per_s;
+    uint64_t last = nowMs();
+
+    for (;;) {
+        bool stopping = stop_.load();
+        uint64_t now = nowMs();
+        tokens += static_cast<double>(now - last) * config_.egress_bytes_per_s / 1000;
+        if (tokens > config_.egress_bytes_per_s) tokens = config_.egress_bytes_per_s;
+        last = now;
+
+        bool idle = false;
+        while (stopping || tokens > 0) {
+            uint64_t before = stats_.bytes_out.load(std::memory_order_relaxed);
+            ControlJob job;
+            if (control_->pop(job)) {
+                sendControl(job);
+            } else {
+                uint8_t best = NO_SHARD_ID;
+                uint32_t best_score = 0;
+                for (uint8_t s = 0; s < TOTAL_MODEL_SHARDS; s++) {
+                    uint32_t score = push_score_[s].load(std::memory_order_acquire);
+                    if (score > best_score) {
+                        best = s;
+                        best_score = score;
+                    }
+                }
+                if (best == NO_SHARD_ID) {
+                    idle = true;
+                    break;
+                }
+                push_score_[best].exchange(0);
+                sendPush(best);
+            }
+            tokens -= static_cast<double>(stats_.bytes_out.load(std::memory_order_relaxed) - before);
+        }
+
+        if (stopping && idle) return;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+}
+
+void Aggregator::sendControl(const ControlJob& job) {
+    stats_.control_sent.fetch_add(1, std::memory_order_relaxed);
+    switch (job.kind) {
+        case ControlKind::REPLY_FULL: {
+            // Everyone who asks within REPLY_COALESCE_MS gets the same
+            // broadcast; a repeat ask for the same version is already served
+            WeightShard head;
+            if (!history_.head(job.shard_id, head)) return;
+            uint64_t now = nowMs();
+            if (has_replied_[job.shard_id] && reply_version_[job.shard_id] == head.header.version &&
+                now - reply_ms_[job.shard_id] < REPLY_COALESCE_MS) return;
+            sendFull(head, MESH_ADDR_ALL, GOSSIP_FLAG_REPLY);
+            has_replied_[job.shard_id] = true;
+            reply_version_[job.shard_id] = head.header.version;
+            reply_ms_[job.shard_id] = now;
+            return;
+        }
+        case ControlKind::REQUEST: {
+            uint8_t msg[sizeof(GossipHeader) + sizeof(ShardRequest)];
+            wire::Writer w(msg, sizeof(msg));
+            writeHeader(w, 0);
+            w.u16(job.dst);
+            w.u8(job.shard_id);
+            TxSegment seg = w.segment();
+            emit(GossipOpcode::WEIGHT_REQUEST, job.dst, &seg, 1);
+            return;
+        }
+        case ControlKind::NACK: {
+            uint8_t msg[sizeof(GossipHeader) + sizeof(NackInfo)];
+            wire::Writer w(msg, sizeof(msg));
+            writeHeader(w, 0);
+            w.u16(job.dst);
+            w.u8(job.shard_id);
+            w.u8(job.content_tag);
+            w.u16(job.missing);
+            TxSegment seg = w.segment();
+            emit(GossipOpcode::NACK, MESH_ADDR_ALL, &seg, 1);
+            return;
+        }
+    }
+}
+
+// The newest commit of a shard, against the version last sent
+void Aggregator::sendPush(uint8_t shard_id) {
+    WeightShard head;
+    if (!history_.head(shard_id, head)) return;
+    if (has_sent_[shard_id] && sent_version_[shard_id] == head.header.version) return;
+
+    WeightShard base;
+    bool delta = has_sent_[shard_id] && history_.find(shard_id, sent_version_[shard_id], base) &&
+                 sendDelta(base, head);
+    if (delta) {
+        stats_.pushes_delta.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        sendFull(head, MESH_ADDR_ALL, GOSSIP_FLAG_REPLY);
+        stats_.pushes_full.fetch_add(1, std::memory_order_relaxed);
+    }
+    has_sent_[shard_id] = true;
+    sent_version_[shard_id] = head.header.version;
+}
+
+// As MeshGossip::sendFragment(), every fragment in order
+void Aggregator::sendFull(const WeightShard& shard, uint16_t dst, uint8_t flags) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&shard);
+    for (uint8_t idx = 0; idx < MeshGossip::TOTAL_FRAGMENTS; idx++) {
+        size_t start = static_cast<size_t>(idx) * FRAGMENT_SIZE;
+        size_t len = WeightShard::WIRE_SIZE - start;
+        if (len > FRAGMENT_SIZE) len = FRAGMENT_SIZE;
+
+        uint8_t packed_buf[FRAGMENT_SIZE - 1];
+        TxSegment payload = {bytes + start, len};
+        size_t packed = kernels::pack_s8(reinterpret_cast<const int8_t*>(payload.data), len,
+                                         packed_buf, len - 1);
+        if (packed) payload = {packed_buf, packed};
+
+        uint8_t head[sizeof(GossipHeader) + sizeof(FragmentInfo)];
+        wire::Writer w(head, sizeof(head));
+        writeHeader(w, flags | (packed ? GOSSIP_FLAG_PACKED : 0));
+        w.u8(shard.header.shard_id);
+        w.u8(idx);
+        w.u8(MeshGossip::TOTAL_FRAGMENTS);
+        w.u8(static_cast<uint8_t>(shard.header.checksum));
+
+        const TxSegment segs[] = {w.segment(), payload};
+        emit(GossipOpcode::SHARD_FRAGMENT, dst, segs, 2);
+    }
+}
+
+// As MeshGossip::broadcastDelta(), with the change bitmap computed from
+// the two versions. False (nothing sent) when full fragments are cheaper.
+bool Aggregator::sendDelta(const WeightShard& base, const WeightShard& head) {
+    uint8_t bitmaps[DELTA_BLOCKS][DELTA_BITMAP_BYTES] = {};
+    uint16_t counts[DELTA_BLOCKS] = {};
+    size_t changed = 0, dirty_blocks = 0;
+    for (uint8_t b = 0; b < DELTA_BLOCKS; b++) {
+        size_t first = static_cast<size_t>(b) * DELTA_BLOCK_WEIGHTS;
+        for (size_t k = 0; k < blockWeights(b); k++) {
+            if (base.weights[first + k] != head.weights[first + k]) {
+                bitmaps[b][k >> 3] |= 1u << (k & 7);
+                counts[b]++;
+            }
+        }
+        changed += counts[b];
+        dirty_blocks += counts[b] != 0;
+    }
+
+    size_t delta_bytes = dirty_blocks * (GOSSIP_OVERHEAD + sizeof(DeltaInfo) + DELTA_BITMAP_BYTES) +
+                         changed;
+    size_t full_bytes = MeshGossip::TOTAL_FRAGMENTS * (GOSSIP_OVERHEAD + sizeof(FragmentInfo)) +
+                        WeightShard::WIRE_SIZE;
+    if (changed == 0 || delta_bytes >= full_bytes) return false;
+
+    uint16_t blocks = 0;
+    for (uint8_t b = 0; b < DELTA_BLOCKS; b++) {
+        if (counts[b]) blocks |= 1u << b;
+    }
+    for (uint8_t b = 0; b < DELTA_BLOCKS; b++) {
+        if (!counts[b]) continue;
+
+        uint8_t values[DELTA_BLOCK_WEIGHTS];
+        size_t count = 0;
+        size_t first = static_cast<size_t>(b) * DELTA_BLOCK_WEIGHTS;
+        for (size_t k = 0; k < blockWeights(b); k++) {
+            if (bitmaps[b][k >> 3] & (1u << (k & 7))) {
+                values[count++] = static_cast<uint8_t>(head.weights[first + k]);
+            }
+        }
+        uint16_t crc = crc16::update(crc16::INIT, bitmaps[b], DELTA_BITMAP_BYTES);
+        crc = crc16::update(crc, values, count);
+
+        uint8_t hdr[sizeof(GossipHeader) + sizeof(DeltaInfo)];
+        wire::Writer w(hdr, sizeof(hdr));
+        writeHeader(w, GOSSIP_FLAG_REPLY);
+        w.u8(head.header.shard_id);
+        w.u8(base.header.version);
+        w.u8(head.header.version);
+        w.u8(b);
+        w.u16(head.header.contributors);
+        w.u16(blocks);
+        w.u16(crc);
+
+        const TxSegment segs[] = {w.segment(), {bitmaps[b], DELTA_BITMAP_BYTES}, {values, count}};
+        emit(GossipOpcode::WEIGHT_DELTA, MESH_ADDR_ALL, segs, 3);
+    }
+    return true;
+}
+
+// Unicast through the link the node was last heard on; broadcasts (and
+// nodes not heard yet) through every link
+void Aggregator::emit(GossipOpcode opcode, uint16_t dst, const TxSegment* segs, uint8_t count) {
+    size_t len = VENDOR_OPCODE_SIZE;
+    for (uint8_t i = 0; i < count; i++) len += segs[i].len;
+
+    uint8_t via = dst == MESH_ADDR_ALL ? NO_LINK : route_[dst].load(std::memory_order_relaxed);
+    for (uint8_t i = 0; i < links_.size(); i++) {
+        Link& link = *links_[i];
+        if (link.out_fd < 0 || (via != NO_LINK && via != i)) continue;
+        if (link.writer.write(config_.addr, dst, config_.ttl, opcode, segs, count)) {
+            stats_.bytes_out.fetch_add(len, std::memory_order_relaxed);
+        }
+    }
+}
+
+}  // namespace gateway
+}  // namespace planetary
@@ -0,0 +1,211 @@
+/**
+ * Gateway Aggregator - site-wide FedAvg over many mesh proxies
+ *
+ * A bulb only ever averages with the few neighbours it hears. At a site
+ * with thousands of bulbs the gateway sits behind one proxy per radio
+ * neighbourhood (tap_stream.h) and closes the loop for the whole model:
+ *
+ *   ingest   one thread per link reads its proxy's stream and rebuilds
+ *            shards from SHARD_FRAGMENT (packed or raw) and WEIGHT_DELTA
+ *            messages exactly as a bulb would, keeping the last copy of
+ *            every (node, shard) so deltas have a base. A finished shard
+ *            is copied into a pool slot and its index pushed onto that
+ *            shard's lock-free queue (bounded_queue.h).
+ *   merge    `workers` threads; shard s belongs to worker s % workers, so
+ *            a shard's round state is never shared. A round keeps each
+ *            node's latest copy (a node heard by two proxies counts
+ *            once) and after round_ms folds them into one shard with the
+ *            SIMD FedAvg (fedavg_simd.h), weighted by contributors, then
+ *            commits it to the memory-mapped history (shard_history.h).
+ *   egress   one thread, paced to egress_bytes_per_s. Control messages
+ *            go first: full-shard replies to WEIGHT_REQUESTs addressed to
+ *            the gateway (broadcast, and once per version however many
+ *            nodes ask), requests for a full copy when a node's delta
+ *            has no base here, NACKs for stalled reassemblies. Then the
+ *            committed shard that moved most since it was last sent goes
+ *            out as WEIGHT_DELTA blocks against that version, or as full
+ *            fragments when there is no base or they are cheaper.
+ *
+ * Everything on the wire is the firmware's own encoding (gossip_codec.h,
+ * mesh_gossip.h, WeightShard), read through the same views. Pushes carry
+ * GOSSIP_FLAG_REPLY so cluster members take them as they take their
+ * head's aggregate. A node that hears a delta before it holds the base
+ * requests the full shard from the gateway, as it would from any peer.
+ * NACKs are not served here, so a node missing blocks of a delta does
+ * the same once its FRAGMENT_MAX_NACKS have gone unanswered.
+ *
+ * Host code: threads, heap and the STL are fine here; nothing in this
+ * directory is built for the bulb.
+ */
+
+#ifndef GATEWAY_AGGREGATOR_H
+#define GATEWAY_AGGREGATOR_H
+
+#include "bounded_queue.h"
+#include "fedavg_simd.h"
+#include "mesh_gossip.h"
+#include "shard_history.h"
+#include "tap_stream.h"
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace planetary {
+namespace gateway {
+
+struct GatewayConfig {
+    uint16_t addr = 0x7F00;              // Unicast address of the gateway's proxy client
+    uint8_t  workers = 4;                // Merge threads
+    uint32_t round_ms = 10000;           // FedAvg round per shard
+    uint32_t egress_bytes_per_s = 4000;  // Access bytes per second per link
+    uint8_t  ttl = 3;                    // Pushes and replies
+};
+
+// Pool, queue and table sizes
+constexpr uint32_t CONTRIBUTION_POOL  = 8192;   // Shards in flight (~32MB)
+constexpr size_t   SHARD_QUEUE_DEPTH  = 1024;   // Per shard, ingest -> merge
+constexpr size_t   CONTROL_QUEUE_DEPTH = 1024;  // Ingest -> egress
+constexpr uint32_t PEER_COPY_TTL_MS   = 30 * 60 * 1000;  // Forget a node's shard copy
+constexpr uint32_t REPLY_COALESCE_MS  = 2000;   // One full reply per shard version
+constexpr uint8_t  NO_LINK            = 0xFF;
+
+struct GatewayStats {
+    std::atomic<uint64_t> messages{0};       // Vendor messages read
+    std::atomic<uint64_t> shards_in{0};      // Complete shards from fragments
+    std::atomic<uint64_t> deltas_in{0};      // Shards advanced by a delta
+    std::atomic<uint64_t> rejected{0};       // Bad CRC, tag, length or base
+    std::atomic<uint64_t> dropped{0};        // Pool or queue full
+    std::atomic<uint64_t> rounds{0};         // Committed merges
+    std::atomic<uint64_t> contributions{0};  // Shards folded into them
+    std::atomic<uint64_t> pushes_delta{0};
+    std::atomic<uint64_t> pushes_full{0};
+    std::atomic<uint64_t> control_sent{0};   // Replies, requests, NACKs
+    std::atomic<uint64_t> bytes_out{0};      // Access bytes, per link
+};
+
+class Aggregator {
+public:
+    Aggregator(const GatewayConfig& config, ShardHistory& history);
+    ~Aggregator();
+
+    Aggregator(const Aggregator&) = delete;
+    Aggregator& operator=(const Aggregator&) = delete;
+
+    // A proxy stream: records are read from in_fd, the gateway's own
+    // messages written to out_fd (-1: receive only). Before run().
+    bool addLink(int in_fd, int out_fd);
+
+    // Run until every link has reached end of stream; then commit the
+    // open rounds and send what they produced without pacing
+    void run();
+
+    const GatewayStats& stats() const { return stats_; }
+
+private:
+    struct Contribution {
+        WeightShard shard;
+        uint16_t    src;
+    };
+
+    // A node's copy of a shard as this link last saw it
+    struct PeerShard {
+        WeightShard shard;
+        uint64_t    last_ms;
+        uint16_t    received;    // Fragment bitmap of the transfer in progress
+        uint16_t    delta_pending;  // Blocks of the delta to delta_version still missing
+        uint8_t     delta_version;
+        uint8_t     content_tag;
+        uint8_t     nacks;
+        bool        complete;    // shard holds the node's full copy
+    };
+
+    struct Link {
+        int         in_fd;
+        int         out_fd;
+        TapWriter   writer;
+        std::thread reader;
+        std::unordered_map<uint32_t, std::unique_ptr<PeerShard>> peers;  // (src << 8) | shard
+        Link(int in, int out) : in_fd(in), out_fd(out), writer(out) {}
+    };
+
+    enum class ControlKind : uint8_t { REPLY_FULL, REQUEST, NACK };
+
+    struct ControlJob {
+        ControlKind kind;
+        uint8_t     shard_id;
+        uint8_t     content_tag; // NACK
+        uint16_t    dst;         // Node addressed
+        uint16_t    missing;     // NACK
+    };
+
+    // One shard's open round, owned by its worker
+    struct Round {
+        std::unordered_map<uint16_t, uint32_t> latest;  // src -> pool index
+        uint64_t opened_ms = 0;
+    };
+
+    using ShardQueue = BoundedQueue<uint32_t, SHARD_QUEUE_DEPTH>;
+    using FreeList = BoundedQueue<uint32_t, CONTRIBUTION_POOL>;
+    using ControlQueue = BoundedQueue<ControlJob, CONTROL_QUEUE_DEPTH>;
+    using Accumulator = FedAvgAccumulator<WeightShard::MODEL_WEIGHTS>;
+
+    static uint64_t nowMs();
+
+    // Ingest (link threads)
+    void readLink(uint8_t link);
+    void onFragment(Link& link, const TapMessage& m, const RxMessage& msg);
+    void onDelta(Link& link, const TapMessage& m, const RxMessage& msg);
+    void onRequest(const TapMessage& m, const RxMessage& msg);
+    void sweepPeers(Link& link, uint64_t now);
+    void contribute(const WeightShard& shard, uint16_t src);
+    void control(const ControlJob& job);
+
+    // Merge (worker threads)
+    void mergeLoop(uint8_t worker);
+    bool drainShard(uint8_t shard_id, Round& round);
+    void commitRound(uint8_t shard_id, Round& round, Accumulator& acc);
+
+    // Egress (egress thread)
+    void egressLoop();
+    void sendControl(const ControlJob& job);
+    void sendPush(uint8_t shard_id);
+    void sendFull(const WeightShard& shard, uint16_t dst, uint8_t flags);
+    bool sendDelta(const WeightShard& base, const WeightShard& head);
+    void emit(GossipOpcode opcode, uint16_t dst, const TxSegment* segs, uint8_t count);
+    void writeHeader(wire::Writer& w, uint8_t flags) {
+        w.u8(seq_num_++);
+        w.u8(flags);
+    }
+
+    GatewayConfig config_;
+    ShardHistory& history_;
+    GatewayStats  stats_;
+
+    std::vector<std::unique_ptr<Link>> links_;
+    std::atomic<uint8_t> route_[0x10000];          // Node -> link it was last heard on
+    std::atomic<bool>    draining_{false};         // Links done: commit open rounds now
+    std::atomic<bool>    stop_{false};
+
+    std::unique_ptr<Contribution[]> pool_;
+    std::unique_ptr<FreeList>       free_;
+    std::unique_ptr<ShardQueue>     queues_[TOTAL_MODEL_SHARDS];
+    std::unique_ptr<ControlQueue>   control_;
+
+    // Sum |change| of the commits not yet sent, per shard (merge -> egress)
+    std::atomic<uint32_t> push_score_[TOTAL_MODEL_SHARDS];
+
+    // Egress thread only
+    bool     has_sent_[TOTAL_MODEL_SHARDS] = {};
+    uint8_t  sent_version_[TOTAL_MODEL_SHARDS] = {};
+    bool     has_replied_[TOTAL_MODEL_SHARDS] = {};
+    uint8_t  reply_version_[TOTAL_MODEL_SHARDS] = {};
+    uint64_t reply_ms_[TOTAL_MODEL_SHARDS] = {};
+    uint8_t  seq_num_ = 0;
+};
+
+}  // namespace gateway
+}  // namespace planetary
+
+#endif  // GATEWAY_AGGREGATOR_H
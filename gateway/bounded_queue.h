@@ -0,0 +1,90 @@
+/**
+ * Bounded Queue - lock-free multi-producer multi-consumer ring
+ *
+ * Vyukov's bounded MPMC queue: every cell carries a sequence number that
+ * says whose turn it is, so producers and consumers claim cells with one
+ * CAS on their own cursor and never wrap onto each other (no ABA). The
+ * gateway moves pool indices through these, never the shards themselves.
+ */
+
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace planetary {
+namespace gateway {
+
+template <typename T, size_t CAPACITY>
+class BoundedQueue {
+public:
+    static_assert(CAPACITY >= 2 && (CAPACITY & (CAPACITY - 1)) == 0,
+                  "Capacity must be a power of two");
+
+    BoundedQueue() : head_(0), tail_(0) {
+        for (size_t i = 0; i < CAPACITY; i++) cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    // False when full
+    bool push(const T& value) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& c = cells_[pos & (CAPACITY - 1)];
+            size_t seq = c.seq.load(std::memory_order_acquire);
+            intptr_t dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (dif == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    c.value = value;
+                    c.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (dif < 0) {
+                return false;
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // False when empty
+    bool pop(T& out) {
+        size_t pos = head_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& c = cells_[pos & (CAPACITY - 1)];
+            size_t seq = c.seq.load(std::memory_order_acquire);
+            intptr_t dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (dif == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    out = c.value;
+                    c.seq.store(pos + CAPACITY, std::memory_order_release);
+                    return true;
+                }
+            } else if (dif < 0) {
+                return false;
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        T                   value;
+    };
+
+    // Cursors on their own cache lines: producers and consumers never share one
+    alignas(64) Cell cells_[CAPACITY];
+    alignas(64) std::atomic<size_t> head_;
+    alignas(64) std::atomic<size_t> tail_;
+};
+
+}  // namespace gateway
+}  // namespace planetary
+
+#endif  // BOUNDED_QUEUE_H
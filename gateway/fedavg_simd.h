@@ -0,0 +1,142 @@
+/**
+ * FedAvg SIMD - weighted mean of many int8 shard copies on the host
+ *
+ * A gateway round folds thousands of contributions into one shard:
+ *
+ *   merged[i] = round(sum_k(w_k[i] * n_k) / sum_k(n_k))
+ *
+ * with n_k the contribution's FedAvg weight (ShardHeader.contributors).
+ * Each contribution is a widening multiply-accumulate into int32 lanes
+ * (8 per AVX2 op, 4 per NEON op); every ACCUM_FLUSH_EVERY contributions
+ * the int32 lanes are spilled into int64 totals before they can
+ * overflow. The division runs once per weight at the end of the round.
+ *
+ * PLANETARY_KERNELS_SCALAR selects the plain loops, which are also the
+ * fallback on hosts with neither extension.
+ */
+
+#ifndef FEDAVG_SIMD_H
+#define FEDAVG_SIMD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if !defined(PLANETARY_KERNELS_SCALAR) && defined(__AVX2__)
+#include <immintrin.h>
+#define FEDAVG_AVX2 1
+#elif !defined(PLANETARY_KERNELS_SCALAR) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define FEDAVG_NEON 1
+#endif
+
+namespace planetary {
+namespace gateway {
+
+// |w * n| <= 128 * 65535 per contribution; this many still fit in int32
+constexpr uint32_t ACCUM_FLUSH_EVERY = 255;
+static_assert(static_cast<uint64_t>(ACCUM_FLUSH_EVERY) * 128 * 0xFFFF <= INT32_MAX,
+              "int32 lanes would overflow between flushes");
+
+namespace fedavg {
+
+// acc[i] += w[i] * n
+inline void accumulate(int32_t* acc, const int8_t* w, size_t count, uint16_t n) {
+    size_t i = 0;
+#if defined(FEDAVG_AVX2)
+    const __m256i vn = _mm256_set1_epi32(n);
+    for (; i + 16 <= count; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(w + i));
+        __m256i lo = _mm256_cvtepi8_epi32(bytes);
+        __m256i hi = _mm256_cvtepi8_epi32(_mm_srli_si128(bytes, 8));
+        __m256i* a = reinterpret_cast<__m256i*>(acc + i);
+        _mm256_storeu_si256(a, _mm256_add_epi32(_mm256_loadu_si256(a), _mm256_mullo_epi32(lo, vn)));
+        _mm256_storeu_si256(a + 1, _mm256_add_epi32(_mm256_loadu_si256(a + 1),
+                                                    _mm256_mullo_epi32(hi, vn)));
+    }
+#elif defined(FEDAVG_NEON)
+    const int32_t vn = n;
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t w16 = vmovl_s8(vld1_s8(w + i));
+        int32x4_t lo = vmovl_s16(vget_low_s16(w16));
+        int32x4_t hi = vmovl_s16(vget_high_s16(w16));
+        vst1q_s32(acc + i, vmlaq_n_s32(vld1q_s32(acc + i), lo, vn));
+        vst1q_s32(acc + i + 4, vmlaq_n_s32(vld1q_s32(acc + i + 4), hi, vn));
+    }
+#endif
+    for (size_t tail = count - i; tail; tail--, i++) acc[i] += static_cast<int32_t>(w[i]) * n;
+}
+
+// total[i] += acc[i]; acc[i] = 0
+inline void flush(int64_t* total, int32_t* acc, size_t count) {
+    size_t i = 0;
+#if defined(FEDAVG_AVX2)
+    for (; i + 8 <= count; i += 8) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc + i));
+        __m256i* t = reinterpret_cast<__m256i*>(total + i);
+        __m256i lo = _mm256_cvtepi32_epi64(_mm256_castsi256_si128(a));
+        __m256i hi = _mm256_cvtepi32_epi64(_mm256_extracti128_si256(a, 1));
+        _mm256_storeu_si256(t, _mm256_add_epi64(_mm256_loadu_si256(t), lo));
+        _mm256_storeu_si256(t + 1, _mm256_add_epi64(_mm256_loadu_si256(t + 1), hi));
+    }
+#elif defined(FEDAVG_NEON)
+    for (; i + 4 <= count; i += 4) {
+        int32x4_t a = vld1q_s32(acc + i);
+        vst1q_s64(total + i, vaddw_s32(vld1q_s64(total + i), vget_low_s32(a)));
+        vst1q_s64(total + i + 2, vaddw_s32(vld1q_s64(total + i + 2), vget_high_s32(a)));
+    }
+#endif
+    for (size_t tail = count - i; tail; tail--, i++) total[i] += acc[i];
+    memset(acc, 0, count * sizeof(int32_t));
+}
+
+// out[i] = total[i] / weight, rounded half away from zero, saturated to int8
+inline void finish(int8_t* out, const int64_t* total, size_t count, uint64_t weight) {
+    if (weight == 0) return;
+    int64_t half = static_cast<int64_t>(weight / 2);
+    int64_t div = static_cast<int64_t>(weight);
+    for (size_t i = 0; i < count; i++) {
+        int64_t t = total[i];
+        int64_t q = (t >= 0 ? t + half : t - half) / div;
+        out[i] = static_cast<int8_t>(q > 127 ? 127 : (q < -128 ? -128 : q));
+    }
+}
+
+}  // namespace fedavg
+
+// One round's running sums for a shard
+template <size_t COUNT>
+struct FedAvgAccumulator {
+    int32_t  acc[COUNT];
+    int64_t  total[COUNT];
+    uint64_t weight;         // Sum of n over the round
+    uint32_t pending;        // Contributions in acc since the last flush
+
+    void reset() {
+        memset(acc, 0, sizeof(acc));
+        memset(total, 0, sizeof(total));
+        weight = 0;
+        pending = 0;
+    }
+
+    void add(const int8_t* w, uint16_t n) {
+        if (n == 0) return;
+        fedavg::accumulate(acc, w, COUNT, n);
+        weight += n;
+        if (++pending == ACCUM_FLUSH_EVERY) {
+            fedavg::flush(total, acc, COUNT);
+            pending = 0;
+        }
+    }
+
+    void finish(int8_t* out) {
+        if (pending) fedavg::flush(total, acc, COUNT);
+        pending = 0;
+        fedavg::finish(out, total, COUNT, weight);
+    }
+};
+
+}  // namespace gateway
+}  // namespace planetary
+
+#endif  // FEDAVG_SIMD_H
@@ -0,0 +1,113 @@
+/**
+ * Planetary Gateway - site aggregator over many mesh proxies (HOST_SIM)
+ *
+ *   planetary-gateway [options] LINK...
+ *
+ *   LINK                 IN[,OUT]: read the proxy's tap stream from IN and
+ *                        write the gateway's messages to OUT ('-' is
+ *                        stdin / stdout). FIFOs, sockets bound with socat
+ *                        or capture files all work.
+ *   --store FILE         shard history (default planetary-shards.db)
+ *   --depth N            versions kept per shard when creating FILE (16)
+ *   --workers N          merge threads (4)
+ *   --round-ms MS        FedAvg round per shard (10000)
+ *   --egress-bps N       access bytes per second per link (4000)
+ *   --addr ADDR          the gateway's unicast address (0x7F00)
+ *
+ * Runs until every IN reaches end of stream, then commits the open
+ * rounds, sends their pushes and prints the counters to stderr. See
+ * aggregator.h.
+ */
+
+#include "aggregator.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <unistd.h>
+
+using namespace planetary;
+using namespace planetary::gateway;
+
+namespace {
+
+int openEnd(const std::string& path, bool out) {
+    if (path == "-") return out ? STDOUT_FILENO : STDIN_FILENO;
+    int fd = out ? open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)
+                 : open(path.c_str(), O_RDONLY);
+    if (fd < 0) perror(path.c_str());
+    return fd;
+}
+
+void usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s [--store FILE] [--depth N] [--workers N] [--round-ms MS]\n"
+            "          [--egress-bps N] [--addr ADDR] IN[,OUT]...\n", argv0);
+}
+
+void printStats(const GatewayStats& s) {
+    fprintf(stderr, "messages       %llu\n", static_cast<unsigned long long>(s.messages.load()));
+    fprintf(stderr, "shards_in      %llu\n", static_cast<unsigned long long>(s.shards_in.load()));
+    fprintf(stderr, "deltas_in      %llu\n", static_cast<unsigned long long>(s.deltas_in.load()));
+    fprintf(stderr, "rejected       %llu\n", static_cast<unsigned long long>(s.rejected.load()));
+    fprintf(stderr, "dropped        %llu\n", static_cast<unsigned long long>(s.dropped.load()));
+    fprintf(stderr, "rounds         %llu\n", static_cast<unsigned long long>(s.rounds.load()));
+    fprintf(stderr, "contributions  %llu\n", static_cast<unsigned long long>(s.contributions.load()));
+    fprintf(stderr, "pushes_delta   %llu\n", static_cast<unsigned long long>(s.pushes_delta.load()));
+    fprintf(stderr, "pushes_full    %llu\n", static_cast<unsigned long long>(s.pushes_full.load()));
+    fprintf(stderr, "control_sent   %llu\n", static_cast<unsigned long long>(s.control_sent.load()));
+    fprintf(stderr, "bytes_out      %llu\n", static_cast<unsigned long long>(s.bytes_out.load()));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    GatewayConfig config;
+    const char* store_path = "planetary-shards.db";
+    uint16_t depth = 16;
+    std::vector<std::string> links;
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (!strcmp(argv[i], "--store") && has_value) {
+            store_path = argv[++i];
+        } else if (!strcmp(argv[i], "--depth") && has_value) {
+            depth = static_cast<uint16_t>(strtoul(argv[++i], nullptr, 0));
+        } else if (!strcmp(argv[i], "--workers") && has_value) {
+            config.workers = static_cast<uint8_t>(strtoul(argv[++i], nullptr, 0));
+        } else if (!strcmp(argv[i], "--round-ms") && has_value) {
+            config.round_ms = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 0));
+        } else if (!strcmp(argv[i], "--egress-bps") && has_value) {
+            config.egress_bytes_per_s = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 0));
+        } else if (!strcmp(argv[i], "--addr") && has_value) {
+            config.addr = static_cast<uint16_t>(strtoul(argv[++i], nullptr, 0));
+        } else if (argv[i][0] == '-' && argv[i][1] == '-') {
+            usage(argv[0]);
+            return 2;
+        } else {
+            links.push_back(argv[i]);
+        }
+    }
+    if (links.empty() || config.workers == 0 || config.egress_bytes_per_s == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    ShardHistory history;
+    if (!history.open(store_path, depth)) return 1;
+
+    std::unique_ptr<Aggregator> gateway(new Aggregator(config, history));
+    for (const std::string& link : links) {
+        size_t comma = link.find(',');
+        int in = openEnd(link.substr(0, comma), false);
+        int out = comma == std::string::npos ? -1 : openEnd(link.substr(comma + 1), true);
+        if (in < 0 || (comma != std::string::npos && out < 0) || !gateway->addLink(in, out)) {
+            return 1;
+        }
+    }
+
+    gateway->run();
+    printStats(gateway->stats());
+    return 0;
+}
@@ -0,0 +1,117 @@
+/**
+ * Gateway Tests - the aggregator fed recorded proxy streams
+ *
+ *   planetary-gateway-tests          run every check, non-zero on a failure
+ *
+ * Each check writes a tap stream (tap_stream.h) to a temporary file, runs
+ * an Aggregator over it to end of stream and reads its GatewayStats.
+ *
+ * Checks:
+ *   delta_block_range       WEIGHT_DELTA with block_idx past DELTA_BLOCKS
+ *                           is rejected before anything is derived from it
+ */
+
+#include "aggregator.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+
+using namespace planetary;
+using namespace planetary::gateway;
+
+namespace {
+
+int failures = 0;
+
+void expect(bool ok, const char* name) {
+    printf("%-6s %s\n", ok ? "ok" : "FAIL", name);
+    if (!ok) failures++;
+}
+
+// Parameters of one WEIGHT_DELTA block with nothing marked, CRC valid
+size_t buildDelta(uint8_t* out, size_t cap, uint8_t seq, uint8_t block_idx, uint16_t blocks) {
+    uint8_t bitmap[DELTA_BITMAP_BYTES] = {};
+    wire::Writer w(out, cap);
+    w.u8(seq);
+    w.u8(0);
+    w.u8(3);          // shard_id
+    w.u8(1);          // base_version
+    w.u8(2);          // version
+    w.u8(block_idx);
+    w.u16(1);         // contributors
+    w.u16(blocks);
+    w.u16(crc16::update(crc16::INIT, bitmap, sizeof(bitmap)));
+    w.bytes(bitmap, sizeof(bitmap));
+    return w.segment().len;
+}
+
+// Run an aggregator with a scratch history over a stream built by `fill`
+template <typename F>
+bool runStream(F&& fill, uint64_t& rejected, uint64_t& control) {
+    char dir[] = "/tmp/planetary-gw-XXXXXX";
+    if (!mkdtemp(dir)) return false;
+    std::string stream = std::string(dir) + "/tap";
+    std::string store = std::string(dir) + "/history";
+
+    FILE* f = fopen(stream.c_str(), "w+b");
+    if (!f) return false;
+    TapWriter writer(fileno(f));
+    fill(writer);
+    fflush(f);
+    lseek(fileno(f), 0, SEEK_SET);
+
+    ShardHistory history;
+    bool ok = history.open(store.c_str(), 4);
+    if (ok) {
+        GatewayConfig config;
+        config.workers = 1;
+        std::unique_ptr<Aggregator> gateway(new Aggregator(config, history));
+        gateway->addLink(fileno(f), -1);
+        gateway->run();
+        rejected = gateway->stats().rejected.load();
+        control = gateway->stats().control_sent.load();
+    }
+    history.close();
+    fclose(f);
+    unlink(stream.c_str());
+    unlink(store.c_str());
+    rmdir(dir);
+    return ok;
+}
+
+// With no base for the shard, an accepted last block asks the sender for
+// it; a block_idx off the end is rejected instead
+void testDeltaBlockRange() {
+    uint16_t last = 1u << (DELTA_BLOCKS - 1);
+    auto send = [&](TapWriter& w, uint8_t seq, uint8_t idx) {
+        uint8_t msg[MESH_MSG_MAX_SIZE];
+        TxSegment seg = {msg, buildDelta(msg, sizeof(msg), seq, idx, last)};
+        w.write(0x0002, MESH_ADDR_ALL, 1, GossipOpcode::WEIGHT_DELTA, &seg, 1);
+    };
+
+    uint64_t rejected = 0, control = 0;
+    bool ran = runStream([&](TapWriter& w) {
+        uint8_t seq = 0;
+        const uint8_t out_of_range[] = {DELTA_BLOCKS, 31, 40, 255};
+        for (uint8_t idx : out_of_range) {
+            send(w, seq++, idx);
+        }
+    }, rejected, control);
+    expect(ran && rejected == 4 && control == 0, "delta_block_range: out-of-range blocks rejected");
+
+    ran = runStream([&](TapWriter& w) { send(w, 0, DELTA_BLOCKS - 1); }, rejected, control);
+    expect(ran && rejected == 0 && control == 1, "delta_block_range: in-range block still handled");
+}
+
+}  // namespace
+
+int main() {
+    testDeltaBlockRange();
+
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
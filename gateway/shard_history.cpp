@@ -0,0 +1,158 @@
+/**
+ * Shard History - see shard_history.h
+ */
+
+#include "shard_history.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace planetary {
+namespace gateway {
+
+static_assert(sizeof(WeightShard) == WEIGHT_SHARD_SIZE, "Records are raw shard images");
+
+namespace {
+
+bool validRecord(const WeightShard& r, uint8_t shard_id) {
+    return r.header.shard_id == shard_id && r.header.contributors != 0 && r.verifyChecksum();
+}
+
+}  // namespace
+
+bool ShardHistory::open(const char* path, uint16_t depth) {
+    close();
+    if (depth == 0 || depth > MAX_DEPTH || 256 % depth != 0) {
+        fprintf(stderr, "shard_history: depth %u must divide 256 and be <= %u\n", depth,
+                MAX_DEPTH);
+        return false;
+    }
+
+    fd_ = ::open(path, O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) {
+        perror(path);
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd_, &st) != 0) {
+        perror(path);
+        close();
+        return false;
+    }
+
+    FileHeader fh;
+    bool fresh = st.st_size == 0;
+    if (!fresh) {
+        if (pread(fd_, &fh, sizeof(fh), 0) != static_cast<ssize_t>(sizeof(fh)) ||
+            fh.magic != MAGIC || fh.format != FORMAT || fh.shard_count != TOTAL_MODEL_SHARDS ||
+            fh.record_size != sizeof(WeightShard) || fh.depth == 0 || fh.depth > MAX_DEPTH ||
+            256 % fh.depth != 0) {
+            fprintf(stderr, "shard_history: %s is not a compatible shard history\n", path);
+            close();
+            return false;
+        }
+        depth = fh.depth;
+    }
+
+    depth_ = depth;
+    map_len_ = sizeof(WeightShard) * (1 + static_cast<size_t>(TOTAL_MODEL_SHARDS) * depth_);
+    if (fresh || static_cast<size_t>(st.st_size) < map_len_) {
+        if (ftruncate(fd_, static_cast<off_t>(map_len_)) != 0) {
+            perror(path);
+            close();
+            return false;
+        }
+    }
+
+    void* m = mmap(nullptr, map_len_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (m == MAP_FAILED) {
+        perror(path);
+        map_ = nullptr;
+        close();
+        return false;
+    }
+    map_ = static_cast<uint8_t*>(m);
+    records_ = reinterpret_cast<WeightShard*>(map_ + sizeof(WeightShard));
+
+    if (fresh) {
+        fh = {MAGIC, FORMAT, depth_, TOTAL_MODEL_SHARDS, sizeof(WeightShard)};
+        memcpy(map_, &fh, sizeof(fh));
+    }
+    recoverHeads();
+    return true;
+}
+
+void ShardHistory::close() {
+    if (map_) {
+        msync(map_, map_len_, MS_SYNC);
+        munmap(map_, map_len_);
+    }
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+    map_ = nullptr;
+    records_ = nullptr;
+    map_len_ = 0;
+}
+
+bool ShardHistory::sync() {
+    return map_ && msync(map_, map_len_, MS_SYNC) == 0;
+}
+
+// Versions are committed one after another, so the head is the intact
+// record whose successor slot does not hold the next version
+void ShardHistory::recoverHeads() {
+    for (uint8_t s = 0; s < TOTAL_MODEL_SHARDS; s++) {
+        has_head_[s] = false;
+        for (uint16_t p = 0; p < depth_; p++) {
+            const WeightShard& r = records_[static_cast<size_t>(s) * depth_ + p];
+            if (!validRecord(r, s)) continue;
+            uint8_t v = r.header.version;
+            const WeightShard& next = *record(s, static_cast<uint8_t>(v + 1));
+            bool superseded = validRecord(next, s) && next.header.version == static_cast<uint8_t>(v + 1);
+            if (!superseded || !has_head_[s]) {
+                head_version_[s] = v;
+                has_head_[s] = true;
+                if (!superseded) break;
+            }
+        }
+    }
+}
+
+bool ShardHistory::head(uint8_t shard_id, WeightShard& out) const {
+    if (shard_id >= TOTAL_MODEL_SHARDS || !records_) return false;
+    std::lock_guard<std::mutex> lock(locks_[shard_id]);
+    if (!has_head_[shard_id]) return false;
+    memcpy(&out, record(shard_id, head_version_[shard_id]), sizeof(WeightShard));
+    return true;
+}
+
+bool ShardHistory::headVersion(uint8_t shard_id, uint8_t& version) const {
+    if (shard_id >= TOTAL_MODEL_SHARDS || !records_) return false;
+    std::lock_guard<std::mutex> lock(locks_[shard_id]);
+    version = head_version_[shard_id];
+    return has_head_[shard_id];
+}
+
+bool ShardHistory::find(uint8_t shard_id, uint8_t version, WeightShard& out) const {
+    if (shard_id >= TOTAL_MODEL_SHARDS || !records_) return false;
+    std::lock_guard<std::mutex> lock(locks_[shard_id]);
+    const WeightShard* r = record(shard_id, version);
+    if (r->header.version != version || !validRecord(*r, shard_id)) return false;
+    memcpy(&out, r, sizeof(WeightShard));
+    return true;
+}
+
+void ShardHistory::commit(const WeightShard& shard) {
+    uint8_t s = shard.header.shard_id;
+    if (s >= TOTAL_MODEL_SHARDS || !records_) return;
+    std::lock_guard<std::mutex> lock(locks_[s]);
+    memcpy(record(s, shard.header.version), &shard, sizeof(WeightShard));
+    head_version_[s] = shard.header.version;
+    has_head_[s] = true;
+}
+
+}  // namespace gateway
+}  // namespace planetary
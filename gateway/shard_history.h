@@ -0,0 +1,91 @@
+/**
+ * Shard History - memory-mapped version history of every model shard
+ *
+ * One file holds the last HISTORY_DEPTH merged versions of each of the
+ * TOTAL_MODEL_SHARDS shards, as raw WeightShard images:
+ *
+ *   [FileHeader, padded to a record][record 0 of shard 0]...[depth - 1 of shard 63]
+ *
+ * Shard s, version v lives in record (s * depth + v % depth), so a
+ * version is found without an index and a commit overwrites the oldest
+ * one. Records carry their own ShardHeader and CRC: on open, each shard's
+ * newest intact record is its head again, and a torn write only costs
+ * that record. The kernel writes pages back on its own schedule; sync()
+ * forces it.
+ *
+ * Each shard's records are guarded by their own mutex, held for one 4KB
+ * copy; a shard is committed by a single merge worker.
+ */
+
+#ifndef SHARD_HISTORY_H
+#define SHARD_HISTORY_H
+
+#include "weight_shard.h"
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace planetary {
+namespace gateway {
+
+class ShardHistory {
+public:
+    static constexpr uint32_t MAGIC = 0x48534E50;  // "PNSH"
+    static constexpr uint16_t FORMAT = 1;
+    static constexpr uint16_t MAX_DEPTH = 128;    // Below the 8-bit version wrap
+
+    ShardHistory() = default;
+    ~ShardHistory() { close(); }
+
+    ShardHistory(const ShardHistory&) = delete;
+    ShardHistory& operator=(const ShardHistory&) = delete;
+
+    // Map `path`, creating it with `depth` records per shard if it does
+    // not exist; an existing file keeps its own depth. depth must divide
+    // 256 so versions map to records across the 8-bit wrap, and stay
+    // below it so the head can be told from the oldest record.
+    bool open(const char* path, uint16_t depth);
+    void close();
+    bool sync();
+
+    uint16_t depth() const { return depth_; }
+
+    // Newest committed version; false if the shard has none yet
+    bool head(uint8_t shard_id, WeightShard& out) const;
+    bool headVersion(uint8_t shard_id, uint8_t& version) const;
+
+    // A version still in the history. False once it has been overwritten.
+    bool find(uint8_t shard_id, uint8_t version, WeightShard& out) const;
+
+    // Store `shard` (checksum valid) as its shard's new head
+    void commit(const WeightShard& shard);
+
+private:
+    struct FileHeader {
+        uint32_t magic;
+        uint16_t format;
+        uint16_t depth;
+        uint32_t shard_count;
+        uint32_t record_size;
+    };
+
+    WeightShard* record(uint8_t shard_id, uint8_t version) const {
+        return &records_[static_cast<size_t>(shard_id) * depth_ + version % depth_];
+    }
+
+    void recoverHeads();
+
+    int          fd_ = -1;
+    uint8_t*     map_ = nullptr;
+    size_t       map_len_ = 0;
+    WeightShard* records_ = nullptr;
+    uint16_t     depth_ = 0;
+    bool         has_head_[TOTAL_MODEL_SHARDS] = {};
+    uint8_t      head_version_[TOTAL_MODEL_SHARDS] = {};
+    mutable std::mutex locks_[TOTAL_MODEL_SHARDS];
+};
+
+}  // namespace gateway
+}  // namespace planetary
+
+#endif  // SHARD_HISTORY_H
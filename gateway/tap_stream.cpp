@@ -0,0 +1,77 @@
+/**
+ * Tap Stream - see tap_stream.h
+ */
+
+#include "tap_stream.h"
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace planetary {
+namespace gateway {
+
+bool TapReader::readFully(uint8_t* dst, size_t len) {
+    while (len) {
+        ssize_t n = ::read(fd_, dst, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        dst += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool TapReader::next(TapMessage& out) {
+    for (;;) {
+        if (!readFully(buf_, sizeof(uint16_t))) return false;
+        uint16_t length = wire::load16(buf_);
+        if (length < TAP_FIXED_SIZE + VENDOR_OPCODE_SIZE ||
+            length > TAP_FIXED_SIZE + TAP_MAX_PAYLOAD) return false;
+        if (!readFully(buf_ + sizeof(uint16_t), length)) return false;
+
+        wire::View rec(buf_);
+        const uint8_t* access = buf_ + sizeof(TapRecordHeader);
+        wire::View op(access);
+        if (op.u16(1) != COMPANY_ID) continue;  // Another vendor's model
+
+        out.src = rec.u16(offsetof(TapRecordHeader, src));
+        out.dst = rec.u16(offsetof(TapRecordHeader, dst));
+        out.ttl = rec.u8(offsetof(TapRecordHeader, ttl));
+        out.opcode = op.u8(0);
+        out.params = access + VENDOR_OPCODE_SIZE;
+        out.len = length - TAP_FIXED_SIZE - VENDOR_OPCODE_SIZE;
+        return true;
+    }
+}
+
+bool TapWriter::write(uint16_t src, uint16_t dst, uint8_t ttl, GossipOpcode opcode,
+                      const TxSegment* segs, uint8_t count) {
+    uint8_t buf[sizeof(TapRecordHeader) + TAP_MAX_PAYLOAD];
+    size_t params = 0;
+    for (uint8_t i = 0; i < count; i++) params += segs[i].len;
+    if (VENDOR_OPCODE_SIZE + params > TAP_MAX_PAYLOAD) return false;
+
+    wire::Writer w(buf, sizeof(buf));
+    w.u16(static_cast<uint16_t>(TAP_FIXED_SIZE + VENDOR_OPCODE_SIZE + params));
+    w.u16(src);
+    w.u16(dst);
+    w.u8(ttl);
+    w.u8(static_cast<uint8_t>(opcode));
+    w.u16(COMPANY_ID);
+    for (uint8_t i = 0; i < count; i++) w.bytes(segs[i].data, segs[i].len);
+
+    const uint8_t* p = buf;
+    size_t left = w.size();
+    while (left) {
+        ssize_t n = ::write(fd_, p, left);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        left -= static_cast<size_t>(n);
+    }
+    bytes_ += w.size();
+    return true;
+}
+
+}  // namespace gateway
+}  // namespace planetary
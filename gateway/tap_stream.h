@@ -0,0 +1,83 @@
+/**
+ * Tap Stream - framing between the gateway and its mesh proxies
+ *
+ * A proxy bridge (cli/ble_mesh.py with a tap, or anything holding a mesh
+ * proxy connection) forwards every vendor model message it hears as one
+ * record, and injects every record the gateway sends back:
+ *
+ *   [u16 length][u16 src][u16 dst][u8 ttl][access payload...]
+ *
+ * `length` counts everything after itself. The access payload is what
+ * the SDK hands a vendor model: the 3-byte vendor opcode, then the
+ * parameters (gossip_codec.h). All fields little-endian.
+ *
+ * A link is a pair of file descriptors (a FIFO, a socket or a capture
+ * file). Reads block; a short or oversized record ends the link.
+ */
+
+#ifndef TAP_STREAM_H
+#define TAP_STREAM_H
+
+#include "gossip_codec.h"
+#include "neuron_config.h"
+#include <stddef.h>
+#include <stdint.h>
+
+namespace planetary {
+namespace gateway {
+
+struct TapRecordHeader {
+    uint16_t length;         // Bytes after this field
+    uint16_t src;            // Network source (the originating node)
+    uint16_t dst;            // MESH_ADDR_ALL, a group or a unicast node
+    uint8_t  ttl;
+} __attribute__((packed));
+
+constexpr size_t TAP_FIXED_SIZE = sizeof(TapRecordHeader) - sizeof(uint16_t);
+constexpr size_t TAP_MAX_PAYLOAD = MESH_MSG_MAX_SIZE;  // Opcode included
+
+// One decoded record; `params` points into the reader's buffer
+struct TapMessage {
+    uint16_t       src;
+    uint16_t       dst;
+    uint8_t        ttl;
+    uint8_t        opcode;   // First vendor opcode byte (GossipOpcode)
+    const uint8_t* params;   // After the vendor opcode
+    size_t         len;
+};
+
+class TapReader {
+public:
+    explicit TapReader(int fd) : fd_(fd) {}
+
+    // Next vendor message of our company, skipping any other. False at
+    // end of stream or on a malformed record.
+    bool next(TapMessage& out);
+
+private:
+    bool readFully(uint8_t* dst, size_t len);
+
+    int     fd_;
+    uint8_t buf_[sizeof(TapRecordHeader) + TAP_MAX_PAYLOAD];
+};
+
+class TapWriter {
+public:
+    explicit TapWriter(int fd) : fd_(fd) {}
+
+    // Frame and write one message from a gather list of parameters
+    bool write(uint16_t src, uint16_t dst, uint8_t ttl, GossipOpcode opcode,
+               const TxSegment* segs, uint8_t count);
+
+    // Bytes written so far, framing included
+    uint64_t bytesWritten() const { return bytes_; }
+
+private:
+    int      fd_;
+    uint64_t bytes_ = 0;
+};
+
+}  // namespace gateway
+}  // namespace planetary
+
+#endif  // TAP_STREAM_H
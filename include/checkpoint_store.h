@@ -0,0 +1,223 @@
+/**
+ * Checkpoint Store - Two-slot flash record for warm restart
+ *
+ * Training state that belongs to no shard (epoch, which shards were
+ * resident, the partial gradient accumulator, coherence) is kept as one
+ * record in one of two slots of FLASH_CHECKPOINT_SLOT_SECTORS sectors:
+ *
+ *   [state][reserved][seq:16][len:16][crc:16][payload 0..len)
+ *
+ * A write goes to the slot not holding the newest record, a page per
+ * writeStep(), and commits as ShardStore does: the CRC is programmed, then
+ * `state` flips WRITING -> COMMITTED. The older slot is then stale and
+ * maintenanceStep() erases it a sector per call, so the next write never
+ * waits for an erase. mount() picks the committed slot with the newest
+ * seq whose CRC matches; a write cut short leaves the previous record.
+ */
+
+#ifndef CHECKPOINT_STORE_H
+#define CHECKPOINT_STORE_H
+
+#include "neuron_config.h"
+#include "shard_store.h"
+#include "crc16.h"
+#include <stddef.h>
+#include <string.h>
+
+namespace planetary {
+
+struct CheckpointHeader {
+    uint8_t  state;          // STORE_WRITING, then STORE_COMMITTED
+    uint8_t  reserved;
+    uint16_t seq;            // Newer of the two slots wins (wrap-safe)
+    uint16_t len;            // Payload bytes
+    uint16_t crc;            // Over the payload, programmed just before commit
+} __attribute__((packed));
+
+class CheckpointStore {
+public:
+    static constexpr uint8_t  SLOTS = 2;
+    static constexpr uint8_t  NO_SLOT = 0xFF;
+    static constexpr uint32_t SLOT_SIZE = FLASH_CHECKPOINT_SLOT_SECTORS * FLASH_SECTOR_SIZE;
+    static constexpr uint32_t CAPACITY = SLOT_SIZE - sizeof(CheckpointHeader);
+    static constexpr uint32_t PAGE_SIZE = ShardStore::PAGE_SIZE;
+
+    CheckpointStore() : current_(NO_SLOT), stale_mask_(0), erase_cursor_(0), seq_(0),
+                        head_(nullptr), body_(nullptr), head_len_(0), body_len_(0),
+                        write_slot_(0), write_off_(0), write_crc_(0) {}
+
+    // Find the newest intact record. A slot that is neither it nor blank
+    // is stale and will be erased by maintenanceStep().
+    void mount() {
+        current_ = NO_SLOT;
+        stale_mask_ = 0;
+        erase_cursor_ = 0;
+        CheckpointHeader hdr[SLOTS];
+        bool intact[SLOTS];
+
+        for (uint8_t s = 0; s < SLOTS; s++) {
+            flashRead(slotAddr(s), sizeof(hdr[s]), reinterpret_cast<uint8_t*>(&hdr[s]));
+            intact[s] = hdr[s].state == STORE_COMMITTED && hdr[s].len <= CAPACITY &&
+                        payloadCrc(s, hdr[s].len) == hdr[s].crc;
+            if (intact[s] && (current_ == NO_SLOT ||
+                              static_cast<int16_t>(hdr[s].seq - hdr[current_].seq) > 0)) {
+                current_ = s;
+            }
+        }
+        for (uint8_t s = 0; s < SLOTS; s++) {
+            // Headers are programmed first: a blank one means an erased slot
+            if (s != current_ && !isBlank(hdr[s])) stale_mask_ |= 1u << s;
+        }
+        seq_ = (current_ != NO_SLOT) ? static_cast<uint16_t>(hdr[current_].seq + 1) : 0;
+    }
+
+    bool valid() const { return current_ != NO_SLOT; }
+
+    // Read the newest record back into the same two buffers it was written
+    // from; false (buffers untouched) if none or its length differs
+    bool load(void* head, uint16_t head_len, void* body, uint16_t body_len) const {
+        if (current_ == NO_SLOT) return false;
+        CheckpointHeader hdr;
+        flashRead(slotAddr(current_), sizeof(hdr), reinterpret_cast<uint8_t*>(&hdr));
+        if (hdr.len != head_len + body_len) return false;
+
+        uint32_t addr = slotAddr(current_) + sizeof(hdr);
+        flashRead(addr, head_len, static_cast<uint8_t*>(head));
+        flashRead(addr + head_len, body_len, static_cast<uint8_t*>(body));
+        return true;
+    }
+
+    // Start writing head then body as one record. Both must stay unchanged
+    // until writing() turns false. Fails while a write is in progress or
+    // the free slot has not been erased yet.
+    bool beginWrite(const void* head, uint16_t head_len, const void* body, uint16_t body_len) {
+        if (writing() || static_cast<uint32_t>(head_len) + body_len > CAPACITY) return false;
+        uint8_t slot = (current_ == NO_SLOT) ? 0 : static_cast<uint8_t>(current_ ^ 1);
+        if (stale_mask_ & (1u << slot)) return false;
+
+        head_ = static_cast<const uint8_t*>(head);
+        body_ = static_cast<const uint8_t*>(body);
+        head_len_ = head_len;
+        body_len_ = body_len;
+        write_slot_ = slot;
+        write_off_ = 0;
+        write_crc_ = crc16::INIT;
+        return true;
+    }
+
+    // Program the next page; returns true while more remain
+    bool writeStep() {
+        if (!head_) return false;
+
+        uint32_t addr = slotAddr(write_slot_);
+        uint16_t total = head_len_ + body_len_;
+        uint8_t page[PAGE_SIZE];
+        size_t n = 0;
+        size_t done = (write_off_ == 0) ? 0 : write_off_ - sizeof(CheckpointHeader);
+        if (write_off_ == 0) {
+            CheckpointHeader hdr;
+            hdr.state = STORE_WRITING;
+            hdr.reserved = 0xFF;
+            hdr.seq = seq_;
+            hdr.len = total;
+            hdr.crc = 0xFFFF;        // Left erased until commit
+            memcpy(page, &hdr, sizeof(hdr));
+            n = sizeof(hdr);
+        }
+        size_t chunk = PAGE_SIZE - n;
+        if (chunk > total - done) chunk = total - done;
+        copyPayload(page + n, done, chunk);
+        write_crc_ = crc16::update(write_crc_, page + n, chunk);
+        flashProgram(addr + write_off_, n + chunk, page);
+        write_off_ += PAGE_SIZE;
+
+        if (write_off_ < sizeof(CheckpointHeader) + total) return true;
+
+        // Commit last: a record cut short stays WRITING and is ignored
+        flashProgram(addr + offsetof(CheckpointHeader, crc), sizeof(write_crc_),
+                     reinterpret_cast<const uint8_t*>(&write_crc_));
+        uint8_t commit = STORE_COMMITTED;
+        flashProgram(addr, 1, &commit);
+
+        if (current_ != NO_SLOT) stale_mask_ |= 1u << current_;
+        current_ = write_slot_;
+        seq_++;
+        head_ = nullptr;
+        return false;
+    }
+
+    bool writing() const { return head_ != nullptr; }
+
+    // Erase one sector of the stale slot if the window fits an erase.
+    // Returns true while erasing remains.
+    bool maintenanceStep(uint32_t budget_us) {
+        if (!stale_mask_) return false;
+        if (budget_us < FLASH_ERASE_US) return true;
+
+        uint8_t s = static_cast<uint8_t>(__builtin_ctz(stale_mask_));
+        flashErase(slotAddr(s) + erase_cursor_ * FLASH_SECTOR_SIZE);
+        if (++erase_cursor_ < FLASH_CHECKPOINT_SLOT_SECTORS) return true;
+        stale_mask_ &= stale_mask_ - 1;
+        erase_cursor_ = 0;
+        return stale_mask_ != 0;
+    }
+
+private:
+    // Platform-specific flash access (implemented in src/flash/persistence.cpp)
+    void flashRead(uint32_t addr, size_t len, uint8_t* buf) const;
+    void flashProgram(uint32_t addr, size_t len, const uint8_t* data);
+    void flashErase(uint32_t addr);
+
+    static uint32_t slotAddr(uint8_t s) {
+        return FLASH_CHECKPOINT_BASE + static_cast<uint32_t>(s) * SLOT_SIZE;
+    }
+
+    static bool isBlank(const CheckpointHeader& hdr) {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(&hdr);
+        for (size_t i = 0; i < sizeof(hdr); i++) {
+            if (p[i] != STORE_ERASED) return false;
+        }
+        return true;
+    }
+
+    uint16_t payloadCrc(uint8_t s, uint16_t len) const {
+        uint8_t buf[PAGE_SIZE];
+        uint16_t crc = crc16::INIT;
+        uint32_t addr = slotAddr(s) + sizeof(CheckpointHeader);
+        for (uint16_t off = 0; off < len; off += PAGE_SIZE) {
+            size_t n = (static_cast<uint32_t>(len - off) < PAGE_SIZE) ? len - off : PAGE_SIZE;
+            flashRead(addr + off, n, buf);
+            crc = crc16::update(crc, buf, n);
+        }
+        return crc;
+    }
+
+    void copyPayload(uint8_t* dst, size_t pos, size_t len) const {
+        if (pos < head_len_) {
+            size_t n = (len < head_len_ - pos) ? len : head_len_ - pos;
+            memcpy(dst, head_ + pos, n);
+            dst += n;
+            pos += n;
+            len -= n;
+        }
+        if (len) memcpy(dst, body_ + (pos - head_len_), len);
+    }
+
+    uint8_t  current_;       // Slot with the newest intact record
+    uint8_t  stale_mask_;    // Bit per slot waiting to be erased
+    uint8_t  erase_cursor_;  // Next sector of the lowest stale slot
+    uint16_t seq_;           // For the next record
+
+    // Write in progress
+    const uint8_t* head_;
+    const uint8_t* body_;
+    uint16_t       head_len_;
+    uint16_t       body_len_;
+    uint8_t        write_slot_;
+    uint16_t       write_off_;
+    uint16_t       write_crc_;
+};
+
+}  // namespace planetary
+
+#endif  // CHECKPOINT_STORE_H
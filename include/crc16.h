@@ -0,0 +1,119 @@
+/**
+ * CRC16-CCITT Engine - Table-driven checksum for weight shards
+ *
+ * Polynomial 0x1021, init 0xFFFF, MSB-first, no final XOR.
+ * Bit-compatible with compute_crc16() in cli/vendor_model.py and
+ * the Android app.
+ *
+ * Engine is selected at compile time:
+ *   PLANETARY_CRC16_TABLE_BITS=8  byte table, 512 bytes flash (default)
+ *   PLANETARY_CRC16_TABLE_BITS=4  nibble table, 32 bytes flash
+ *
+ * The CRC is linear over GF(2), so an in-place edit of bytes [a, b)
+ * can be folded into an existing checksum without re-hashing the
+ * whole payload:
+ *
+ *   crc(new) = crc(old) ^ shiftZeros(raw(old[a..b) ^ new[a..b)), len - b)
+ *
+ * where raw() runs from a zero register. See WeightShard::patchChecksum().
+ */
+
+#ifndef CRC16_H
+#define CRC16_H
+
+#include "op_count.h"
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef PLANETARY_CRC16_TABLE_BITS
+#define PLANETARY_CRC16_TABLE_BITS 8
+#endif
+
+#if PLANETARY_CRC16_TABLE_BITS != 8 && PLANETARY_CRC16_TABLE_BITS != 4
+#error "PLANETARY_CRC16_TABLE_BITS must be 4 or 8"
+#endif
+
+namespace planetary {
+namespace crc16 {
+
+constexpr uint16_t POLY = 0x1021;
+constexpr uint16_t INIT = 0xFFFF;
+
+// Reference implementation: one shift/XOR per bit. Kept for verification.
+inline uint16_t updateBitwise(uint16_t crc, const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        crc ^= static_cast<uint16_t>(data[i]) << 8;
+        for (int j = 0; j < 8; j++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ POLY : crc << 1;
+        }
+    }
+    return crc;
+}
+
+// Lookup tables, generated at compile time into .rodata (flash)
+struct Tables {
+    static constexpr size_t ENTRIES = 1u << PLANETARY_CRC16_TABLE_BITS;
+
+    uint16_t step[ENTRIES];  // Register contribution of the top TABLE_BITS
+    uint16_t pow2[16];       // x^(8 * 2^k) mod POLY, for shiftZeros()
+
+    constexpr Tables() : step(), pow2() {
+        for (size_t i = 0; i < ENTRIES; i++) {
+            uint16_t crc = static_cast<uint16_t>(i << (16 - PLANETARY_CRC16_TABLE_BITS));
+            for (int j = 0; j < PLANETARY_CRC16_TABLE_BITS; j++) {
+                crc = (crc & 0x8000) ? (crc << 1) ^ POLY : crc << 1;
+            }
+            step[i] = crc;
+        }
+        // x^8 is one zero byte; square repeatedly for 2, 4, 8... bytes
+        pow2[0] = 0x0100;
+        for (int k = 1; k < 16; k++) {
+            pow2[k] = mulmod(pow2[k - 1], pow2[k - 1]);
+        }
+    }
+
+    // Polynomial product a * b mod POLY over GF(2)
+    static constexpr uint16_t mulmod(uint16_t a, uint16_t b) {
+        uint16_t r = 0;
+        for (int i = 15; i >= 0; i--) {
+            r = (r & 0x8000) ? (r << 1) ^ POLY : r << 1;
+            if (b & (1u << i)) r ^= a;
+        }
+        return r;
+    }
+};
+
+inline constexpr Tables TABLES{};
+
+// Advance the register by one byte
+inline uint16_t updateByte(uint16_t crc, uint8_t b) {
+#if PLANETARY_CRC16_TABLE_BITS == 8
+    return static_cast<uint16_t>((crc << 8) ^ TABLES.step[(crc >> 8) ^ b]);
+#else
+    crc = static_cast<uint16_t>((crc << 4) ^ TABLES.step[(crc >> 12) ^ (b >> 4)]);
+    return static_cast<uint16_t>((crc << 4) ^ TABLES.step[(crc >> 12) ^ (b & 0x0F)]);
+#endif
+}
+
+inline uint16_t update(uint16_t crc, const uint8_t* data, size_t len) {
+    PLANETARY_OPS(CRC, 0, len);
+    for (size_t i = 0; i < len; i++) {
+        crc = updateByte(crc, data[i]);
+    }
+    return crc;
+}
+
+// Register state after feeding `n` zero bytes: crc * x^(8n) mod POLY.
+// O(log n) instead of O(n) - used to carry a delta past unchanged bytes.
+// n must be below 64K (any shard payload).
+inline uint16_t shiftZeros(uint16_t crc, size_t n) {
+    for (int k = 0; n != 0 && crc != 0; k++, n >>= 1) {
+        if (n & 1) crc = Tables::mulmod(crc, TABLES.pow2[k]);
+    }
+    return crc;
+}
+
+}  // namespace crc16
+}  // namespace planetary
+
+#endif  // CRC16_H
@@ -0,0 +1,139 @@
+/**
+ * Gossip Codec - Wire encoding of the vendor model messages
+ *
+ * A gossip message is a SIG mesh access message: the 3-byte vendor
+ * opcode, then the parameters
+ *
+ *   [seq_num][flags][body...]
+ *
+ * The vendor opcode is (0xC0 | number) followed by COMPANY_ID, little-
+ * endian (vendorOpcode()); the SDK sends and strips it, so only the
+ * parameters pass through meshSend() and onReceive(). TTL, source and
+ * destination travel in the network PDU and are not repeated here.
+ * cli/vendor_model.py and the Android app use the same encoding.
+ *
+ * The packed structs in mesh_gossip.h fix each body's layout; nothing is
+ * read or written through them. A received body is read with explicit
+ * little-endian loads at offsetof() positions (View), so it may sit at
+ * any alignment - tc32 has no unaligned halfword load. A message goes
+ * out as a short head encoded with Writer plus a gather list of
+ * TxSegments that point at large bodies (shard bytes, delta bitmaps)
+ * where they already are.
+ */
+
+#ifndef GOSSIP_CODEC_H
+#define GOSSIP_CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+namespace planetary {
+
+// Vendor Model IDs (Telink's vendor range)
+constexpr uint32_t VENDOR_MODEL_ID = 0x0211;  // Company ID + Model
+constexpr uint16_t COMPANY_ID      = 0x0211;  // Telink
+
+// Opcode definitions (3-byte vendor opcodes)
+enum class GossipOpcode : uint8_t {
+    WEIGHT_UPDATE   = 0xC0,  // Reserved: a whole shard exceeds the MTU
+    WEIGHT_REQUEST  = 0xC1,  // Request shard
+    HEARTBEAT       = 0xC2,  // I'm alive
+    BACKPRESSURE    = 0xC3,  // Slow down!
+    SHARD_FRAGMENT  = 0xC4,  // Fragmented shard (for large transfers)
+    ACK             = 0xC5,  // Acknowledgment
+    WEIGHT_DELTA    = 0xC6,  // Sparse shard changes since a base version
+    NACK            = 0xC7,  // Missing fragments of a shard transfer
+    STATS           = 0xC8,  // Profile request (short) / reply (StatsPayload)
+    LEASE           = 0xC9   // Shard training lease (LeaseInfo)
+};
+
+constexpr uint8_t GOSSIP_OPCODE_FIRST = static_cast<uint8_t>(GossipOpcode::WEIGHT_UPDATE);
+constexpr uint8_t GOSSIP_OPCODE_COUNT = static_cast<uint8_t>(GossipOpcode::LEASE) - GOSSIP_OPCODE_FIRST + 1;
+constexpr size_t  VENDOR_OPCODE_SIZE  = 3;
+
+// Access-layer opcode as the SDK takes it: opcode byte, then company ID
+constexpr uint32_t vendorOpcode(GossipOpcode op) {
+    return static_cast<uint32_t>(op) | (static_cast<uint32_t>(COMPANY_ID) << 8);
+}
+
+// Leading parameters of every gossip message
+struct GossipHeader {
+    uint8_t  seq_num;        // For deduplication, per originating node
+    uint8_t  flags;
+} __attribute__((packed));
+
+// GossipHeader.flags
+constexpr uint8_t GOSSIP_FLAG_RETRANSMIT = 0x01;  // NACK repair: fills, never opens, a slot
+constexpr uint8_t GOSSIP_FLAG_REPLY      = 0x02;  // Unicast answer to a request or NACK
+constexpr uint8_t GOSSIP_FLAG_PACKED     = 0x04;  // SHARD_FRAGMENT bytes are kernels::pack_s8 blocks
+constexpr uint8_t GOSSIP_FLAG_DELTA      = 0x08;  // NACK of WEIGHT_DELTA blocks, not fragments
+
+// Bytes a message costs on air beyond its body
+constexpr size_t GOSSIP_OVERHEAD = VENDOR_OPCODE_SIZE + sizeof(GossipHeader);
+
+// One piece of an outgoing message's parameters
+struct TxSegment {
+    const uint8_t* data;
+    size_t         len;
+};
+
+constexpr uint8_t TX_MAX_SEGMENTS = 4;
+
+namespace wire {
+
+inline uint16_t load16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+inline void store16(uint8_t* p, uint16_t v) {
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+}
+
+// Read-only view of a received body; the caller has checked its length
+class View {
+public:
+    explicit View(const uint8_t* p) : p_(p) {}
+
+    uint8_t        u8(size_t off) const { return p_[off]; }
+    uint16_t       u16(size_t off) const { return load16(p_ + off); }
+    const uint8_t* at(size_t off) const { return p_ + off; }
+
+private:
+    const uint8_t* p_;
+};
+
+// Sequential little-endian encoder into a caller buffer
+class Writer {
+public:
+    Writer(uint8_t* buf, size_t cap) : buf_(buf), len_(0), cap_(cap) {}
+
+    void u8(uint8_t v) {
+        if (len_ < cap_) buf_[len_] = v;
+        len_++;
+    }
+    void u16(uint16_t v) {
+        if (len_ + 2 <= cap_) store16(buf_ + len_, v);
+        len_ += 2;
+    }
+    void bytes(const void* src, size_t n) {
+        if (len_ + n <= cap_) memcpy(buf_ + len_, src, n);
+        len_ += n;
+    }
+
+    // False once a write did not fit; what was written is then truncated
+    bool ok() const { return len_ <= cap_; }
+    size_t size() const { return len_; }
+    TxSegment segment() const { return {buf_, len_ <= cap_ ? len_ : cap_}; }
+
+private:
+    uint8_t* buf_;
+    size_t   len_;
+    size_t   cap_;
+};
+
+}  // namespace wire
+}  // namespace planetary
+
+#endif  // GOSSIP_CODEC_H
@@ -8,13 +8,35 @@
  *   - Hook into BLE stack's idle callback
  *   - Run AI in micro-bursts (5ms max)
  *   - Monitor chip temperature via ADC
- *   - Throttle/kill AI if thermal limits exceeded
+ *   - Throttle AI through the ThermalGovernor, kill it at TEMP_SHUTDOWN_C
+ *
+ * Tasks are scheduled earliest-deadline-first. Each task declares a
+ * period and a max burst; a task is released once per period and its
+ * deadline is the end of that period, so a task that keeps losing ages
+ * to the front of the queue and every task gets at least one burst per
+ * period when the load fits. Returning true ("wants more") keeps a task
+ * runnable without waiting for its next release. Several tasks run
+ * back-to-back until the idle window is used up; priority only breaks
+ * deadline ties.
+ *
+ * The guard band before the next BLE event adapts per link state. Each
+ * slice records the slippage it would have needed - how much earlier the
+ * event came than predicted, plus how far our tasks ran past the window -
+ * into a histogram. The guard shrinks slowly toward the p99 of that
+ * histogram and doubles after any overrun.
+ *
+ * Energy is accounted per task from its runtime at the power it declared
+ * on registration (CPU_ACTIVE_MW unless it also drives the flash), and
+ * summed once per duty window into getAIPowerMw().
  */
 
 #ifndef HW_SCHEDULER_H
 #define HW_SCHEDULER_H
 
 #include "neuron_config.h"
+#include "trace.h"
+#include "thermal_governor.h"
+#include <string.h>
 
 namespace planetary {
 
@@ -24,8 +46,17 @@ extern "C" {
     uint32_t blt_get_next_event_tick(void); // Next BLE event
     uint16_t adc_sample_temp(void);      // Read internal temp sensor
     void     cpu_sleep_wakeup(int, int, uint32_t);
+    uint8_t  blc_ll_getCurrentState(void); // BLS_LINK_STATE_* of the link layer
 }
 
+// Guard bands are tracked per BLE event type
+enum class BleEventType : uint8_t {
+    ADV  = 0,   // Advertising (mesh relay/beacon)
+    CONN = 1,   // Connection events (proxy/GATT)
+    SCAN = 2,   // Scanning and anything else
+    COUNT
+};
+
 enum class TaskState : uint8_t {
     IDLE,
     RUNNING,
@@ -50,20 +81,46 @@ struct ScheduledTask {
     TaskState    state;
     uint32_t     last_run_tick;
     uint32_t     total_runtime_us;
-    uint16_t     run_count;
+    uint32_t     run_count;
+    uint32_t     window_runtime_us;  // In the current duty window
+    uint8_t      duty_percent;       // Over the last full duty window
+    uint16_t     power_mw;           // Draw while running
+    uint32_t     energy_uj;          // Total, from runtime at power_mw (wraps)
+    uint16_t     period_ms;        // Released once per period
+    uint16_t     max_burst_us;     // Budget cap per run
+    bool         pending;          // Last run returned "wants more"
+    uint32_t     release_tick;     // Runnable from here when not pending
+    uint32_t     deadline_tick;    // EDF key
 };
 
 class HWScheduler {
 public:
     static constexpr uint8_t MAX_TASKS = 8;
     static constexpr uint32_t TICK_PER_US = 16;  // TLSR8258 @ 16MHz tick
+    static constexpr uint32_t MIN_BURST_US = 100;  // Not worth a context switch below
+    static constexpr uint8_t MAX_RUNS_PER_SLICE = 2 * MAX_TASKS;
+    static constexpr uint8_t SLIP_BUCKETS = 32;      // BLE_SLIP_BUCKET_US each
+
+    static_assert(MAX_TASKS <= TRACE_MAX_TASKS, "Trace duty snapshot holds every task");
+    static_assert(TICK_PER_US == TRACE_TICK_PER_US, "Trace scopes use the same tick");
+
+    HWScheduler() : task_count_(0), current_temp_c_(25), throttle_level_(0), last_thermal_tick_(0),
+                    overruns_(0), last_type_(0), duty_window_start_(0), ai_duty_percent_(0),
+                    ai_power_mw_(0) {
+        for (uint8_t t = 0; t < EVENT_TYPES; t++) {
+            guard_us_[t] = BLE_GUARD_US;
+            slip_samples_[t] = 0;
+        }
+        memset(slip_hist_, 0, sizeof(slip_hist_));
+    }
 
-    HWScheduler() : task_count_(0), current_temp_c_(25), throttle_level_(0) {}
-
-    // Register a task with the scheduler
-    bool registerTask(TaskCallback cb, void* ctx, TaskPriority prio) {
+    // Register a task with the scheduler. The first release is immediate.
+    bool registerTask(TaskCallback cb, void* ctx, TaskPriority prio,
+                      uint16_t period_ms, uint16_t max_burst_us,
+                      uint16_t power_mw = CPU_ACTIVE_MW) {
         if (task_count_ >= MAX_TASKS) return false;
 
+        uint32_t now = clock_time();
         tasks_[task_count_] = {
             .callback = cb,
             .context = ctx,
@@ -71,7 +128,16 @@ public:
             .state = TaskState::IDLE,
             .last_run_tick = 0,
             .total_runtime_us = 0,
-            .run_count = 0
+            .run_count = 0,
+            .window_runtime_us = 0,
+            .duty_percent = 0,
+            .power_mw = power_mw,
+            .energy_uj = 0,
+            .period_ms = period_ms,
+            .max_burst_us = max_burst_us,
+            .pending = false,
+            .release_tick = now,
+            .deadline_tick = now + periodTicks(period_ms)
         };
         task_count_++;
         return true;
@@ -80,6 +146,8 @@ public:
     // Call this from the BLE idle callback (blt_sdk_main_loop)
     void runSlice() {
         updateThermals();
+        rollDutyWindow();
+        rebaseStale(clock_time());
 
         if (throttle_level_ >= 100) {
             // Thermal emergency - no AI tasks
@@ -88,88 +156,267 @@ public:
 
         uint32_t now = clock_time();
         uint32_t next_ble = blt_get_next_event_tick();
-        uint32_t available_ticks = (next_ble > now + BLE_GUARD_US * TICK_PER_US)
-                                   ? (next_ble - now - BLE_GUARD_US * TICK_PER_US)
-                                   : 0;
-
-        if (available_ticks == 0) return;
+        uint8_t type = static_cast<uint8_t>(currentEventType());
+        last_type_ = type;
+        uint32_t guard_ticks = guard_us_[type] * TICK_PER_US;
+        int32_t lead = static_cast<int32_t>(next_ble - now);
+        if (lead <= static_cast<int32_t>(guard_ticks)) return;
+        uint32_t available_ticks = static_cast<uint32_t>(lead) - guard_ticks;
 
         // Convert to microseconds and apply throttle
         uint32_t budget_us = available_ticks / TICK_PER_US;
         if (budget_us > AI_TIMESLOT_US) budget_us = AI_TIMESLOT_US;
         budget_us = (budget_us * (100 - throttle_level_)) / 100;
 
-        if (budget_us < 100) return;  // Not worth context switch
+        if (budget_us < MIN_BURST_US) return;
 
-        // Find highest priority runnable task
-        ScheduledTask* best = nullptr;
-        for (uint8_t i = 0; i < task_count_; i++) {
-            if (tasks_[i].state == TaskState::KILLED) continue;
-            if (tasks_[i].state == TaskState::THROTTLED && throttle_level_ > 50) continue;
+        // Run tasks back-to-back until the window is spent
+        uint32_t window_end = now + budget_us * TICK_PER_US;
+        uint8_t runs = 0;
+        for (; runs < MAX_RUNS_PER_SLICE; runs++) {
+            uint32_t start = clock_time();
+            int32_t remaining = static_cast<int32_t>(window_end - start) / static_cast<int32_t>(TICK_PER_US);
+            if (remaining < static_cast<int32_t>(MIN_BURST_US)) break;
 
-            if (!best || tasks_[i].priority < best->priority) {
-                best = &tasks_[i];
-            }
-        }
+            ScheduledTask* task = pickTask(start);
+            if (!task) break;
 
-        if (!best) return;
+            uint32_t burst_us = static_cast<uint32_t>(remaining);
+            if (burst_us > task->max_burst_us) burst_us = task->max_burst_us;
 
-        // Run the task
-        uint32_t start = clock_time();
-        best->state = TaskState::RUNNING;
+            task->state = TaskState::RUNNING;
+            bool wants_more = task->callback(burst_us, task->context);
 
-        bool wants_more = best->callback(budget_us, best->context);
+            uint32_t elapsed = (clock_time() - start) / TICK_PER_US;
+            task->total_runtime_us += elapsed;
+            task->window_runtime_us += elapsed;
+            task->run_count++;
+            task->last_run_tick = start;
+            task->state = TaskState::IDLE;
+            completeRun(*task, start, wants_more);
+        }
 
-        uint32_t elapsed = (clock_time() - start) / TICK_PER_US;
-        best->total_runtime_us += elapsed;
-        best->run_count++;
-        best->last_run_tick = now;
-        best->state = wants_more ? TaskState::IDLE : TaskState::IDLE;
+        if (runs > 0) recordSlippage(type, next_ble, window_end);
     }
 
-    // Get current thermal throttle percentage
+    // Governor output: % of AI budget withheld, 100 while killed
     uint8_t getThrottleLevel() const { return throttle_level_; }
-    uint8_t getCurrentTemp() const { return current_temp_c_; }
+    uint8_t getCurrentTemp() const { return current_temp_c_; }  // Filtered, whole C
+    const ThermalGovernor& getGovernor() const { return governor_; }
+
+    // Adaptive guard band for the link state seen by the last slice
+    uint16_t getGuardUs() const { return guard_us_[last_type_]; }
+    uint16_t getGuardUs(BleEventType type) const { return guard_us_[static_cast<uint8_t>(type)]; }
+
+    // Overruns since the last call (reported once per heartbeat)
+    uint8_t takeOverruns() {
+        uint8_t n = overruns_;
+        overruns_ = 0;
+        return n;
+    }
 
-    // Duty cycle tracking
-    uint8_t getAIDutyCycle() const {
-        uint32_t total = 0;
+    // Duty cycle: % of the last full DUTY_WINDOW_MS spent in AI tasks
+    uint8_t getAIDutyCycle() const { return ai_duty_percent_; }
+    uint8_t getTaskDutyCycle(uint8_t task) const {
+        return task < task_count_ ? tasks_[task].duty_percent : 0;
+    }
+
+    // Energy: mean AI draw over the last full duty window, per-task totals
+    uint16_t getAIPowerMw() const { return ai_power_mw_; }
+    uint32_t getTaskEnergyUj(uint8_t task) const {
+        return task < task_count_ ? tasks_[task].energy_uj : 0;
+    }
+
+private:
+    static constexpr uint32_t periodTicks(uint16_t period_ms) {
+        return static_cast<uint32_t>(period_ms) * 1000 * TICK_PER_US;
+    }
+
+    // Close the duty window once DUTY_WINDOW_MS has passed and publish it
+    void rollDutyWindow() {
+        uint32_t now = clock_time();
+        uint32_t window_us = (now - duty_window_start_) / TICK_PER_US;
+        if (window_us < DUTY_WINDOW_MS * 1000) return;
+
+        uint8_t task_duty[MAX_TASKS];
+        uint32_t ai_us = 0;
+        uint32_t ai_uj = 0;
         for (uint8_t i = 0; i < task_count_; i++) {
-            if (tasks_[i].priority >= TaskPriority::NORMAL) {
-                total += tasks_[i].total_runtime_us;
+            ScheduledTask& t = tasks_[i];
+            uint32_t uj = static_cast<uint32_t>(
+                static_cast<uint64_t>(t.window_runtime_us) * t.power_mw / 1000);
+            ai_us += t.window_runtime_us;
+            ai_uj += uj;
+            t.energy_uj += uj;
+            t.duty_percent = dutyPercent(t.window_runtime_us, window_us);
+            t.window_runtime_us = 0;
+            task_duty[i] = t.duty_percent;
+        }
+        ai_duty_percent_ = dutyPercent(ai_us, window_us);
+        ai_power_mw_ = static_cast<uint16_t>(ai_uj / (window_us / 1000));
+        duty_window_start_ = now;
+        g_trace.publishDuty(ai_duty_percent_, task_duty, task_count_);
+    }
+
+    static uint8_t dutyPercent(uint32_t busy_us, uint32_t window_us) {
+        uint32_t pct = (busy_us / 16) * 100 / (window_us / 16);  // No overflow up to ~11 min
+        return static_cast<uint8_t>(pct > 100 ? 100 : pct);
+    }
+
+    // Earliest deadline among runnable tasks; priority breaks ties
+    ScheduledTask* pickTask(uint32_t now) {
+        ScheduledTask* best = nullptr;
+        for (uint8_t i = 0; i < task_count_; i++) {
+            ScheduledTask& t = tasks_[i];
+            if (t.state == TaskState::KILLED) continue;
+            if (t.state == TaskState::THROTTLED && throttle_level_ > 50) continue;
+            if (!t.pending && static_cast<int32_t>(now - t.release_tick) < 0) continue;
+
+            if (!best) {
+                best = &t;
+                continue;
+            }
+            int32_t lead = static_cast<int32_t>(t.deadline_tick - best->deadline_tick);
+            if (lead < 0 || (lead == 0 && t.priority < best->priority)) {
+                best = &t;
             }
         }
-        // Rough estimate over last second
-        return static_cast<uint8_t>((total / 10000) % 100);
+        return best;
     }
 
-private:
-    void updateThermals() {
-        // Read temp every ~100 calls to avoid ADC overhead
-        static uint8_t sample_counter = 0;
-        if (++sample_counter < 100) return;
-        sample_counter = 0;
-
-        // TLSR8258 internal temp sensor (rough calibration)
-        uint16_t raw = adc_sample_temp();
-        current_temp_c_ = (raw - 1100) / 4;  // Approximate conversion
-
-        // Progressive throttling
-        if (current_temp_c_ >= TEMP_SHUTDOWN_C) {
-            throttle_level_ = 100;  // Kill all AI
-        } else if (current_temp_c_ >= TEMP_THROTTLE_C) {
-            // Linear throttle from 55C (0%) to 70C (100%)
-            throttle_level_ = ((current_temp_c_ - TEMP_THROTTLE_C) * 100) /
-                              (TEMP_SHUTDOWN_C - TEMP_THROTTLE_C);
+    // Tick differences only order within 2^31 ticks (~134s), and a task
+    // that does not run (AI killed, or starved) is never re-based by
+    // completeRun(). Every slice, killed ones included, pulls a release or
+    // deadline more than a period behind up to a period behind: overdue
+    // tasks stay runnable and keep their EDF order within that bound.
+    void rebaseStale(uint32_t now) {
+        for (uint8_t i = 0; i < task_count_; i++) {
+            ScheduledTask& t = tasks_[i];
+            int32_t period = static_cast<int32_t>(periodTicks(t.period_ms));
+            if (static_cast<int32_t>(now - t.release_tick) > period) t.release_tick = now - period;
+            if (static_cast<int32_t>(now - t.deadline_tick) > period) t.deadline_tick = now - period;
+        }
+    }
+
+    // Next release and deadline after a run that started at `start`
+    void completeRun(ScheduledTask& t, uint32_t start, bool wants_more) {
+        uint32_t period = periodTicks(t.period_ms);
+        t.pending = wants_more;
+        if (wants_more) {
+            // Stay runnable, but queue behind tasks whose deadlines are nearer
+            t.deadline_tick = start + period;
+            return;
+        }
+        // Keep the release grid unless the task fell more than a period behind
+        t.release_tick += period;
+        if (static_cast<int32_t>(start - t.release_tick) >= 0) t.release_tick = start + period;
+        t.deadline_tick = t.release_tick + period;
+    }
+
+    static constexpr uint8_t EVENT_TYPES = static_cast<uint8_t>(BleEventType::COUNT);
+    static constexpr uint16_t SLIP_DECAY_SAMPLES = 2048;  // Halve the histogram here
+    static constexpr uint8_t  SLIP_ADAPT_EVERY = 32;      // Samples between shrink steps
+    static constexpr uint16_t SLIP_MIN_SAMPLES = 128;     // Before trusting the p99
+
+    // Link-layer state bits (BLS_LINK_STATE_* in the Telink SDK)
+    static constexpr uint8_t LL_STATE_ADV  = 0x01;
+    static constexpr uint8_t LL_STATE_CONN = 0x08;
+
+    static BleEventType currentEventType() {
+        uint8_t state = blc_ll_getCurrentState();
+        if (state & LL_STATE_CONN) return BleEventType::CONN;
+        if (state & LL_STATE_ADV) return BleEventType::ADV;
+        return BleEventType::SCAN;
+    }
+
+    // The guard this slice needed: how much earlier the event now falls
+    // than predicted at entry, plus how far the tasks ran past the window
+    void recordSlippage(uint8_t type, uint32_t predicted, uint32_t window_end) {
+        uint32_t end = clock_time();
+        uint32_t next_ble = blt_get_next_event_tick();
+
+        int32_t early = static_cast<int32_t>(predicted - next_ble);
+        int32_t late = static_cast<int32_t>(end - window_end);
+        uint32_t needed_us = (early > 0 ? early : 0) / TICK_PER_US +
+                             (late > 0 ? late : 0) / TICK_PER_US;
+
+        uint8_t bucket = needed_us / BLE_SLIP_BUCKET_US;
+        if (bucket >= SLIP_BUCKETS) bucket = SLIP_BUCKETS - 1;
+        slip_hist_[type][bucket]++;
+        if (++slip_samples_[type] >= SLIP_DECAY_SAMPLES) {
+            slip_samples_[type] = 0;
+            for (uint8_t b = 0; b < SLIP_BUCKETS; b++) {
+                slip_hist_[type][b] >>= 1;
+                slip_samples_[type] += slip_hist_[type][b];
+            }
+        }
+
+        uint16_t& guard = guard_us_[type];
+        if (static_cast<int32_t>(next_ble - end) < 0) {
+            // Touched the BLE event: back off hard
+            if (overruns_ < 0xFF) overruns_++;
+            uint32_t grown = guard * 2;
+            if (grown < needed_us + BLE_GUARD_MARGIN_US) grown = needed_us + BLE_GUARD_MARGIN_US;
+            guard = grown > BLE_GUARD_MAX_US ? BLE_GUARD_MAX_US : grown;
+            return;
+        }
+
+        uint16_t total = slip_samples_[type];
+        if (total < SLIP_MIN_SAMPLES || total % SLIP_ADAPT_EVERY != 0) return;
+
+        uint32_t target = percentileUs(type, total) + BLE_GUARD_MARGIN_US;
+        if (target < BLE_GUARD_MIN_US) target = BLE_GUARD_MIN_US;
+        if (target > BLE_GUARD_MAX_US) target = BLE_GUARD_MAX_US;
+        if (target >= guard) {
+            guard = target;
         } else {
-            throttle_level_ = 0;
+            guard -= (guard - target + 7) / 8;  // Shrink gently
+        }
+    }
+
+    // Upper edge of the bucket holding the 99th percentile
+    uint32_t percentileUs(uint8_t type, uint16_t total) const {
+        uint16_t allowed = total / 100;
+        uint16_t above = 0;
+        for (int b = SLIP_BUCKETS - 1; b > 0; b--) {
+            above += slip_hist_[type][b];
+            if (above > allowed) {
+                return (b == SLIP_BUCKETS - 1) ? BLE_GUARD_MAX_US : (b + 1) * BLE_SLIP_BUCKET_US;
+            }
         }
+        return BLE_SLIP_BUCKET_US;
+    }
+
+    // One sensor read per THERMAL_SAMPLE_MS (the governor's time base),
+    // the first on the first slice
+    void updateThermals() {
+        uint32_t now = clock_time();
+        if (governor_.primed() &&
+            now - last_thermal_tick_ < periodTicks(THERMAL_SAMPLE_MS)) return;
+        last_thermal_tick_ = now;
+
+        throttle_level_ = governor_.update(adc_sample_temp());
+        current_temp_c_ = governor_.temperatureC();
     }
 
     ScheduledTask tasks_[MAX_TASKS];
     uint8_t       task_count_;
     uint8_t       current_temp_c_;
     uint8_t       throttle_level_;
+    ThermalGovernor governor_;
+    uint32_t      last_thermal_tick_;
+
+    // Adaptive BLE guard band
+    uint16_t      guard_us_[EVENT_TYPES];
+    uint16_t      slip_hist_[EVENT_TYPES][SLIP_BUCKETS];
+    uint16_t      slip_samples_[EVENT_TYPES];  // Histogram total
+    uint8_t       overruns_;
+    uint8_t       last_type_;
+
+    // Rolling duty window
+    uint32_t      duty_window_start_;
+    uint8_t       ai_duty_percent_;
+    uint16_t      ai_power_mw_;
 };
 
 }  // namespace planetary
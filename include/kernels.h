@@ -0,0 +1,477 @@
+/**
+ * Fixed-Point Kernels - int8 MAC and update loops for the tc32 core
+ *
+ * The tc32 has no SIMD unit and no FPU, so these kernels use
+ * SIMD-within-a-register (SWAR) tricks on plain 32-bit registers:
+ *   - word loads/stores: four int8 lanes per memory access
+ *   - 2 x int16 lanes per multiply where the product range allows it
+ *   - branchless byte-lane saturating add (no per-weight clamp branches)
+ *   - offset-binary blend for FedAvg (no per-weight divide)
+ *   - word-wide width scan for the lossless block packer (shard fragments)
+ *
+ * Every kernel has a scalar reference in kernels::ref with bit-identical
+ * results, kept for verification. Build with -DPLANETARY_KERNELS_SCALAR
+ * to route every caller to the reference path.
+ *
+ * Packed paths need 4-byte aligned pointers. Misaligned inputs (e.g. a
+ * shard viewed in place inside a mesh payload) fall back to scalar.
+ *
+ * Word and byte steps are reported to op_count.h for the host cycle model.
+ */
+
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include "crc16.h"
+#include "op_count.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+namespace planetary {
+namespace kernels {
+
+inline int8_t sat8(int32_t v) {
+    return static_cast<int8_t>((v > 127) ? 127 : ((v < -128) ? -128 : v));
+}
+
+// xorshift32 (Marsaglia): stochastic-rounding noise. State must be nonzero.
+inline uint32_t xorshift32(uint32_t& s) {
+    s ^= s << 13;
+    s ^= s >> 17;
+    s ^= s << 5;
+    return s;
+}
+
+// floor((x * scale_q24 + r) / 2^24) with r the low 24 bits of the next
+// draw: an unbiased rounding of x * scale_q24 / 2^24
+inline int32_t sround_q24(int32_t x, int32_t scale_q24, uint32_t& rng) {
+    return (x * scale_q24 + static_cast<int32_t>(xorshift32(rng) & 0xFFFFFF)) >> 24;
+}
+
+// Set bits in n bytes (change bitmaps)
+inline uint32_t count_bits(const uint8_t* p, size_t n) {
+    uint32_t c = 0;
+    for (size_t i = 0; i < n; i++) c += static_cast<uint32_t>(__builtin_popcount(p[i]));
+    return c;
+}
+
+// pack_s8 block: PACK_BLOCK values share one width byte
+constexpr size_t PACK_BLOCK = 32;
+
+//-----------------------------------------------------------------------------
+// Scalar reference implementations
+//-----------------------------------------------------------------------------
+namespace ref {
+
+// sum(a[i] * b[i])
+inline int32_t dot_s8(const int8_t* a, const int8_t* b, size_t n) {
+    PLANETARY_OPS(DOT, 0, n);
+    int32_t sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        sum += static_cast<int32_t>(a[i]) * b[i];
+    }
+    return sum;
+}
+
+// out[i] = sat8((x[i] * k) >> shift)
+inline void scale_s8(const int8_t* x, int8_t k, uint8_t shift, int8_t* out, size_t n) {
+    PLANETARY_OPS(SCALE, 0, n);
+    for (size_t i = 0; i < n; i++) {
+        out[i] = sat8((static_cast<int32_t>(x[i]) * k) >> shift);
+    }
+}
+
+// acc[i] += a[i] * k  (backprop through a weight row)
+inline void axpy_s8(int32_t* acc, const int8_t* a, int8_t k, size_t n) {
+    PLANETARY_OPS(AXPY, 0, n);
+    for (size_t i = 0; i < n; i++) {
+        acc[i] += static_cast<int32_t>(a[i]) * k;
+    }
+}
+
+// SGD step with stochastic rounding, one xorshift32 draw per weight in
+// index order: w[i] = sat8(w[i] + sat8(-sround_q24(g[i], scale_q24)))
+// for i in [begin, n). Fractional steps move a weight with matching
+// probability instead of truncating to zero. |g * scale_q24| < 2^30.
+// Returns diff_crc advanced over (old ^ new) of every weight touched.
+// If `changed` is set, bit i is raised for every weight that moved.
+inline uint16_t sgd_s8(int8_t* w, const int8_t* g, size_t n, int32_t scale_q24, uint32_t& rng,
+                       uint16_t diff_crc, uint8_t* changed = nullptr, size_t begin = 0) {
+    PLANETARY_OPS(SGD, 0, n > begin ? n - begin : 0);
+    for (size_t i = begin; i < n; i++) {
+        int8_t step = sat8(-sround_q24(g[i], scale_q24, rng));
+        int8_t nw = sat8(static_cast<int32_t>(w[i]) + step);
+        diff_crc = crc16::updateByte(diff_crc, static_cast<uint8_t>(w[i] ^ nw));
+        if (changed && nw != w[i]) changed[i >> 3] |= 1u << (i & 7);
+        w[i] = nw;
+    }
+    return diff_crc;
+}
+
+// Convex blend: dst = (dst * (256 - alpha) + src * alpha) / 256, rounded,
+// computed in offset binary (value + 128) so every term is unsigned.
+inline void blend_s8(int8_t* dst, const int8_t* src, size_t n, uint16_t alpha_q8) {
+    PLANETARY_OPS(BLEND, 0, n);
+    uint32_t keep = 256 - alpha_q8;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t d = static_cast<uint32_t>(dst[i] + 128);
+        uint32_t s = static_cast<uint32_t>(src[i] + 128);
+        dst[i] = static_cast<int8_t>(static_cast<int32_t>((d * keep + s * alpha_q8 + 128) >> 8) - 128);
+    }
+}
+
+// Number of i with a[i] != b[i]; with `changed` (optional), each sets
+// bit first + i there
+inline size_t mark_diff_s8(const int8_t* a, const int8_t* b, size_t n, uint8_t* changed = nullptr,
+                           size_t first = 0) {
+    PLANETARY_OPS(DIFF, 0, n);
+    size_t c = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (a[i] == b[i]) continue;
+        c++;
+        if (changed) changed[(first + i) >> 3] |= 1u << ((first + i) & 7);
+    }
+    return c;
+}
+
+// Bits to hold every value of a block in two's complement, from the OR of
+// the values' magnitude bits (v ^ sign) and the OR of the values: 0 for
+// an all-zero block, else 1-8
+inline uint8_t packWidthOf(uint8_t mag, uint8_t any) {
+    if (!any) return 0;
+    return static_cast<uint8_t>(mag ? 33 - __builtin_clz(mag) : 1);
+}
+
+inline uint8_t packWidth(const int8_t* p, size_t n) {
+    uint8_t mag = 0, any = 0;
+    for (size_t i = 0; i < n; i++) {
+        mag |= static_cast<uint8_t>(p[i] ^ (p[i] >> 7));
+        any |= static_cast<uint8_t>(p[i]);
+    }
+    return packWidthOf(mag, any);
+}
+
+// Bytes pack_s8 spends on n values of width w (width byte included)
+inline size_t packedBlockSize(size_t n, uint8_t w) {
+    return 1 + (n * w + 7) / 8;
+}
+
+// One block: width byte, then each value's low w bits, LSB first
+inline size_t packBlock(const int8_t* src, size_t n, uint8_t w, uint8_t* out) {
+    size_t o = 0;
+    out[o++] = w;
+    uint32_t acc = 0;
+    unsigned bits = 0;
+    uint32_t mask = (1u << w) - 1;
+    for (size_t i = 0; i < n && w; i++) {
+        acc |= (static_cast<uint8_t>(src[i]) & mask) << bits;
+        for (bits += w; bits >= 8; bits -= 8) {
+            out[o++] = static_cast<uint8_t>(acc);
+            acc >>= 8;
+        }
+    }
+    if (bits) out[o++] = static_cast<uint8_t>(acc);
+    return o;
+}
+
+// Lossless block packing: every PACK_BLOCK values become a width byte w
+// and the values as w-bit two's complement (w = 0: all zero). Returns the
+// packed length, or 0 if it would exceed `cap`.
+inline size_t pack_s8(const int8_t* src, size_t n, uint8_t* out, size_t cap) {
+    PLANETARY_OPS(PACK, 0, n);
+    size_t o = 0;
+    for (size_t b = 0; b < n; b += PACK_BLOCK) {
+        size_t m = (n - b < PACK_BLOCK) ? n - b : PACK_BLOCK;
+        uint8_t w = packWidth(src + b, m);
+        if (o + packedBlockSize(m, w) > cap) return 0;
+        o += packBlock(src + b, m, w, out + o);
+    }
+    return o;
+}
+
+// Inverse of pack_s8: exactly n values out of in[0, len). Returns the
+// bytes consumed, or 0 if the input is short or malformed.
+inline size_t unpack_s8(const uint8_t* in, size_t len, int8_t* out, size_t n) {
+    PLANETARY_OPS(UNPACK, 0, n);
+    size_t o = 0;
+    for (size_t b = 0; b < n; b += PACK_BLOCK) {
+        size_t m = (n - b < PACK_BLOCK) ? n - b : PACK_BLOCK;
+        if (o >= len || in[o] > 8) return 0;
+        uint8_t w = in[o++];
+        size_t end = o + packedBlockSize(m, w) - 1;
+        if (end > len) return 0;
+        if (w == 0) {
+            memset(out + b, 0, m);
+            continue;
+        }
+        uint32_t acc = 0;
+        unsigned bits = 0;
+        for (size_t i = 0; i < m; i++) {
+            for (; bits < w; bits += 8) acc |= static_cast<uint32_t>(in[o++]) << bits;
+            out[b + i] = static_cast<int8_t>(static_cast<int32_t>(acc << (32 - w)) >> (32 - w));
+            acc >>= w;
+            bits -= w;
+        }
+        o = end;
+    }
+    return o;
+}
+
+}  // namespace ref
+
+//-----------------------------------------------------------------------------
+// SWAR helpers
+//-----------------------------------------------------------------------------
+inline bool aligned4(const void* p) {
+    return (reinterpret_cast<uintptr_t>(p) & 3) == 0;
+}
+
+inline uint32_t load32(const int8_t* p) {
+    uint32_t v;
+    memcpy(&v, __builtin_assume_aligned(p, 4), sizeof(v));
+    return v;
+}
+
+inline void store32(int8_t* p, uint32_t v) {
+    memcpy(__builtin_assume_aligned(p, 4), &v, sizeof(v));
+}
+
+// Sign-extended byte lane k (0 = lowest address, little-endian)
+inline int32_t lane(uint32_t w, int k) {
+    return static_cast<int32_t>(w << (24 - 8 * k)) >> 24;
+}
+
+// Byte lanes 0,2 (or 1,3 after >> 8) as a signed 2 x int16 composite:
+// the 32-bit value equals lo + hi * 65536 exactly, borrows included.
+inline uint32_t spread16(uint32_t w) {
+    return ((w & 0x00FF00FFu) ^ 0x00800080u) - 0x00800080u;
+}
+
+// Split a 2 x int16 composite back into its lanes; |lo| must be < 32768
+inline void unspread16(uint32_t c, int32_t& lo, int32_t& hi) {
+    lo = static_cast<int16_t>(c & 0xFFFF);
+    hi = static_cast<int32_t>(c - static_cast<uint32_t>(lo)) >> 16;
+}
+
+// One bit per nonzero byte lane: lane k -> bit k
+inline uint8_t nonzeroLanes(uint32_t w) {
+    w |= w >> 4;
+    w |= w >> 2;
+    w |= w >> 1;
+    return static_cast<uint8_t>(((w & 0x01010101u) * 0x01020408u) >> 24) & 0x0F;
+}
+
+// Number of nonzero byte lanes
+inline uint32_t nonzeroLaneCount(uint32_t w) {
+    w |= w >> 4;
+    w |= w >> 2;
+    w |= w >> 1;
+    return ((w & 0x01010101u) * 0x01010101u) >> 24;
+}
+
+// Four signed saturating byte adds in one register
+inline uint32_t sat_add_s8x4(uint32_t a, uint32_t b) {
+    uint32_t s = ((a & 0x7F7F7F7Fu) + (b & 0x7F7F7F7Fu)) ^ ((a ^ b) & 0x80808080u);
+    uint32_t ov = ~(a ^ b) & (a ^ s) & 0x80808080u;  // Same-sign inputs, sign flipped
+    uint32_t mask = (ov >> 7) * 0xFFu;               // Full-lane mask per overflow
+    uint32_t sat = 0x7F7F7F7Fu + ((a & ov) >> 7);    // 0x7F, or 0x80 if a < 0
+    return (s & ~mask) | (sat & mask);
+}
+
+//-----------------------------------------------------------------------------
+// Kernels
+//-----------------------------------------------------------------------------
+#ifdef PLANETARY_KERNELS_SCALAR
+
+using ref::dot_s8;
+using ref::scale_s8;
+using ref::axpy_s8;
+using ref::sgd_s8;
+using ref::blend_s8;
+using ref::mark_diff_s8;
+using ref::pack_s8;
+using ref::unpack_s8;
+
+#else
+
+// Dot product: two word loads feed four MACs
+inline int32_t dot_s8(const int8_t* a, const int8_t* b, size_t n) {
+    if (!aligned4(a) || !aligned4(b)) return ref::dot_s8(a, b, n);
+
+    int32_t sum = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        uint32_t wa = load32(a + i);
+        uint32_t wb = load32(b + i);
+        sum += lane(wa, 0) * lane(wb, 0);
+        sum += lane(wa, 1) * lane(wb, 1);
+        sum += lane(wa, 2) * lane(wb, 2);
+        sum += lane(wa, 3) * lane(wb, 3);
+    }
+    PLANETARY_OPS(DOT, i / 4, 0);
+    return sum + ref::dot_s8(a + i, b + i, n - i);
+}
+
+// Scale by an int8 factor: one multiply yields two lanes (|x * k| <= 16384)
+inline void scale_s8(const int8_t* x, int8_t k, uint8_t shift, int8_t* out, size_t n) {
+    if (!aligned4(x) || !aligned4(out)) {
+        ref::scale_s8(x, k, shift, out, n);
+        return;
+    }
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        uint32_t w = load32(x + i);
+        int32_t p0, p1, p2, p3;
+        unspread16(spread16(w) * static_cast<uint32_t>(static_cast<int32_t>(k)), p0, p2);
+        unspread16(spread16(w >> 8) * static_cast<uint32_t>(static_cast<int32_t>(k)), p1, p3);
+        store32(out + i,
+                static_cast<uint8_t>(sat8(p0 >> shift)) |
+                static_cast<uint32_t>(static_cast<uint8_t>(sat8(p1 >> shift))) << 8 |
+                static_cast<uint32_t>(static_cast<uint8_t>(sat8(p2 >> shift))) << 16 |
+                static_cast<uint32_t>(static_cast<uint8_t>(sat8(p3 >> shift))) << 24);
+    }
+    PLANETARY_OPS(SCALE, i / 4, 0);
+    ref::scale_s8(x + i, k, shift, out + i, n - i);
+}
+
+// Row accumulate: one multiply yields two lanes (|a * k| <= 16384)
+inline void axpy_s8(int32_t* acc, const int8_t* a, int8_t k, size_t n) {
+    if (!aligned4(a)) {
+        ref::axpy_s8(acc, a, k, n);
+        return;
+    }
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        uint32_t w = load32(a + i);
+        int32_t p0, p1, p2, p3;
+        unspread16(spread16(w) * static_cast<uint32_t>(static_cast<int32_t>(k)), p0, p2);
+        unspread16(spread16(w >> 8) * static_cast<uint32_t>(static_cast<int32_t>(k)), p1, p3);
+        acc[i] += p0;
+        acc[i + 1] += p1;
+        acc[i + 2] += p2;
+        acc[i + 3] += p3;
+    }
+    PLANETARY_OPS(AXPY, i / 4, 0);
+    ref::axpy_s8(acc + i, a + i, k, n - i);
+}
+
+// SGD step: steps packed four to a word (same draws, same order as the
+// reference), one branchless saturating add, and the checksum delta taken
+// from the word XOR
+inline uint16_t sgd_s8(int8_t* w, const int8_t* g, size_t n, int32_t scale_q24, uint32_t& rng,
+                       uint16_t diff_crc, uint8_t* changed = nullptr) {
+    if (!aligned4(w) || !aligned4(g)) return ref::sgd_s8(w, g, n, scale_q24, rng, diff_crc, changed);
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        uint32_t wg = load32(g + i);
+        uint32_t steps = 0;
+        for (int k = 0; k < 4; k++) {
+            int8_t step = sat8(-sround_q24(lane(wg, k), scale_q24, rng));
+            steps |= static_cast<uint32_t>(static_cast<uint8_t>(step)) << (8 * k);
+        }
+        // Nothing to change in this word; a zero delta needs no hashing
+        if (steps == 0 && diff_crc == 0) continue;
+
+        uint32_t old_w = load32(w + i);
+        uint32_t new_w = sat_add_s8x4(old_w, steps);
+        uint32_t diff = old_w ^ new_w;
+        diff_crc = crc16::updateByte(diff_crc, static_cast<uint8_t>(diff));
+        diff_crc = crc16::updateByte(diff_crc, static_cast<uint8_t>(diff >> 8));
+        diff_crc = crc16::updateByte(diff_crc, static_cast<uint8_t>(diff >> 16));
+        diff_crc = crc16::updateByte(diff_crc, static_cast<uint8_t>(diff >> 24));
+        if (changed && diff) changed[i >> 3] |= nonzeroLanes(diff) << (i & 4);
+        store32(w + i, new_w);
+    }
+    PLANETARY_OPS(SGD, i / 4, 0);
+    return ref::sgd_s8(w, g, n, scale_q24, rng, diff_crc, changed, i);
+}
+
+// Convex blend on two 16-bit lanes per multiply. In offset binary each
+// lane sum is at most 255 * 256 + 128 < 65536, so lanes never carry.
+inline void blend_s8(int8_t* dst, const int8_t* src, size_t n, uint16_t alpha_q8) {
+    if (!aligned4(dst) || !aligned4(src)) {
+        ref::blend_s8(dst, src, n, alpha_q8);
+        return;
+    }
+
+    uint32_t keep = 256 - alpha_q8;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        uint32_t d = load32(dst + i) ^ 0x80808080u;
+        uint32_t s = load32(src + i) ^ 0x80808080u;
+        uint32_t even = (d & 0x00FF00FFu) * keep + (s & 0x00FF00FFu) * alpha_q8 + 0x00800080u;
+        uint32_t odd = ((d >> 8) & 0x00FF00FFu) * keep + ((s >> 8) & 0x00FF00FFu) * alpha_q8 + 0x00800080u;
+        uint32_t r = ((even >> 8) & 0x00FF00FFu) | (odd & 0xFF00FF00u);
+        store32(dst + i, r ^ 0x80808080u);
+    }
+    PLANETARY_OPS(BLEND, i / 4, 0);
+    ref::blend_s8(dst + i, src + i, n - i, alpha_q8);
+}
+
+// Four lanes per XOR; marks a nibble at a time, so `first` must be a
+// multiple of 4 as well
+inline size_t mark_diff_s8(const int8_t* a, const int8_t* b, size_t n, uint8_t* changed = nullptr,
+                           size_t first = 0) {
+    if (!aligned4(a) || !aligned4(b) || (first & 3)) return ref::mark_diff_s8(a, b, n, changed, first);
+
+    size_t c = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        uint32_t diff = load32(a + i) ^ load32(b + i);
+        if (!diff) continue;
+        c += nonzeroLaneCount(diff);
+        if (changed) changed[(first + i) >> 3] |= nonzeroLanes(diff) << ((first + i) & 4);
+    }
+    PLANETARY_OPS(DIFF, i / 4, 0);
+    return c + ref::mark_diff_s8(a + i, b + i, n - i, changed, first + i);
+}
+
+// Block width from word loads: a lane's magnitude bits are v ^ (0xFF if
+// negative), taken for four lanes at once
+inline uint8_t packWidth(const int8_t* p, size_t n) {
+    if (!aligned4(p)) return ref::packWidth(p, n);
+
+    uint32_t mag = 0, any = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        uint32_t w = load32(p + i);
+        mag |= w ^ (((w & 0x80808080u) >> 7) * 0xFFu);
+        any |= w;
+    }
+    mag |= mag >> 16;
+    mag |= mag >> 8;
+    any |= any >> 16;
+    any |= any >> 8;
+    for (; i < n; i++) {
+        mag |= static_cast<uint8_t>(p[i] ^ (p[i] >> 7));
+        any |= static_cast<uint8_t>(p[i]);
+    }
+    return ref::packWidthOf(static_cast<uint8_t>(mag), static_cast<uint8_t>(any));
+}
+
+// Same output as ref::pack_s8; only the width scan is word-wide, the
+// bit stream itself is serial either way
+inline size_t pack_s8(const int8_t* src, size_t n, uint8_t* out, size_t cap) {
+    PLANETARY_OPS(PACK, 0, n);
+    size_t o = 0;
+    for (size_t b = 0; b < n; b += PACK_BLOCK) {
+        size_t m = (n - b < PACK_BLOCK) ? n - b : PACK_BLOCK;
+        uint8_t w = packWidth(src + b, m);
+        if (o + ref::packedBlockSize(m, w) > cap) return 0;
+        o += ref::packBlock(src + b, m, w, out + o);
+    }
+    return o;
+}
+
+using ref::unpack_s8;
+
+#endif  // PLANETARY_KERNELS_SCALAR
+
+}  // namespace kernels
+}  // namespace planetary
+
+#endif  // KERNELS_H
@@ -4,13 +4,37 @@
  * Orchestrates distributed training on the TLSR8258.
  * Manages shard rotation, local training, and mesh synchronization.
  *
+ * Shard residency runs in the background: the next shard is prefetched
+ * into a spare buffer, swapped in for the longest-resident slot every
+ * SHARD_ROTATION_MS, and the evicted shard is written behind a page at
+ * a time - only if its version moved since it was loaded.
+ *
+ * Warm restart: every CHECKPOINT_INTERVAL_MS the state no shard carries
+ * (epoch, resident shard IDs, the sample ring and replay reservoir,
+ * coherence) is written to a CheckpointStore in the background.
+ * restore() at boot reads it back and reloads those shards from the
+ * store, so a power cycle resumes training instead of starting over.
+ *
+ * Work leases (MeshGossip LEASE): while the thermal governor withholds
+ * LEASE_OFFER_LOAD or more, or AI tasks take MAX_CPU_DUTY_CYCLE, the
+ * resident shard with the fewest neighbour holders is offered in the
+ * heartbeat. A node at or below LEASE_CLAIM_LOAD that is awake claims
+ * the most loaded neighbour's offer; the owner grants one lease at a time
+ * and leaves that shard out of its passes. The holder pulls the owner's
+ * copy, makes it resident ahead of the rotation, trains it on its own
+ * samples for LEASE_MS and sends it back to be merged. Both ends count
+ * the term in gossip rounds, so a lost RETURN only delays the owner.
+ *
  * Training flow:
  *   1. Collect local "environmental" features (power, timing, mesh activity)
- *   2. Run forward pass on current shard
- *   3. Compute gradient via backprop (simplified for tiny model)
- *   4. Apply gradient to local weights (boosted by π×φ resonance)
- *   5. Periodically gossip weights to neighbors
- *   6. Merge incoming weights via FedAvg
+ *      into a sample ring at a fixed cadence. A bulb left in one state
+ *      goes dormant: it keeps one sample per DORMANT_SAMPLE_MS until its
+ *      features move, a light command arrives or a neighbour comes or goes
+ *   2. Per mini-batch, for each resident shard: forward pass (16 -> 56 ->
+ *      48 -> 8 MLP, model.h) and backprop through every layer per sample
+ *   3. Apply the batch's gradient to that shard (boosted by π×φ resonance)
+ *   4. Periodically gossip weights to neighbors
+ *   5. Merge incoming weights via FedAvg
  *
  * π×φ = 5.083203692315260 | PHOENIX-TESLA-369-AURORA
  */
@@ -23,6 +47,12 @@
 #include "hw_scheduler.h"
 #include "mesh_gossip.h"
 #include "light_controller.h"
+#include "shard_store.h"
+#include "checkpoint_store.h"
+#include "kernels.h"
+#include "model.h"
+#include <stddef.h>
+#include <stdlib.h>
 #include <string.h>
 
 namespace planetary {
@@ -70,6 +100,7 @@ struct LocalFeatures {
 } __attribute__((packed));
 
 static_assert(sizeof(LocalFeatures) == 16, "Features must be 16 bytes");
+static_assert(sizeof(LocalFeatures) == model::INPUT_SIZE, "Features feed the first layer");
 
 //-----------------------------------------------------------------------------
 // Multi-Head Prediction Targets
@@ -85,71 +116,344 @@ struct PredictionTargets {
 } __attribute__((packed));
 
 static_assert(sizeof(PredictionTargets) == 8, "Targets must be 8 bytes");
+static_assert(sizeof(PredictionTargets) == model::OUTPUT_SIZE, "One head per output");
+
+//-----------------------------------------------------------------------------
+// Training Samples
+//
+// One (input, target) pair every SAMPLE_PERIOD_MS: the features as they
+// were and what happened since. The newest SAMPLE_RING_SIZE stay in the
+// ring; each one pushed out is offered to the reservoir (Vitter's
+// algorithm R over everything evicted so far), so replay draws evenly
+// from the whole history in SAMPLE_RESERVOIR_SIZE slots.
+//-----------------------------------------------------------------------------
+struct TrainingSample {
+    LocalFeatures     input;
+    PredictionTargets target;
+} __attribute__((packed));
+
+struct SampleRing {
+    static constexpr uint8_t RESERVOIR = 0x80;   // Batch index flag: reservoir slot
+
+    TrainingSample ring[SAMPLE_RING_SIZE];
+    TrainingSample reservoir[SAMPLE_RESERVOIR_SIZE];
+    uint8_t  head;           // Next write (oldest entry once full)
+    uint8_t  count;          // Ring entries in use
+    uint8_t  fresh;          // Pushed since the last batch
+    uint8_t  reserved;
+    uint32_t evicted;        // Length of the stream the reservoir samples
+
+    void clear() {
+        memset(this, 0, sizeof(*this));
+    }
+
+    bool valid() const {
+        return head < SAMPLE_RING_SIZE && count <= SAMPLE_RING_SIZE && fresh <= count;
+    }
+
+    void push(const TrainingSample& s, uint32_t& rng) {
+        if (count == SAMPLE_RING_SIZE) {
+            if (evicted < UINT32_MAX) evicted++;
+            uint32_t j = (evicted <= SAMPLE_RESERVOIR_SIZE) ? evicted - 1
+                         : kernels::xorshift32(rng) % evicted;
+            if (j < SAMPLE_RESERVOIR_SIZE) reservoir[j] = ring[head];
+        } else {
+            count++;
+        }
+        ring[head] = s;
+        head = static_cast<uint8_t>((head + 1) % SAMPLE_RING_SIZE);
+        if (fresh < count) fresh++;
+    }
+
+    // Indices (for at()) of the newest BATCH_NEW_SAMPLES plus up to
+    // BATCH_REPLAY_SAMPLES reservoir draws; marks the ring as consumed.
+    uint8_t takeBatch(uint8_t* idx, uint32_t& rng) {
+        uint8_t n = 0;
+        uint8_t newest = (count < BATCH_NEW_SAMPLES) ? count : BATCH_NEW_SAMPLES;
+        for (uint8_t k = 1; k <= newest; k++) {
+            idx[n++] = static_cast<uint8_t>((head + SAMPLE_RING_SIZE - k) % SAMPLE_RING_SIZE);
+        }
+        uint32_t held = (evicted < SAMPLE_RESERVOIR_SIZE) ? evicted : SAMPLE_RESERVOIR_SIZE;
+        for (uint8_t k = 0; held && k < BATCH_REPLAY_SAMPLES; k++) {
+            idx[n++] = static_cast<uint8_t>(RESERVOIR | (kernels::xorshift32(rng) % held));
+        }
+        fresh = 0;
+        return n;
+    }
+
+    const TrainingSample& at(uint8_t idx) const {
+        return (idx & RESERVOIR) ? reservoir[idx & ~RESERVOIR] : ring[idx];
+    }
+};
+
+static_assert(SAMPLE_RING_SIZE < SampleRing::RESERVOIR, "Ring index must not collide with the flag");
 
 //-----------------------------------------------------------------------------
-// Gradient Accumulator
+// Gradient Accumulator (block floating point)
+//
+// The sum, not the mean, of every sample since the last apply: weight i
+// holds mantissa[i] << exponent[i / GRAD_BLOCK]. A block's exponent grows
+// when a sum would leave int8 (its mantissas halve); contributions finer
+// than the block's resolution are stochastically rounded, so small
+// gradients survive in expectation instead of rounding to zero. The apply
+// divides by sample_count. An int16 sum per weight would need 4KB more
+// SRAM than the budget has; the exponents cost WEIGHT_COUNT / GRAD_BLOCK.
 //-----------------------------------------------------------------------------
-struct GradientAccum {
-    int8_t  gradients[WeightShard::WEIGHT_COUNT];
+struct alignas(4) GradientAccum {
+    static constexpr size_t  BLOCKS = (WeightShard::WEIGHT_COUNT + GRAD_BLOCK - 1) / GRAD_BLOCK;
+    static constexpr uint8_t MAX_EXPONENT = 7;   // Sums up to 127 << 7
+
+    int8_t  mantissa[WeightShard::WEIGHT_COUNT];
+    uint8_t exponent[BLOCKS];
     uint8_t sample_count;
 
     void clear() {
         memset(this, 0, sizeof(*this));
     }
 
-    void accumulate(const int8_t* grad, size_t len) {
-        size_t count = (len < WeightShard::WEIGHT_COUNT) ? len : WeightShard::WEIGHT_COUNT;
+    // Add one sample's gradient for [offset, offset + len) to the sums;
+    // call commitSample() once the whole sample is in.
+    void accumulateAt(size_t offset, const int8_t* grad, size_t len, uint32_t& rng) {
+        if (offset >= WeightShard::WEIGHT_COUNT) return;
+        size_t count = (len < WeightShard::WEIGHT_COUNT - offset) ? len
+                       : WeightShard::WEIGHT_COUNT - offset;
+        PLANETARY_OPS(ACCUM, 0, count);
         for (size_t i = 0; i < count; i++) {
-            int16_t avg = (static_cast<int16_t>(gradients[i]) * sample_count + grad[i]) /
-                          (sample_count + 1);
-            gradients[i] = static_cast<int8_t>(avg);
+            size_t idx = offset + i;
+            uint8_t& e = exponent[idx / GRAD_BLOCK];
+            int32_t s = mantissa[idx] + shiftRound(grad[i], e, rng);
+            while ((s > 127 || s < -128) && e < MAX_EXPONENT) {
+                halveBlock(idx / GRAD_BLOCK, rng);
+                s = mantissa[idx] + shiftRound(grad[i], e, rng);
+            }
+            mantissa[idx] = kernels::sat8(s);
         }
+    }
+
+    void commitSample() {
         sample_count++;
     }
+
+private:
+    // floor((x + r) / 2^e), r uniform in [0, 2^e): unbiased x / 2^e
+    static int32_t shiftRound(int32_t x, uint8_t e, uint32_t& rng) {
+        if (e == 0) return x;
+        return (x + static_cast<int32_t>(kernels::xorshift32(rng) & ((1u << e) - 1))) >> e;
+    }
+
+    void halveBlock(size_t b, uint32_t& rng) {
+        exponent[b]++;
+        size_t end = (b + 1) * GRAD_BLOCK;
+        if (end > WeightShard::WEIGHT_COUNT) end = WeightShard::WEIGHT_COUNT;
+        for (size_t i = b * GRAD_BLOCK; i < end; i++) {
+            mantissa[i] = static_cast<int8_t>(shiftRound(mantissa[i], 1, rng));
+        }
+    }
+};
+
+static_assert(GRAD_BLOCK % 8 == 0, "Blocks must start on a changed-bitmap byte");
+
+//-----------------------------------------------------------------------------
+// Gossip Timer (Trickle, RFC 6206)
+//
+// One shard goes out per interval, at a random point in its second half.
+// An interval that ends quietly doubles the next, up to
+// GOSSIP_INTERVAL_DOUBLINGS times; a disagreement (a merge or a training
+// pass that moved GOSSIP_DISAGREE_WEIGHTS weights or more) starts a
+// minimum interval at once. Once GOSSIP_REDUNDANCY neighbours' copies
+// that changed little here have been heard in an interval, our send is
+// suppressed unless it carries as much itself.
+//-----------------------------------------------------------------------------
+struct GossipTimer {
+    static constexpr uint32_t TICKS_PER_MS = 16 * 1000;
+    static_assert((static_cast<uint64_t>(GOSSIP_INTERVAL_MIN_MS) << GOSSIP_INTERVAL_DOUBLINGS) *
+                  TICKS_PER_MS < (1ull << 32), "Intervals are timed on 32-bit ticks");
+
+    uint32_t start_tick;     // Interval began
+    uint32_t fire_ms;        // Send point, ms into the interval
+    uint8_t  doublings;      // Interval is GOSSIP_INTERVAL_MIN_MS << doublings
+    uint8_t  heard;          // Agreeing copies heard this interval
+    bool     fired;          // Send point passed
+    bool     disagreed;      // Back to the minimum at the next step()
+
+    uint32_t intervalMs() const {
+        return static_cast<uint32_t>(GOSSIP_INTERVAL_MIN_MS) << doublings;
+    }
+
+    void begin(uint32_t now, uint8_t d, uint32_t& rng) {
+        start_tick = now;
+        doublings = d;
+        heard = 0;
+        fired = false;
+        disagreed = false;
+        uint32_t half = intervalMs() / 2;
+        fire_ms = half + kernels::xorshift32(rng) % half;
+    }
+
+    void agree() {
+        if (heard < 0xFF) heard++;
+    }
+
+    void disagree() { disagreed = true; }
+
+    bool suppressed() const { return heard >= GOSSIP_REDUNDANCY; }
+
+    // Advance to `now`; true once per interval, at its send point
+    bool step(uint32_t now, uint32_t& rng) {
+        if (disagreed && doublings) begin(now, 0, rng);
+        disagreed = false;
+        if ((now - start_tick) / TICKS_PER_MS >= intervalMs()) {
+            begin(now, doublings < GOSSIP_INTERVAL_DOUBLINGS ? doublings + 1 : doublings, rng);
+        }
+        if (fired || (now - start_tick) / TICKS_PER_MS < fire_ms) return false;
+        fired = true;
+        return true;
+    }
 };
 
+//-----------------------------------------------------------------------------
+// Warm-restart checkpoint (stored ahead of the SampleRing)
+//-----------------------------------------------------------------------------
+struct EngineCheckpoint {
+    uint16_t local_epoch;
+    uint16_t residency_round;
+    uint8_t  resident[MAX_SHARDS_IN_RAM];  // Shard ID per slot
+    float    coherence;
+    LocalFeatures prev_features;
+} __attribute__((packed));
+
+static_assert(sizeof(EngineCheckpoint) + sizeof(SampleRing) <= CheckpointStore::CAPACITY,
+              "Checkpoint must fit one slot");
+
 //-----------------------------------------------------------------------------
 // Learning Engine
 //-----------------------------------------------------------------------------
 class LearningEngine {
 public:
-    LearningEngine(HWScheduler& scheduler, MeshGossip& mesh, LightController& light)
-        : scheduler_(scheduler), mesh_(mesh), light_(light),
-          current_shard_idx_(0), local_epoch_(0),
-          samples_since_sync_(0), last_gossip_tick_(0),
-          coherence_score_(0.0f) {
+    static constexpr uint16_t APPLY_CHUNK = 512;         // Weights per apply phase
+    static constexpr uint16_t PHASE_COST_SEED_US = 250;  // Until measured
+    static constexpr uint8_t  NO_SHARD = 0xFF;
+    static_assert(APPLY_CHUNK % GRAD_BLOCK == 0, "Apply chunks start on a gradient block");
+
+    LearningEngine(HWScheduler& scheduler, MeshGossip& mesh, LightController& light,
+                   ShardStore& store, CheckpointStore& checkpoints)
+        : scheduler_(scheduler), mesh_(mesh), light_(light), store_(store),
+          local_epoch_(0), last_heartbeat_tick_(0), heartbeat_round_(0), broadcast_slot_(0),
+          cluster_head_(MESH_ADDR_ALL),
+          sent_mask_(0), pass_moved_(0), coherence_score_(0.0f), last_sample_tick_(0), quiet_samples_(0),
+          light_commands_(0), train_phase_(TrainPhase::BATCH),
+          batch_len_(0), batch_cursor_(0), sample_slot_(0), layer_cursor_(0), sample_error_(0),
+          apply_cursor_(0), apply_scale_q24_(0), round_rng_(0x9E3779B9u),
+          residency_phase_(ResidencyPhase::IDLE), residency_round_(1), last_swap_tick_(0),
+          spare_clean_version_(0), checkpoints_(checkpoints), last_checkpoint_tick_(0), checkpoint_elapsed_ms_(0),
+          checkpoint_epoch_(0), lent_shard_(NO_SHARD), lent_to_(0), lent_rounds_(0),
+          leased_shard_(NO_SHARD), leased_from_(0), leased_rounds_(0) {
 
         // Initialize shards
         for (uint8_t i = 0; i < MAX_SHARDS_IN_RAM; i++) {
             shards_[i].init(i);
+            delta_trackers_[i].reset(shards_[i].header.version);
+            delta_trackers_[i].invalidate();  // Nobody has our base yet
+            clean_version_[i] = shards_[i].header.version;
+            moved_[i] = WeightShard::MODEL_WEIGHTS;
+            sent_round_[i] = 0;
         }
+        memset(&gossip_timer_, 0, sizeof(gossip_timer_));
+        memset(last_resident_round_, 0, sizeof(last_resident_round_));
         gradient_accum_.clear();
+        samples_.clear();
         memset(&prev_features_, 0, sizeof(prev_features_));
-        memset(&prev_targets_, 0, sizeof(prev_targets_));
+        memset(activations_, 0, sizeof(activations_));
+        for (uint8_t i = 0; i < static_cast<uint8_t>(TrainPhase::COUNT); i++) {
+            phase_cost_us_[i] = PHASE_COST_SEED_US;
+        }
 
         // Register with mesh for incoming weights
         mesh_.setOnShardReceived(onShardReceivedStatic, this);
+        mesh_.setOnDeltaReceived(onDeltaReceivedStatic, this);
+        mesh_.setShardLookup(lookupShardStatic, this);
+        mesh_.setStoredShardLookup(storedShardStatic, this);
+        mesh_.setOnShardMerged(onShardMergedStatic, this);
+        mesh_.setOnMergeFailed(onMergeFailedStatic, this);
+        mesh_.setChangeLookup(changeLookupStatic, this);
+        mesh_.setOnLease(onLeaseStatic, this);
     }
 
     // Register training task with scheduler
     void start() {
-        scheduler_.registerTask(trainingStepStatic, this, TaskPriority::LOW);
-        scheduler_.registerTask(syncStepStatic, this, TaskPriority::NORMAL);
+        scheduler_.registerTask(trainingStepStatic, this, TaskPriority::LOW,
+                                TRAIN_PERIOD_MS, TRAIN_BURST_US);
+        scheduler_.registerTask(syncStepStatic, this, TaskPriority::NORMAL,
+                                SYNC_PERIOD_MS, SYNC_BURST_US);
+        scheduler_.registerTask(residencyStepStatic, this, TaskPriority::LOW,
+                                RESIDENCY_PERIOD_MS, RESIDENCY_BURST_US, FLASH_ACTIVE_MW);
+        scheduler_.registerTask(checkpointStepStatic, this, TaskPriority::LOW,
+                                CHECKPOINT_PERIOD_MS, CHECKPOINT_BURST_US, FLASH_ACTIVE_MW);
+        last_checkpoint_tick_ = clock_time();
+        last_sample_tick_ = last_checkpoint_tick_;
+        round_rng_ ^= last_checkpoint_tick_ | 1;  // Bulbs boot at different ticks
+        gossip_timer_.begin(last_checkpoint_tick_, 0, round_rng_);
+        // Break score ties out of phase with neighbours: two nodes sending
+        // the same shard at once would each find the other's copy read-only
+        broadcast_slot_ = mesh_.getAddress() % MAX_SHARDS_IN_RAM;
+    }
+
+    // Boot: resume from the newest checkpoint if there is one (else the
+    // constructor's slot layout), loading each resident shard's latest
+    // stored record. Call once after both stores are mounted, before start().
+    void restore() {
+        EngineCheckpoint ck;
+        bool warm = checkpoints_.load(&ck, sizeof(ck), &samples_, sizeof(samples_)) &&
+                    validCheckpoint(ck) && samples_.valid();
+        if (!warm) samples_.clear();
+
+        for (uint8_t i = 0; i < MAX_SHARDS_IN_RAM; i++) {
+            uint8_t id = warm ? ck.resident[i] : shards_[i].header.shard_id;
+            if (!store_.load(id, shards_[i])) shards_[i].init(id);
+            delta_trackers_[i].reset(shards_[i].header.version);
+            delta_trackers_[i].invalidate();
+            clean_version_[i] = shards_[i].header.version;
+            moved_[i] = WeightShard::MODEL_WEIGHTS;
+        }
+        sent_mask_ = 0;
+        if (!warm) return;
+
+        local_epoch_ = ck.local_epoch;
+        residency_round_ = ck.residency_round;
+        coherence_score_ = ck.coherence;
+        prev_features_ = ck.prev_features;
+        checkpoint_epoch_ = local_epoch_;
     }
 
     // Get current training stats
     uint16_t getLocalEpoch() const { return local_epoch_; }
     uint8_t  getShardsHeld() const { return MAX_SHARDS_IN_RAM; }
-    uint8_t  getCurrentShardId() const { return shards_[current_shard_idx_].header.shard_id; }
+    uint8_t  getCurrentShardId() const { return shards_[sample_slot_].header.shard_id; }
     float    getCoherence() const { return coherence_score_; }
+    bool     isDormant() const { return quiet_samples_ >= DORMANT_AFTER_SAMPLES; }
     float    getResonanceMultiplier() const { return computeResonance(); }
+    uint8_t  getLentShard() const { return lent_shard_; }      // NO_SHARD: none
+    uint8_t  getLeasedShard() const { return leased_shard_; }  // NO_SHARD: none
 
-    // Manual shard rotation (load different shards from flash)
+    // Read-only view of a resident slot (diagnostics, host simulator)
+    const WeightShard& getShard(uint8_t slot) const { return shards_[slot]; }
+
+    // Manual shard rotation (load different shards from flash), synchronous
     void rotateShard(uint8_t slot, uint8_t new_shard_id) {
-        saveShardToFlash(shards_[slot]);
-        if (!loadShardFromFlash(new_shard_id, shards_[slot])) {
+        drainPendingApply(slot);
+        if (isDirty(slot)) store_.save(shards_[slot]);
+        last_resident_round_[shards_[slot].header.shard_id] = residency_round_;
+        if (!store_.load(new_shard_id, shards_[slot])) {
             shards_[slot].init(new_shard_id);
         }
+        if (residency_phase_ == ResidencyPhase::PREFETCHED &&
+            spare_.header.shard_id == new_shard_id) {
+            residency_phase_ = ResidencyPhase::IDLE;  // Drop the duplicate copy
+        }
+        clean_version_[slot] = shards_[slot].header.version;
+        delta_trackers_[slot].invalidate();
+        sent_mask_ &= ~(1u << slot);
+        moved_[slot] = WeightShard::MODEL_WEIGHTS;
     }
 
 private:
@@ -198,103 +502,616 @@ private:
         return static_cast<LearningEngine*>(ctx)->syncStep(budget_us);
     }
 
-    static void onShardReceivedStatic(const WeightShard& shard, void* ctx) {
-        static_cast<LearningEngine*>(ctx)->onShardReceived(shard);
+    static bool residencyStepStatic(uint32_t budget_us, void* ctx) {
+        return static_cast<LearningEngine*>(ctx)->residencyStep(budget_us);
+    }
+
+    static bool checkpointStepStatic(uint32_t budget_us, void* ctx) {
+        return static_cast<LearningEngine*>(ctx)->checkpointStep(budget_us);
+    }
+
+    static bool onShardReceivedStatic(const WeightShard& shard, void* ctx) {
+        return static_cast<LearningEngine*>(ctx)->onShardReceived(shard);
+    }
+
+    static WeightShard* lookupShardStatic(uint8_t shard_id, void* ctx) {
+        LearningEngine* self = static_cast<LearningEngine*>(ctx);
+        for (uint8_t i = 0; i < MAX_SHARDS_IN_RAM; i++) {
+            if (self->shards_[i].header.shard_id == shard_id) return &self->shards_[i];
+        }
+        return nullptr;
+    }
+
+    static const WeightShard* storedShardStatic(uint8_t shard_id, void* ctx) {
+        return static_cast<LearningEngine*>(ctx)->store_.view(shard_id);
+    }
+
+    // Merged in place; the weights that moved are marked in the tracker,
+    // so the delta base survives
+    static void onShardMergedStatic(WeightShard& shard, uint16_t disagreed, void* ctx) {
+        LearningEngine* self = static_cast<LearningEngine*>(ctx);
+        self->noteMerge(static_cast<uint8_t>(&shard - self->shards_), disagreed);
+    }
+
+    static void onMergeFailedStatic(WeightShard& shard, void* ctx) {
+        LearningEngine* self = static_cast<LearningEngine*>(ctx);
+        self->onMergeFailed(static_cast<uint8_t>(&shard - self->shards_));
+    }
+
+    static uint8_t* changeLookupStatic(const WeightShard& shard, void* ctx) {
+        LearningEngine* self = static_cast<LearningEngine*>(ctx);
+        return self->delta_trackers_[&shard - self->shards_].changed;
+    }
+
+    static void onLeaseStatic(uint16_t src, uint8_t shard_id, LeaseOp op, void* ctx) {
+        static_cast<LearningEngine*>(ctx)->onLease(src, shard_id, op);
+    }
+
+    static bool onDeltaReceivedStatic(const DeltaInfo& info, const uint8_t* bitmap,
+                                      const int8_t* values, size_t value_count, bool complete,
+                                      void* ctx) {
+        return static_cast<LearningEngine*>(ctx)->onDeltaReceived(info, bitmap, values,
+                                                                  value_count, complete);
     }
 
     //-------------------------------------------------------------------------
-    // Core Training Step
+    // Core Training Step (resumable)
+    //
+    // Samples go into the ring every SAMPLE_PERIOD_MS. Once
+    // BATCH_NEW_SAMPLES fresh ones are in, a pass trains every resident
+    // slot in turn on the same mini-batch (plus reservoir replay), one
+    // apply per slot, so each shard's weights stay hot for a whole batch
+    // and coherence is computed once per pass.
+    //
+    // Every sample is split into phases so a tight idle window never runs
+    // into BLE_GUARD_US. Before each phase its measured worst-case cost is
+    // checked against the remaining budget; if it does not fit we return
+    // true ("wants more") and resume at the same phase on the next
+    // runSlice(). An estimate too big for a whole slice decays on each
+    // such skip, so one spike cannot stall training. The gradient is
+    // applied APPLY_CHUNK weights at a time and every chunk patches the
+    // shard checksum, so the shard stays valid for gossip and FedAvg
+    // between slices.
     //-------------------------------------------------------------------------
     bool trainingStep(uint32_t budget_us) {
-        if (budget_us < 1000) return false;
-
-        // Collect current features
-        LocalFeatures features;
-        collectFeatures(features);
+        uint32_t start = clock_time();
+
+        // The checkpoint being written reads the ring in place: skip a
+        // sample rather than change it under the writer
+        constexpr uint32_t sample_ticks = SAMPLE_PERIOD_MS * 1000 * HWScheduler::TICK_PER_US;
+        if (start - last_sample_tick_ >= sample_ticks && !checkpoints_.writing()) {
+            last_sample_tick_ = start;
+            collectSample();
+        }
 
-        // Compute actual targets (what happened since last step)
-        PredictionTargets actual_targets;
-        computeActualTargets(features, actual_targets);
+        for (bool ran = false;; ran = true) {
+            // Hold the update while the shard's fragments are on air; they are
+            // read from the live weights and an edit would restart the transfer
+            if (train_phase_ == TrainPhase::APPLY && mesh_.isReadOnly(shards_[sample_slot_])) {
+                return true;
+            }
 
-        // Forward pass - predict what will happen
-        WeightShard& shard = shards_[current_shard_idx_];
-        PredictionTargets predicted;
-        forward(shard, prev_features_, predicted);
+            uint8_t phase = static_cast<uint8_t>(train_phase_);
+            uint32_t elapsed_us = (clock_time() - start) / HWScheduler::TICK_PER_US;
+            if (elapsed_us + phase_cost_us_[phase] > budget_us) {
+                if (!ran) trackPhaseCost(phase, 0);
+                return true;  // Resume this phase next slice
+            }
 
-        // Compute multi-head loss
-        int8_t total_error = computeMultiHeadLoss(predicted, actual_targets);
+            uint32_t phase_start = clock_time();
+            bool pass_done = runTrainingPhase();
+            trackPhaseCost(phase, (clock_time() - phase_start) / HWScheduler::TICK_PER_US);
 
-        // Backward pass
-        int8_t gradients[sizeof(LocalFeatures)];
-        backward(prev_features_, total_error, gradients);
+            if (pass_done) return false;
+        }
+    }
 
-        // Accumulate gradients
-        gradient_accum_.accumulate(gradients, sizeof(gradients));
-        samples_since_sync_++;
+    // Features now, paired with the ones they follow
+    void collectSample() {
+        alignas(4) LocalFeatures now;
+        TrainingSample s;
+        collectFeatures(now);
+        if (keepSample(now)) {
+            s.input = prev_features_;
+            computeActualTargets(now, s.target);
+            samples_.push(s, round_rng_);
+        }
+        prev_features_ = now;
+    }
 
-        // Apply with resonance boost
-        if (samples_since_sync_ >= 10) {
-            float resonance = computeResonance();
-            coherence_score_ = resonance;  // Track for diagnostics
+    // Change detection. Samples are kept while the bulb changes and for
+    // DORMANT_AFTER_MS after; then only one per DORMANT_SAMPLE_MS, so no
+    // batch fills and training idles on a steady state. A light command,
+    // a neighbour joining or leaving, or features moving by more than
+    // FEATURE_CHANGE_L1 since the last sample wakes it at once. Counted in
+    // samples rather than ticks, which wrap in ~268s.
+    bool keepSample(const LocalFeatures& now) {
+        uint8_t commands = light_.getCommandCount();
+        if (commands != light_commands_ || now.neighbor_count != prev_features_.neighbor_count ||
+            featureDistance(now, prev_features_) > FEATURE_CHANGE_L1) {
+            light_commands_ = commands;
+            quiet_samples_ = 0;
+            return true;
+        }
+        if (quiet_samples_ < DORMANT_AFTER_SAMPLES) {
+            quiet_samples_++;
+            return true;
+        }
+        if (++quiet_samples_ < DORMANT_AFTER_SAMPLES + DORMANT_SAMPLE_EVERY) return false;
+        quiet_samples_ = DORMANT_AFTER_SAMPLES;
+        return true;
+    }
 
-            shard.applyGradient(gradient_accum_.gradients,
-                               sizeof(gradient_accum_.gradients),
-                               LEARNING_RATE * resonance);
-            gradient_accum_.clear();
-            samples_since_sync_ = 0;
-            local_epoch_++;
+    // L1 distance over the state features; the temporal ones advance with
+    // the clock alone and are left out
+    static uint16_t featureDistance(const LocalFeatures& a, const LocalFeatures& b) {
+        const int8_t* pa = reinterpret_cast<const int8_t*>(&a);
+        const int8_t* pb = reinterpret_cast<const int8_t*>(&b);
+        uint16_t d = 0;
+        for (size_t i = 0; i < sizeof(LocalFeatures); i++) {
+            if (i == offsetof(LocalFeatures, uptime_phase) ||
+                i == offsetof(LocalFeatures, circadian_phase)) continue;
+            d += static_cast<uint16_t>(abs(pa[i] - pb[i]));
         }
+        return d;
+    }
 
-        // Save state for next iteration
-        prev_features_ = features;
-        prev_targets_ = actual_targets;
+    // Advance the training state machine by one phase.
+    // Returns true when a pass completed (or none is due yet).
+    bool runTrainingPhase() {
+        switch (train_phase_) {
+            case TrainPhase::BATCH:
+                if (samples_.fresh < BATCH_NEW_SAMPLES) return true;
+                if (nextTrainSlot(0) >= MAX_SHARDS_IN_RAM) return true;  // All lent out
+                batch_len_ = samples_.takeBatch(batch_, round_rng_);
+
+                // Mean gradient with resonance boost, the same for every
+                // slot. Q24: a fractional step is a probability.
+                coherence_score_ = computeResonance();  // Track for diagnostics
+                apply_scale_q24_ = static_cast<int32_t>(LEARNING_RATE * coherence_score_ *
+                                                        (1 << 24)) / batch_len_;
+                sample_slot_ = nextTrainSlot(0);
+                batch_cursor_ = 0;
+                train_phase_ = TrainPhase::SAMPLE;
+                return false;
+
+            case TrainPhase::SAMPLE: {
+                // Copied out: a long pass may see its ring entry replaced
+                const TrainingSample& s = samples_.at(batch_[batch_cursor_]);
+                sample_features_ = s.input;
+                sample_targets_ = s.target;
+                layer_cursor_ = 0;
+                train_phase_ = TrainPhase::FORWARD;
+                return false;
+            }
 
-        // Rotate shard
-        current_shard_idx_ = (current_shard_idx_ + 1) % MAX_SHARDS_IN_RAM;
+            case TrainPhase::FORWARD: {
+                // Predict what will happen from the previous state, one layer per phase
+                PLANETARY_TRACE_SCOPE(TracePoint::FORWARD);
+                forwardLayer(shards_[sample_slot_], layer_cursor_);
+                if (++layer_cursor_ >= model::LAYER_COUNT) {
+                    train_phase_ = TrainPhase::LOSS;
+                }
+                return false;
+            }
 
-        return true;
+            case TrainPhase::LOSS:
+                memcpy(&sample_predicted_, activations_[model::LAYER_COUNT - 1],
+                       sizeof(sample_predicted_));
+                sample_error_ = computeMultiHeadLoss(sample_predicted_, sample_targets_);
+                computeOutputDelta(sample_predicted_, sample_targets_);
+                layer_cursor_ = model::LAYER_COUNT;
+                train_phase_ = TrainPhase::BACKWARD;
+                return false;
+
+            case TrainPhase::BACKWARD: {
+                // Backprop one layer per phase, last layer first
+                PLANETARY_TRACE_SCOPE(TracePoint::BACKWARD);
+                backwardLayer(shards_[sample_slot_], --layer_cursor_);
+                if (layer_cursor_ == 0) {
+                    train_phase_ = TrainPhase::ACCUMULATE;
+                }
+                return false;
+            }
+
+            case TrainPhase::ACCUMULATE:
+                gradient_accum_.commitSample();
+                if (++batch_cursor_ < batch_len_) {
+                    train_phase_ = TrainPhase::SAMPLE;
+                    return false;
+                }
+                // Batch done for this slot: apply, chunked over later phases
+                apply_cursor_ = 0;
+                train_phase_ = TrainPhase::APPLY;
+                return false;
+
+            case TrainPhase::APPLY: {
+                PLANETARY_TRACE_SCOPE(TracePoint::APPLY);
+                size_t end = apply_cursor_ + APPLY_CHUNK;
+                if (end > WeightShard::MODEL_WEIGHTS) end = WeightShard::MODEL_WEIGHTS;
+
+                // Weights this chunk moves that had not moved since the last broadcast
+                const uint8_t* changed = delta_trackers_[sample_slot_].changed + apply_cursor_ / 8;
+                size_t changed_bytes = (end - apply_cursor_ + 7) / 8;
+                uint32_t before = kernels::count_bits(changed, changed_bytes);
+                shards_[sample_slot_].applyGradientRange(gradient_accum_.mantissa,
+                                                         gradient_accum_.exponent, apply_cursor_,
+                                                         end, apply_scale_q24_, round_rng_,
+                                                         delta_trackers_[sample_slot_].changed);
+                pass_moved_ += kernels::count_bits(changed, changed_bytes) - before;
+                apply_cursor_ = static_cast<uint16_t>(end);
+                if (apply_cursor_ >= WeightShard::MODEL_WEIGHTS) {
+                    train_phase_ = TrainPhase::COMMIT;
+                }
+                return false;
+            }
+
+            case TrainPhase::COMMIT:
+                shards_[sample_slot_].header.version++;
+                addMoved(sample_slot_, pass_moved_);
+                if (pass_moved_ >= GOSSIP_DISAGREE_WEIGHTS) gossip_timer_.disagree();
+                pass_moved_ = 0;
+                gradient_accum_.clear();
+                local_epoch_++;
+
+                // Same batch on the next slot, until every slot has had it
+                batch_cursor_ = 0;
+                sample_slot_ = nextTrainSlot(sample_slot_ + 1);
+                if (sample_slot_ < MAX_SHARDS_IN_RAM) {
+                    train_phase_ = TrainPhase::SAMPLE;
+                    return false;
+                }
+                sample_slot_ = 0;
+                train_phase_ = TrainPhase::BATCH;
+                return true;
+
+            default:
+                train_phase_ = TrainPhase::BATCH;
+                return false;
+        }
+    }
+
+    // Worst-case cost per phase: rises immediately, decays by 1/8 per run
+    // (or per slice it was too big to start in)
+    void trackPhaseCost(uint8_t phase, uint32_t measured_us) {
+        uint16_t& cost = phase_cost_us_[phase];
+        uint32_t m = (measured_us > 0xFFFF) ? 0xFFFF : measured_us;
+        if (m >= cost) {
+            cost = static_cast<uint16_t>(m);
+        } else {
+            cost = static_cast<uint16_t>(cost - (cost - m) / 8);
+        }
+    }
+
+    // Finish a pending chunked update before its slot is swapped out
+    void drainPendingApply(uint8_t slot) {
+        while ((train_phase_ == TrainPhase::APPLY || train_phase_ == TrainPhase::COMMIT) &&
+               sample_slot_ == slot) {
+            runTrainingPhase();
+        }
     }
 
     //-------------------------------------------------------------------------
     // Sync Step - Gossip Weights
     //-------------------------------------------------------------------------
     bool syncStep(uint32_t budget_us) {
+        // Queued shard fragments drain every slice, not once per period
+        bool tx_pending = mesh_.pumpTx(budget_us);
+
         uint32_t now = clock_time();
-        uint32_t elapsed_ms = (now - last_gossip_tick_) / (16 * 1000);
 
-        if (elapsed_ms < GOSSIP_INTERVAL_MS) {
-            return false;
+        // One shard per gossip interval, the one worth most to neighbours,
+        // as a delta when they have our base
+        if (gossip_timer_.step(now, round_rng_) && !mesh_.shouldThrottle()) {
+            uint8_t slot = chooseGossipSlot();
+            if (slot < MAX_SHARDS_IN_RAM) {
+                gossipShard(slot);
+                broadcast_slot_ = (slot + 1) % MAX_SHARDS_IN_RAM;
+                tx_pending = mesh_.txBacklog() > 0;
+            }
+        }
+
+        uint32_t elapsed_ms = (now - last_heartbeat_tick_) / GossipTimer::TICKS_PER_MS;
+        if (elapsed_ms < HEARTBEAT_INTERVAL_MS) {
+            return tx_pending;
         }
+        last_heartbeat_tick_ = now;
+        heartbeat_round_++;
+
+        leaseStep();
 
         if (mesh_.shouldThrottle()) {
-            last_gossip_tick_ = now;
-            return false;
+            return tx_pending;
+        }
+
+        // Heartbeat (re-elects the cluster head)
+        // Load is the governor's throttle: a hot node is the last choice
+        // as cluster head or shard holder, and neighbours pace their sends
+        const ThermalGovernor& gov = scheduler_.getGovernor();
+        HeldShards held;
+        fillHeldShards(held);
+        mesh_.sendHeartbeat(gov.throttle(), MAX_SHARDS_IN_RAM, local_epoch_,
+                            scheduler_.getGuardUs(), scheduler_.takeOverruns(), held,
+                            gov.temperatureC(), gov.predictedC());
+
+        // A new head has none of our delta bases
+        if (mesh_.getClusterHead() != cluster_head_) {
+            cluster_head_ = mesh_.getClusterHead();
+            for (uint8_t i = 0; i < MAX_SHARDS_IN_RAM; i++) delta_trackers_[i].invalidate();
         }
 
-        // Broadcast a shard (round-robin)
-        static uint8_t broadcast_idx = 0;
-        mesh_.broadcastShard(shards_[broadcast_idx]);
-        broadcast_idx = (broadcast_idx + 1) % MAX_SHARDS_IN_RAM;
+        return mesh_.txBacklog() > 0;
+    }
 
-        // Heartbeat
-        uint8_t load = scheduler_.getThrottleLevel();
-        mesh_.sendHeartbeat(load, MAX_SHARDS_IN_RAM, local_epoch_);
+    // What a slot's next broadcast is worth: weights moved and updates
+    // merged since the last one, and neighbours that missed that one
+    // (counted once their heartbeats have had a round to catch up).
+    // 0 when nothing would be new to anyone, or while it is still on air.
+    uint32_t gossipScore(uint8_t slot) const {
+        const WeightShard& shard = shards_[slot];
+        const DeltaTracker& tracker = delta_trackers_[slot];
+        if (mesh_.isTransmitting(shard)) return 0;
+
+        bool sent = sent_mask_ & (1u << slot);
+        uint8_t lag = 0;
+        if (sent && static_cast<uint8_t>(heartbeat_round_ - sent_round_[slot]) >= 2) {
+            lag = mesh_.laggingNeighbors(shard.header.shard_id, tracker.base_version);
+        }
+        if (sent && sent_checksum_[slot] == shard.header.checksum && lag == 0) return 0;
 
-        last_gossip_tick_ = now;
-        return false;
+        uint8_t updates = static_cast<uint8_t>(shard.header.version - tracker.base_version);
+        return moved_[slot] + static_cast<uint32_t>(updates) * GOSSIP_SCORE_PER_VERSION +
+               static_cast<uint32_t>(lag) * GOSSIP_SCORE_PER_LAG;
+    }
+
+    // Highest score, ties to the first from broadcast_slot_; NO_SHARD if
+    // there is nothing to say or neighbours are saying it for us
+    uint8_t chooseGossipSlot() const {
+        uint8_t best = NO_SHARD;
+        uint32_t best_score = 0;
+        for (uint8_t k = 0; k < MAX_SHARDS_IN_RAM; k++) {
+            uint8_t slot = static_cast<uint8_t>((broadcast_slot_ + k) % MAX_SHARDS_IN_RAM);
+            uint32_t score = gossipScore(slot);
+            if (score > best_score) {
+                best = slot;
+                best_score = score;
+            }
+        }
+        if (gossip_timer_.suppressed() && best_score < GOSSIP_DISAGREE_WEIGHTS) return NO_SHARD;
+        return best;
+    }
+
+    void addMoved(uint8_t slot, uint32_t moved) {
+        uint32_t total = moved_[slot] + moved;
+        moved_[slot] = static_cast<uint16_t>(total > WeightShard::MODEL_WEIGHTS
+                                             ? WeightShard::MODEL_WEIGHTS : total);
+    }
+
+    // A bad copy was partly blended into a slot: back to its stored record,
+    // dropping local updates since the last save. With no record the blend
+    // stays; its header was never advanced, so nobody takes it as a merge.
+    void onMergeFailed(uint8_t slot) {
+        WeightShard& shard = shards_[slot];
+        if (store_.load(shard.header.shard_id, shard)) {
+            clean_version_[slot] = shard.header.version;
+            sent_mask_ &= ~(1u << slot);
+            moved_[slot] = WeightShard::MODEL_WEIGHTS;
+        }
+        delta_trackers_[slot].invalidate();
+    }
+
+    // A neighbour's copy was merged into a slot; `moved` weights differed
+    void noteMerge(uint8_t slot, uint32_t moved) {
+        addMoved(slot, moved);
+        if (moved >= GOSSIP_DISAGREE_WEIGHTS) {
+            gossip_timer_.disagree();
+        } else {
+            gossip_timer_.agree();
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    // Work Leases (once per gossip round, before the heartbeat)
+    //-------------------------------------------------------------------------
+    static constexpr uint8_t LEASE_ROUNDS = LEASE_MS / HEARTBEAT_INTERVAL_MS;
+    static constexpr uint8_t LEASE_RETURN_ROUNDS = 2;   // Owner's slack for the way back
+    static_assert(LEASE_MS / HEARTBEAT_INTERVAL_MS + LEASE_RETURN_ROUNDS <= 0xFF,
+                  "Lease terms are counted in 8 bits");
+
+    void leaseStep() {
+        if (lent_shard_ != NO_SHARD && --lent_rounds_ == 0) {
+            lent_shard_ = NO_SHARD;  // Holder went quiet: train it ourselves again
+        }
+        if (leased_shard_ != NO_SHARD && --leased_rounds_ == 0) endLease();
+
+        bool unleased = lent_shard_ == NO_SHARD && leased_shard_ == NO_SHARD;
+        uint8_t throttle = scheduler_.getThrottleLevel();
+        bool busy = throttle >= LEASE_OFFER_LOAD ||
+                    scheduler_.getAIDutyCycle() >= MAX_CPU_DUTY_CYCLE;
+        mesh_.setLeaseOffer(unleased && busy ? chooseOffer() : NO_SHARD_ID);
+
+        uint16_t owner;
+        uint8_t id;
+        if (unleased && !busy && throttle <= LEASE_CLAIM_LOAD && !isDormant() &&
+            mesh_.findLeaseOffer(owner, id) && id < TOTAL_MODEL_SHARDS) {
+            mesh_.sendLease(owner, id, LeaseOp::CLAIM);
+        }
+    }
+
+    // Term over: the trained shard goes home. A full queue retries next round.
+    void endLease() {
+        uint8_t slot = slotOf(leased_shard_);
+        if (slot < MAX_SHARDS_IN_RAM) {
+            if (!mesh_.returnShard(leased_from_, shards_[slot])) {
+                leased_rounds_ = 1;
+                return;
+            }
+        } else {
+            mesh_.sendLease(leased_from_, leased_shard_, LeaseOp::RETURN);
+        }
+        leased_shard_ = NO_SHARD;
+    }
+
+    void onLease(uint16_t src, uint8_t shard_id, LeaseOp op) {
+        switch (op) {
+            case LeaseOp::CLAIM:
+                // First claim for what we still offer wins; later ones are ignored
+                if (shard_id != mesh_.getLeaseOffer() || slotOf(shard_id) >= MAX_SHARDS_IN_RAM) return;
+                lent_shard_ = shard_id;
+                lent_to_ = src;
+                lent_rounds_ = LEASE_ROUNDS + LEASE_RETURN_ROUNDS;
+                mesh_.setLeaseOffer(NO_SHARD_ID);
+                mesh_.sendLease(src, shard_id, LeaseOp::GRANT);
+                break;
+
+            case LeaseOp::GRANT:
+                if (leased_shard_ != NO_SHARD || lent_shard_ != NO_SHARD ||
+                    shard_id >= TOTAL_MODEL_SHARDS) return;
+                leased_shard_ = shard_id;
+                leased_from_ = src;
+                leased_rounds_ = LEASE_ROUNDS;
+                // Resident already: we were training it anyway, the owner
+                // just stops. Otherwise the next prefetch fetches it.
+                break;
+
+            case LeaseOp::RETURN:
+                if (src == lent_to_ && shard_id == lent_shard_) lent_shard_ = NO_SHARD;
+                break;
+        }
+    }
+
+    // Resident shard the fewest neighbours hold: least trained elsewhere
+    uint8_t chooseOffer() const {
+        uint8_t best = NO_SHARD_ID;
+        uint8_t best_holders = 0;
+        for (uint8_t i = 0; i < MAX_SHARDS_IN_RAM; i++) {
+            uint8_t id = shards_[i].header.shard_id;
+            uint8_t holders = mesh_.holderCount(id);
+            if (best == NO_SHARD_ID || holders < best_holders) {
+                best = id;
+                best_holders = holders;
+            }
+        }
+        return best;
+    }
+
+    // First slot from `from` that this node trains (its shard is not lent out)
+    uint8_t nextTrainSlot(uint8_t from) const {
+        for (uint8_t i = from; i < MAX_SHARDS_IN_RAM; i++) {
+            if (shards_[i].header.shard_id != lent_shard_) return i;
+        }
+        return MAX_SHARDS_IN_RAM;
+    }
+
+    uint8_t slotOf(uint8_t shard_id) const {
+        for (uint8_t i = 0; i < MAX_SHARDS_IN_RAM; i++) {
+            if (shards_[i].header.shard_id == shard_id) return i;
+        }
+        return MAX_SHARDS_IN_RAM;
+    }
+
+    // Everything we can serve: resident shards (with versions) plus the store
+    void fillHeldShards(HeldShards& held) const {
+        memset(held.bitmap, 0, sizeof(held.bitmap));
+        for (uint8_t id = 0; id < TOTAL_MODEL_SHARDS; id++) {
+            if (store_.contains(id)) held.bitmap[id >> 3] |= 1u << (id & 7);
+        }
+        for (uint8_t i = 0; i < MAX_SHARDS_IN_RAM; i++) {
+            uint8_t id = shards_[i].header.shard_id;
+            held.bitmap[id >> 3] |= 1u << (id & 7);
+        }
+        for (uint8_t i = 0; i < HEARTBEAT_RESIDENT_SLOTS; i++) {
+            bool listed = i < MAX_SHARDS_IN_RAM;
+            held.resident[i].shard_id = listed ? shards_[i].header.shard_id : NO_SHARD_ID;
+            held.resident[i].version = listed ? shards_[i].header.version : 0;
+        }
+    }
+
+    void gossipShard(uint8_t slot) {
+        WeightShard& shard = shards_[slot];
+        DeltaTracker& tracker = delta_trackers_[slot];
+
+        switch (mesh_.broadcastDelta(shard, tracker)) {
+            case DeltaResult::NEED_FULL:
+                // Queue full: keep needs_full and retry next interval
+                if (!mesh_.broadcastShard(shard)) return;
+                tracker.reset(shard.header.version);
+                break;
+            case DeltaResult::SENT:
+                break;  // The queue clears the marks and moves the base
+            case DeltaResult::BUSY:
+                return;
+            case DeltaResult::UNCHANGED:
+                // Chosen for neighbours that missed it: the same copy again
+                if (!mesh_.broadcastShard(shard)) return;
+                break;
+        }
+        sent_checksum_[slot] = shard.header.checksum;
+        sent_mask_ |= 1u << slot;
+        sent_round_[slot] = heartbeat_round_;
+        moved_[slot] = 0;
     }
 
     //-------------------------------------------------------------------------
     // Incoming Shard Handler
     //-------------------------------------------------------------------------
-    void onShardReceived(const WeightShard& incoming) {
+    // Returns true while `incoming` (the mesh's staging view) is kept for
+    // the write-behind save in residencyStep()
+    bool onShardReceived(const WeightShard& incoming) {
         for (uint8_t i = 0; i < MAX_SHARDS_IN_RAM; i++) {
             if (shards_[i].header.shard_id == incoming.header.shard_id) {
+                size_t differ = kernels::mark_diff_s8(shards_[i].weights, incoming.weights,
+                                                      WeightShard::MODEL_WEIGHTS,
+                                                      delta_trackers_[i].changed);
                 shards_[i].fedAvg(incoming);
-                return;
+                noteMerge(i, static_cast<uint32_t>(differ));
+                return false;
+            }
+        }
+        // About to be swapped in: merge into the prefetched copy instead
+        if (residency_phase_ == ResidencyPhase::PREFETCHED &&
+            spare_.header.shard_id == incoming.header.shard_id) {
+            spare_.fedAvg(incoming);
+            return false;
+        }
+        // Saved a page per residency step, never here (a save is a whole
+        // record of page programs). One waits at a time: a newer copy
+        // replaces one not started yet, else it is dropped (the mesh
+        // still holds it).
+        const WeightShard* staged = mesh_.heldStaged();
+        if (staged && staged_started_) return false;
+        if (staged) mesh_.releaseStaged(*staged);
+        return true;
+    }
+
+    // Sparse merge of one delta block into a resident shard. Merged weights
+    // are marked changed so they propagate with our next delta. A cluster
+    // member adopts its head's values (only the head's deltas reach it).
+    bool onDeltaReceived(const DeltaInfo& info, const uint8_t* bitmap,
+                         const int8_t* values, size_t value_count, bool complete) {
+        for (uint8_t i = 0; i < MAX_SHARDS_IN_RAM; i++) {
+            WeightShard& shard = shards_[i];
+            if (shard.header.shard_id != info.shard_id) continue;
+            if (mesh_.isReadOnly(shard)) return false;  // Fragments on air
+
+            uint16_t alpha_q8 = (mesh_.getClusterRole() == ClusterRole::MEMBER)
+                                ? 256 : WeightShard::blendFactor(shard.header.contributors,
+                                                                 info.contributors);
+            size_t first = static_cast<size_t>(info.block_idx) * DELTA_BLOCK_WEIGHTS;
+            if (first >= WeightShard::MODEL_WEIGHTS) return false;
+            const uint8_t* changed = delta_trackers_[i].changed + first / 8;
+            size_t changed_bytes = (WeightShard::MODEL_WEIGHTS - first + 7) / 8;
+            if (changed_bytes > DELTA_BITMAP_BYTES) changed_bytes = DELTA_BITMAP_BYTES;
+            uint32_t before = kernels::count_bits(changed, changed_bytes);
+            if (!shard.fedAvgDelta(first, DELTA_BLOCK_WEIGHTS, bitmap, values, value_count,
+                                   alpha_q8, delta_trackers_[i].changed)) {
+                return false;
             }
+            noteMerge(i, kernels::count_bits(changed, changed_bytes) - before);
+            if (complete) shard.header.version = shard.mergedVersion(info.version);
+            return true;
         }
-        saveShardToFlash(incoming);
+        return false;  // Not resident; a full shard is needed to store it
     }
 
     //-------------------------------------------------------------------------
@@ -380,6 +1197,7 @@ private:
         // Mesh topology
         f.hop_count_avg = 0;  // TODO
         f.shard_diversity = MAX_SHARDS_IN_RAM;  // Local only for now
+        memset(f.reserved, 0, sizeof(f.reserved));
     }
 
     //-------------------------------------------------------------------------
@@ -395,37 +1213,38 @@ private:
     }
 
     //-------------------------------------------------------------------------
-    // Forward Pass - Multi-Head Prediction
+    // Forward Pass - MLP from the layer table in model.h
+    //
+    // The eight outputs are the prediction heads (PredictionTargets order):
+    // mesh activity, power level, circadian, RSSI delta, scene, temp trend,
+    // plus two reserved heads.
     //-------------------------------------------------------------------------
-    void forward(const WeightShard& shard, const LocalFeatures& f, PredictionTargets& pred) {
-        const int8_t* feat = reinterpret_cast<const int8_t*>(&f);
-
-        // Each prediction head uses different weight offsets
-        // Head 0: mesh activity (weights 0-15)
-        // Head 1: power level (weights 16-31)
-        // Head 2: circadian (weights 32-47)
-        // Head 3: RSSI delta (weights 48-63)
-        // Head 4: scene (weights 64-79)
-        // Head 5: temp trend (weights 80-95)
+    const int8_t* layerInput(uint8_t layer) const {
+        return (layer == 0) ? reinterpret_cast<const int8_t*>(&sample_features_)
+                            : activations_[layer - 1];
+    }
 
-        auto computeHead = [&](size_t offset) -> int8_t {
-            accum_t sum = 0;
-            for (size_t i = 0; i < sizeof(LocalFeatures); i++) {
-                sum += static_cast<accum_t>(shard.weights[offset + i]) * feat[i];
-            }
-            // Activation: tanh approximation via clamping
-            int16_t result = sum >> 6;
-            if (result > 127) result = 127;
-            if (result < -128) result = -128;
-            return static_cast<int8_t>(result);
-        };
+    void forwardLayer(const WeightShard& shard, uint8_t layer) {
+        const LayerDesc& l = model::LAYERS[layer];
+        const int8_t* x = layerInput(layer);
+        const weight_t* w = &shard.weights[l.weight_offset];
+        const weight_t* bias = &shard.weights[l.bias_offset];
+        int8_t* y = activations_[layer];
+
+        for (uint8_t o = 0; o < l.out; o++) {
+            accum_t sum = kernels::dot_s8(w + o * l.in, x, l.in);
+            // Activation: ReLU on hidden layers, saturation (tanh-ish) on heads
+            accum_t v = (sum >> l.shift) + bias[o];
+            if (l.relu && v < 0) v = 0;
+            y[o] = kernels::sat8(v);
+        }
+    }
 
-        pred.next_mesh_activity = computeHead(0);
-        pred.next_power_level = computeHead(16);
-        pred.circadian_next = computeHead(32);
-        pred.neighbor_rssi_delta = computeHead(48);
-        pred.next_scene = computeHead(64);
-        pred.temperature_trend = computeHead(80);
+    void forward(const WeightShard& shard, PredictionTargets& pred) {
+        for (uint8_t layer = 0; layer < model::LAYER_COUNT; layer++) {
+            forwardLayer(shard, layer);
+        }
+        memcpy(&pred, activations_[model::LAYER_COUNT - 1], sizeof(pred));
     }
 
     //-------------------------------------------------------------------------
@@ -449,20 +1268,250 @@ private:
 
     //-------------------------------------------------------------------------
     // Backward Pass
+    //
+    // delta_ holds dLoss/dOutput of the layer being processed. Each layer
+    // folds dW = (delta * x) >> GRAD_SHIFT and dBias = delta into the
+    // gradient accumulator, then propagates delta through its weights
+    // (masked by the previous layer's ReLU) for the layer below.
     //-------------------------------------------------------------------------
-    void backward(const LocalFeatures& f, int8_t error, int8_t* gradients) {
-        const int8_t* feat = reinterpret_cast<const int8_t*>(&f);
-        for (size_t i = 0; i < sizeof(LocalFeatures); i++) {
-            int16_t g = static_cast<int16_t>(error) * feat[i] / 16;
-            gradients[i] = (g > 127) ? 127 : ((g < -128) ? -128 : static_cast<int8_t>(g));
+    void computeOutputDelta(const PredictionTargets& pred, const PredictionTargets& actual) {
+        const int8_t* p = reinterpret_cast<const int8_t*>(&pred);
+        const int8_t* t = reinterpret_cast<const int8_t*>(&actual);
+        for (uint8_t o = 0; o < model::OUTPUT_SIZE; o++) {
+            int32_t err = static_cast<int32_t>(p[o]) - t[o];
+            delta_[o] = kernels::sat8((err * model::HEAD_LOSS_WEIGHT[o]) >> 1);
+        }
+    }
+
+    void backwardLayer(const WeightShard& shard, uint8_t layer) {
+        const LayerDesc& l = model::LAYERS[layer];
+        const int8_t* x = layerInput(layer);
+        const weight_t* w = &shard.weights[l.weight_offset];
+        bool propagate = layer > 0;
+
+        if (propagate) memset(backprop_acc_, 0, l.in * sizeof(backprop_acc_[0]));
+
+        for (uint8_t o = 0; o < l.out; o++) {
+            kernels::scale_s8(x, delta_[o], model::GRAD_SHIFT, grad_row_, l.in);
+            gradient_accum_.accumulateAt(l.weight_offset + o * l.in, grad_row_, l.in, round_rng_);
+            if (propagate) kernels::axpy_s8(backprop_acc_, w + o * l.in, delta_[o], l.in);
+        }
+        gradient_accum_.accumulateAt(l.bias_offset, delta_, l.out, round_rng_);
+
+        if (propagate) {
+            bool relu = model::LAYERS[layer - 1].relu;
+            for (uint8_t i = 0; i < l.in; i++) {
+                delta_[i] = (relu && x[i] <= 0) ? 0 : kernels::sat8(backprop_acc_[i] >> l.shift);
+            }
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    // Shard Residency (background prefetch, swap, write-behind)
+    //
+    // IDLE -> PREFETCHED: the stalest non-resident shard is loaded into
+    //   spare_ (staleness weighted by how many neighbours hold it, so the
+    //   whole model keeps cycling and shards with FedAvg partners come first).
+    // PREFETCHED -> swap: once SHARD_ROTATION_MS has passed, spare_ trades
+    //   places with the longest-resident slot that is not mid-sample or on
+    //   air. That swap is the only foreground cost.
+    // EVICTED: the evicted shard, now in spare_, moved since it was loaded
+    //   and waits for the store's writer (another write in progress, or no
+    //   sector yet); spare_ holds its only copy until then.
+    // FLUSHING: spare_ is written a page per step, then back to IDLE.
+    // Between those, a copy received for a shard not in RAM is written the
+    // same way straight from its staging sector (onShardReceived()).
+    //-------------------------------------------------------------------------
+    bool residencyStep(uint32_t budget_us) {
+        uint32_t start = clock_time();
+
+        const WeightShard* staged = mesh_.heldStaged();
+        if (staged && (residency_phase_ == ResidencyPhase::IDLE ||
+                       residency_phase_ == ResidencyPhase::PREFETCHED)) {
+            if (!staged_started_) {
+                if (!store_.beginWrite(*staged)) return false;  // No sector yet; after GC
+                staged_started_ = true;
+            }
+            if (flushPages(start, budget_us)) return true;
+            mesh_.releaseStaged(*staged);
+            staged_started_ = false;
+            return true;
+        }
+
+        switch (residency_phase_) {
+            case ResidencyPhase::IDLE: {
+                if (budget_us < SHARD_LOAD_US) return true;
+                uint8_t id = choosePrefetch();
+                if (id == NO_SHARD) return false;
+                if (!store_.load(id, spare_)) {
+                    // Never stored here: start fresh and pull a trained copy
+                    // from a neighbour; it merges in once it is resident
+                    spare_.init(id);
+                    if (id != leased_shard_) mesh_.requestShard(id);
+                }
+                // A leased shard is the owner's: always take its copy
+                if (id == leased_shard_) mesh_.requestShardFrom(leased_from_, id);
+                spare_clean_version_ = spare_.header.version;
+                residency_phase_ = ResidencyPhase::PREFETCHED;
+                return false;
+            }
+
+            case ResidencyPhase::PREFETCHED: {
+                uint32_t elapsed_ms = (start - last_swap_tick_) / (HWScheduler::TICK_PER_US * 1000);
+                if (elapsed_ms < SHARD_ROTATION_MS && spare_.header.shard_id != leased_shard_) {
+                    return false;  // A leased shard goes in at once
+                }
+
+                uint8_t slot = chooseVictim();
+                if (slot >= MAX_SHARDS_IN_RAM) return false;  // All busy; retry next slice
+                bool dirty = isDirty(slot);
+                swapWithSpare(slot);
+                last_swap_tick_ = start;
+
+                if (!dirty) {
+                    residency_phase_ = ResidencyPhase::IDLE;
+                    return true;
+                }
+                residency_phase_ = store_.beginWrite(spare_) ? ResidencyPhase::FLUSHING
+                                                             : ResidencyPhase::EVICTED;
+                return true;
+            }
+
+            case ResidencyPhase::EVICTED:
+                if (!store_.beginWrite(spare_)) return false;  // Retry next slice
+                residency_phase_ = ResidencyPhase::FLUSHING;
+                return true;
+
+            case ResidencyPhase::FLUSHING:
+                if (!flushPages(start, budget_us)) residency_phase_ = ResidencyPhase::IDLE;
+                return true;
+        }
+        return false;
+    }
+
+    // Program store pages while the budget fits one; false once committed
+    bool flushPages(uint32_t start, uint32_t budget_us) {
+        while ((clock_time() - start) / HWScheduler::TICK_PER_US + FLASH_PROGRAM_US <= budget_us) {
+            if (!store_.writeStep()) return false;
         }
+        return true;
     }
 
     //-------------------------------------------------------------------------
-    // Flash Persistence
+    // Checkpoint (background, a page per step)
+    //
+    // The sample ring is written in place (no sample is collected until
+    // the record commits); the small fields are snapshotted into
+    // checkpoint_. The accumulator is not kept: a pass cut short loses one
+    // slot's partial batch. Shard weights are not part of it either:
+    // restore() reloads each resident shard's latest store record
+    // (write-behind saves a shard on every eviction, so at most one
+    // residency period of its training is lost). The stale slot is erased
+    // afterwards.
     //-------------------------------------------------------------------------
-    void saveShardToFlash(const WeightShard& shard);
-    bool loadShardFromFlash(uint8_t shard_id, WeightShard& shard);
+    bool checkpointStep(uint32_t budget_us) {
+        uint32_t start = clock_time();
+        checkpoint_elapsed_ms_ += (start - last_checkpoint_tick_) / (HWScheduler::TICK_PER_US * 1000);
+        last_checkpoint_tick_ = start;
+
+        if (checkpoints_.writing()) {
+            while ((clock_time() - start) / HWScheduler::TICK_PER_US + FLASH_PROGRAM_US <= budget_us) {
+                if (!checkpoints_.writeStep()) return true;  // Committed; erase the old slot next
+            }
+            return true;
+        }
+        if (checkpoints_.maintenanceStep(budget_us)) return true;
+
+        if (checkpoint_elapsed_ms_ < CHECKPOINT_INTERVAL_MS || local_epoch_ == checkpoint_epoch_) {
+            return false;
+        }
+
+        checkpoint_.local_epoch = local_epoch_;
+        checkpoint_.residency_round = residency_round_;
+        for (uint8_t i = 0; i < MAX_SHARDS_IN_RAM; i++) {
+            checkpoint_.resident[i] = shards_[i].header.shard_id;
+        }
+        checkpoint_.coherence = coherence_score_;
+        checkpoint_.prev_features = prev_features_;
+        if (!checkpoints_.beginWrite(&checkpoint_, sizeof(checkpoint_), &samples_, sizeof(samples_))) {
+            return false;
+        }
+        checkpoint_elapsed_ms_ = 0;
+        checkpoint_epoch_ = local_epoch_;
+        return true;
+    }
+
+    // Slot IDs in range and distinct
+    static bool validCheckpoint(const EngineCheckpoint& ck) {
+        uint64_t seen = 0;
+        for (uint8_t i = 0; i < MAX_SHARDS_IN_RAM; i++) {
+            uint8_t id = ck.resident[i];
+            if (id >= TOTAL_MODEL_SHARDS || (seen >> id & 1)) return false;
+            seen |= 1ull << id;
+        }
+        return true;
+    }
+
+    bool isDirty(uint8_t slot) const {
+        return shards_[slot].header.version != clean_version_[slot];
+    }
+
+    uint8_t choosePrefetch() const {
+        if (leased_shard_ != NO_SHARD && !isResident(leased_shard_)) return leased_shard_;
+        uint8_t best = NO_SHARD;
+        uint32_t best_score = 0;
+        for (uint8_t id = 0; id < TOTAL_MODEL_SHARDS; id++) {
+            if (isResident(id)) continue;
+            uint32_t staleness = static_cast<uint16_t>(residency_round_ - last_resident_round_[id]);
+            uint32_t score = staleness * (1 + mesh_.holderCount(id));
+            if (best == NO_SHARD || score > best_score) {
+                best = id;
+                best_score = score;
+            }
+        }
+        return best;
+    }
+
+    // Longest-resident slot that can be swapped right now
+    uint8_t chooseVictim() const {
+        uint8_t best = MAX_SHARDS_IN_RAM;
+        for (uint8_t i = 0; i < MAX_SHARDS_IN_RAM; i++) {
+            bool in_sample = train_phase_ != TrainPhase::BATCH && i == sample_slot_;
+            if (in_sample || mesh_.isTransmitting(shards_[i])) continue;
+            if (shards_[i].header.shard_id == leased_shard_) continue;  // Held for its owner
+            if (best == MAX_SHARDS_IN_RAM ||
+                static_cast<int16_t>(resident_since_[i] - resident_since_[best]) < 0) {
+                best = i;
+            }
+        }
+        return best;
+    }
+
+    bool isResident(uint8_t shard_id) const {
+        for (uint8_t i = 0; i < MAX_SHARDS_IN_RAM; i++) {
+            if (shards_[i].header.shard_id == shard_id) return true;
+        }
+        return false;
+    }
+
+    // Exchange a slot with the spare buffer in place (no third 4KB buffer)
+    void swapWithSpare(uint8_t slot) {
+        uint32_t* a = reinterpret_cast<uint32_t*>(&shards_[slot]);
+        uint32_t* b = reinterpret_cast<uint32_t*>(&spare_);
+        for (size_t i = 0; i < sizeof(WeightShard) / 4; i++) {
+            uint32_t t = a[i];
+            a[i] = b[i];
+            b[i] = t;
+        }
+
+        uint8_t evicted_id = spare_.header.shard_id;
+        last_resident_round_[evicted_id] = residency_round_;
+        resident_since_[slot] = residency_round_++;
+        clean_version_[slot] = spare_clean_version_;
+        delta_trackers_[slot].invalidate();
+        sent_mask_ &= ~(1u << slot);
+        moved_[slot] = WeightShard::MODEL_WEIGHTS;
+    }
 
     //-------------------------------------------------------------------------
     // State
@@ -470,20 +1519,90 @@ private:
     HWScheduler&    scheduler_;
     MeshGossip&     mesh_;
     LightController& light_;
+    ShardStore&     store_;
 
     WeightShard     shards_[MAX_SHARDS_IN_RAM];
+    DeltaTracker    delta_trackers_[MAX_SHARDS_IN_RAM];
     GradientAccum   gradient_accum_;
 
-    uint8_t         current_shard_idx_;
     uint16_t        local_epoch_;
-    uint8_t         samples_since_sync_;
-    uint32_t        last_gossip_tick_;
+    uint32_t        last_heartbeat_tick_;
+    uint8_t         heartbeat_round_;    // Heartbeats sent (wraps)
+    uint8_t         broadcast_slot_;     // First slot to take a score tie (per engine: a
+                                         // head must cycle all of them for its members)
+    uint16_t        cluster_head_;       // Head our delta bases were sent to
+    static_assert(MAX_SHARDS_IN_RAM <= 16, "sent_mask_ holds a bit per slot");
+    uint16_t        sent_checksum_[MAX_SHARDS_IN_RAM];  // Content of the last broadcast
+    uint16_t        sent_mask_;          // Bit per slot whose sent_checksum_ is current
+    uint8_t         sent_round_[MAX_SHARDS_IN_RAM];     // heartbeat_round_ of the last broadcast
+    uint16_t        moved_[MAX_SHARDS_IN_RAM];          // Weights moved since it (approx.)
+    uint16_t        pass_moved_;         // Moved by the training pass being applied
+    GossipTimer     gossip_timer_;
 
     float           coherence_score_;
 
-    // Previous state for temporal learning
+    // Sample ring; prev_features_ is the input of the next sample
+    SampleRing         samples_;
     LocalFeatures      prev_features_;
-    PredictionTargets  prev_targets_;
+    uint32_t           last_sample_tick_;
+
+    // Change detection (keepSample())
+    static constexpr uint16_t DORMANT_AFTER_SAMPLES = DORMANT_AFTER_MS / SAMPLE_PERIOD_MS;
+    static constexpr uint16_t DORMANT_SAMPLE_EVERY = DORMANT_SAMPLE_MS / SAMPLE_PERIOD_MS;
+    uint16_t           quiet_samples_;       // Unchanged samples since the last wake
+    uint8_t            light_commands_;      // LightController::getCommandCount() seen
+
+    // Resumable training step state
+    enum class TrainPhase : uint8_t {
+        BATCH, SAMPLE, FORWARD, LOSS, BACKWARD, ACCUMULATE, APPLY, COMMIT, COUNT
+    };
+    TrainPhase         train_phase_;
+    uint8_t            batch_[BATCH_NEW_SAMPLES + BATCH_REPLAY_SAMPLES];  // SampleRing::at()
+    uint8_t            batch_len_;
+    uint8_t            batch_cursor_;
+    alignas(4) LocalFeatures sample_features_;
+    PredictionTargets  sample_targets_;
+    PredictionTargets  sample_predicted_;
+    uint8_t            sample_slot_;         // Slot the pass is training
+    uint8_t            layer_cursor_;
+    int8_t             sample_error_;
+    uint16_t           apply_cursor_;
+    int32_t            apply_scale_q24_;     // lr * coherence / samples, Q24
+    uint32_t           round_rng_;           // xorshift32: stochastic rounding, replay draws
+    uint16_t           phase_cost_us_[static_cast<uint8_t>(TrainPhase::COUNT)];
+
+    // Forward activations per layer and backprop scratch
+    alignas(4) int8_t  activations_[model::LAYER_COUNT][model::MAX_WIDTH];
+    alignas(4) int8_t  delta_[model::MAX_WIDTH];
+    alignas(4) int8_t  grad_row_[model::MAX_WIDTH];
+    int32_t            backprop_acc_[model::MAX_WIDTH];
+
+    // Shard residency
+    enum class ResidencyPhase : uint8_t { IDLE, PREFETCHED, EVICTED, FLUSHING };
+    ResidencyPhase     residency_phase_;
+    WeightShard        spare_;               // Incoming before a swap, outgoing after
+    uint8_t            clean_version_[MAX_SHARDS_IN_RAM];  // Version as loaded/saved
+    uint16_t           resident_since_[MAX_SHARDS_IN_RAM] = {};
+    uint16_t           last_resident_round_[TOTAL_MODEL_SHARDS];  // Staleness
+    uint16_t           residency_round_;
+    uint32_t           last_swap_tick_;
+    uint8_t            spare_clean_version_;
+    bool               staged_started_ = false;  // mesh_.heldStaged() is being written
+
+    // Checkpoint
+    CheckpointStore&   checkpoints_;
+    EngineCheckpoint   checkpoint_;          // Snapshot being written
+    uint32_t           last_checkpoint_tick_;
+    uint32_t           checkpoint_elapsed_ms_;  // Summed per step: ticks wrap in ~268s
+    uint16_t           checkpoint_epoch_;    // Epoch of the last checkpoint
+
+    // Work leases, at most one each way (not checkpointed: both ends time out)
+    uint8_t            lent_shard_;          // Ours, trained by lent_to_; skipped in passes
+    uint16_t           lent_to_;
+    uint8_t            lent_rounds_;         // Gossip rounds until we take it back
+    uint8_t            leased_shard_;        // A neighbour's, trained here for leased_from_
+    uint16_t           leased_from_;
+    uint8_t            leased_rounds_;       // Gossip rounds until it goes back
 };
 
 }  // namespace planetary
@@ -6,7 +6,23 @@
  *
  * Called from:
  *   - mesh_light_ctl_cb() - immediate target set
+ *   - mesh_scene_*_cb()   - store / recall a scene
  *   - main_loop() at 50Hz - smooth transition updates
+ *
+ * A transition is planned once in setTarget(): the start point, the
+ * signed distance to the target and a Q16 phase increment that walks the
+ * EASE table (smoothstep, so it starts and lands with zero velocity) in
+ * exactly `steps` ticks. update() then costs one add on the phase, a table
+ * read and a multiply per channel - no divisions - and the last tick lands
+ * on the target by construction rather than by a snap.
+ *
+ * PWM duty comes from the GAMMA table (CIE 1931 lightness, so equal
+ * brightness steps look equal) split by the MIX table between the warm
+ * and cool channels. A channel whose duty did not change is not written.
+ *
+ * A group or scene transition is one mesh command: a Light CTL Set or
+ * Scene Recall to a group address reaches every subscribed bulb, and each
+ * plans the same curve from the same duration, so the group moves in step.
  */
 
 #ifndef LIGHT_CONTROLLER_H
@@ -24,57 +40,137 @@ constexpr uint8_t PWM_ID_LED_COOL = 1;
 
 namespace planetary {
 
+// Lookup tables, generated at compile time into .rodata (flash)
+struct LightTables {
+    static constexpr uint16_t EASE_SEGMENTS = 256;
+    static constexpr uint16_t ONE_Q15 = 1u << 15;
+
+    uint16_t gamma[256];                 // Brightness -> 16-bit PWM duty
+    uint16_t ease[EASE_SEGMENTS + 1];    // Smoothstep progress, Q15
+    uint16_t mix[101];                   // Color temp -> warm share of duty, Q15
+
+    constexpr LightTables() : gamma(), ease(), mix() {
+        for (int b = 0; b < 256; b++) {
+            // CIE 1931: relative luminance for lightness L* = 100 * b / 255
+            double l = 100.0 * b / 255.0;
+            double y = (l <= 8.0) ? l / 903.3 : cube((l + 16.0) / 116.0);
+            gamma[b] = static_cast<uint16_t>(y * 65535.0 + 0.5);
+        }
+        for (int i = 0; i <= EASE_SEGMENTS; i++) {
+            double t = static_cast<double>(i) / EASE_SEGMENTS;
+            ease[i] = static_cast<uint16_t>((3.0 - 2.0 * t) * t * t * ONE_Q15 + 0.5);
+        }
+        for (int ct = 0; ct <= 100; ct++) {
+            mix[ct] = static_cast<uint16_t>((ct * ONE_Q15 + 50) / 100);
+        }
+    }
+
+    static constexpr double cube(double x) { return x * x * x; }
+};
+
+inline constexpr LightTables LIGHT_TABLES{};
+
 class LightController {
 public:
+    static constexpr uint8_t  SCENE_SLOTS = 8;
+    static constexpr uint16_t NO_SCENE = 0;      // Scene number 0 is prohibited by the mesh spec
+    static constexpr uint16_t TICK_MS = 20;      // update() period
+
     struct State {
-        uint8_t brightness;        // Current 0-255
-        uint8_t color_temp;        // Current 0-100 (warm to cool)
-        uint8_t target_brightness; // Target brightness
-        uint8_t target_temp;       // Target color temp
-        uint8_t transition_steps;  // Remaining steps at 50Hz
-        bool    on;
+        uint8_t  brightness;        // Current 0-255
+        uint8_t  color_temp;        // Current 0-100 (warm to cool)
+        uint8_t  target_brightness; // Target brightness
+        uint8_t  target_temp;       // Target color temp
+        uint16_t transition_steps;  // Remaining steps at 50Hz
+        bool     on;
     };
 
-    LightController() : state_{100, 50, 100, 50, 0, true} {}
+    // Scene register entry: the target a Scene Store captured
+    struct SceneEntry {
+        uint16_t number;            // NO_SCENE when free
+        uint8_t  brightness;
+        uint8_t  color_temp;
+    };
+
+    LightController() : state_{100, 50, 100, 50, 0, true}, commands_(0),
+                        start_brightness_(100), start_temp_(50), delta_brightness_(0),
+                        delta_temp_(0), phase_(0), phase_step_(0), warm_duty_(0),
+                        cool_duty_(0), scenes_() {}
 
     // Called from mesh_light_ctl_cb - MUST complete in <100us
     void setTarget(uint8_t brightness, uint8_t temp, uint16_t transition_ms = 0) {
+        commands_++;
+        if (temp > 100) temp = 100;
         state_.target_brightness = brightness;
         state_.target_temp = temp;
         state_.on = (brightness > 0);
 
-        if (transition_ms == 0) {
+        uint16_t steps = transition_ms / TICK_MS;
+        if (transition_ms != 0 && steps == 0) steps = 1;
+        if (steps == 0 || (brightness == state_.brightness && temp == state_.color_temp)) {
             // Instant change
             state_.brightness = brightness;
             state_.color_temp = temp;
             state_.transition_steps = 0;
             applyPWM();
-        } else {
-            // Smooth transition at 50Hz
-            state_.transition_steps = transition_ms / 20;
-            if (state_.transition_steps == 0) state_.transition_steps = 1;
+            return;
         }
+
+        // Plan the whole curve from the current point, even mid-transition
+        start_brightness_ = state_.brightness;
+        start_temp_ = state_.color_temp;
+        delta_brightness_ = static_cast<int16_t>(brightness - state_.brightness);
+        delta_temp_ = static_cast<int16_t>(temp - state_.color_temp);
+        phase_ = 0;
+        phase_step_ = (static_cast<uint32_t>(LightTables::EASE_SEGMENTS) << 16) / steps;
+        state_.transition_steps = steps;
     }
 
     // Called from main loop at 50Hz - smooth transitions
     void update() {
-        if (state_.transition_steps > 0) {
-            // Ease-out interpolation
-            int16_t bright_delta = state_.target_brightness - state_.brightness;
-            int16_t temp_delta = state_.target_temp - state_.color_temp;
+        if (state_.transition_steps == 0) return;
 
-            state_.brightness += bright_delta / state_.transition_steps;
-            state_.color_temp += temp_delta / state_.transition_steps;
-            state_.transition_steps--;
+        if (--state_.transition_steps == 0) {
+            state_.brightness = state_.target_brightness;
+            state_.color_temp = state_.target_temp;
+        } else {
+            phase_ += phase_step_;
+            int32_t e = LIGHT_TABLES.ease[phase_ >> 16];
+            state_.brightness = static_cast<uint8_t>(
+                start_brightness_ + ((delta_brightness_ * e + (LightTables::ONE_Q15 >> 1)) >> 15));
+            state_.color_temp = static_cast<uint8_t>(
+                start_temp_ + ((delta_temp_ * e + (LightTables::ONE_Q15 >> 1)) >> 15));
+        }
+        applyPWM();
+    }
 
-            // Snap to target on last step
-            if (state_.transition_steps == 0) {
-                state_.brightness = state_.target_brightness;
-                state_.color_temp = state_.target_temp;
-            }
+    // Scene Store: remember the current target under `number`. False if
+    // the number is invalid or the register is full.
+    bool storeScene(uint16_t number) {
+        if (number == NO_SCENE) return false;
+        SceneEntry* slot = findScene(number);
+        if (!slot) slot = findScene(NO_SCENE);
+        if (!slot) return false;
+        slot->number = number;
+        slot->brightness = state_.target_brightness;
+        slot->color_temp = state_.target_temp;
+        return true;
+    }
 
-            applyPWM();
-        }
+    // Scene Recall: one command moves the light (and every bulb of the
+    // group it was sent to) to the stored target. False if unknown.
+    bool recallScene(uint16_t number, uint16_t transition_ms) {
+        const SceneEntry* slot = (number == NO_SCENE) ? nullptr : findScene(number);
+        if (!slot) return false;
+        setTarget(slot->brightness, slot->color_temp, transition_ms);
+        return true;
+    }
+
+    bool deleteScene(uint16_t number) {
+        SceneEntry* slot = (number == NO_SCENE) ? nullptr : findScene(number);
+        if (!slot) return false;
+        slot->number = NO_SCENE;
+        return true;
     }
 
     // Power estimate for LearningEngine features (0-100 scale)
@@ -98,6 +194,9 @@ public:
     uint8_t getBrightness() const { return state_.brightness; }
     uint8_t getColorTemp() const { return state_.color_temp; }
 
+    // setTarget() calls so far (wrapping); a change wakes dormant training
+    uint8_t getCommandCount() const { return commands_; }
+
     // Scene detection - helps predict user patterns
     enum class Scene : uint8_t {
         OFF = 0,
@@ -127,22 +226,46 @@ public:
     }
 
 private:
+    // Brightness 0 maps to duty 0, so fading out needs no special case
     void applyPWM() {
-        if (!state_.on) {
-            pwm_set_duty(PWM_ID_LED_WARM, 0);
-            pwm_set_duty(PWM_ID_LED_COOL, 0);
-            return;
-        }
+        uint32_t duty = LIGHT_TABLES.gamma[state_.brightness];
+        uint16_t warm = static_cast<uint16_t>((duty * LIGHT_TABLES.mix[state_.color_temp]) >> 15);
+        uint16_t cool = static_cast<uint16_t>(duty - warm);
 
-        // Calculate PWM duties (0-65535 for 16-bit PWM)
-        uint16_t warm = (static_cast<uint32_t>(state_.brightness) * state_.color_temp * 257) / 100;
-        uint16_t cool = (static_cast<uint32_t>(state_.brightness) * (100 - state_.color_temp) * 257) / 100;
+        // PWM registers reset to 0, matching the initial cache
+        if (warm != warm_duty_) {
+            pwm_set_duty(PWM_ID_LED_WARM, warm);
+            warm_duty_ = warm;
+        }
+        if (cool != cool_duty_) {
+            pwm_set_duty(PWM_ID_LED_COOL, cool);
+            cool_duty_ = cool;
+        }
+    }
 
-        pwm_set_duty(PWM_ID_LED_WARM, warm);
-        pwm_set_duty(PWM_ID_LED_COOL, cool);
+    SceneEntry* findScene(uint16_t number) {
+        for (uint8_t i = 0; i < SCENE_SLOTS; i++) {
+            if (scenes_[i].number == number) return &scenes_[i];
+        }
+        return nullptr;
     }
 
-    State state_;
+    State   state_;
+    uint8_t commands_;
+
+    // Transition planned by setTarget()
+    uint8_t  start_brightness_;
+    uint8_t  start_temp_;
+    int16_t  delta_brightness_;
+    int16_t  delta_temp_;
+    uint32_t phase_;             // Q16 index into LIGHT_TABLES.ease
+    uint32_t phase_step_;        // Per tick
+
+    // Last duty written per channel
+    uint16_t warm_duty_;
+    uint16_t cool_duty_;
+
+    SceneEntry scenes_[SCENE_SLOTS];
 };
 
 }  // namespace planetary
@@ -6,10 +6,51 @@
  * backpressure signaling.
  *
  * Message Types:
- *   - WEIGHT_UPDATE: Broadcast a shard's weights
- *   - WEIGHT_REQUEST: Ask neighbors for a specific shard
+ *   - SHARD_FRAGMENT: One FRAGMENT_SIZE slice of a shard
+ *   - WEIGHT_REQUEST: Ask one holder for a specific shard
  *   - HEARTBEAT: Announce presence and capacity
  *   - BACKPRESSURE: Signal to slow down
+ *   - WEIGHT_DELTA: Sparse changes to a shard since a base version
+ *   - NACK: Fragments missing from a stalled shard reassembly
+ *   - LEASE: Claim, grant or return the training of a shard
+ *
+ * Full shards are not sent in one burst: broadcastShard() queues the
+ * shard and pumpTx() trickles its fragments out a few per BLE event,
+ * read straight from the resident shard at send time. A receiver whose
+ * reassembly stalls NACKs the missing-fragment bitmap and the sender
+ * resends only those fragments.
+ *
+ * Fragment k always carries wire bytes [k * FRAGMENT_SIZE, +FRAGMENT_SIZE)
+ * of the shard. Trained weights rarely need all 8 bits, so the sender
+ * block-packs those bytes losslessly (GOSSIP_FLAG_PACKED) whenever that
+ * is shorter, and the receiver unpacks them before merging or staging:
+ * each fragment decodes on its own, in any order, and a repair resends
+ * the same bytes. RAM and flash keep plain int8 shards.
+ *
+ * Heartbeats advertise which shards a node can serve (RAM or flash). A
+ * node missing a shard unicasts WEIGHT_REQUEST to the best holder, which
+ * answers through the same paced queue, reading RAM or flash in place.
+ *
+ * Reassembly holds no shard-sized buffer. A fragment of a shard we hold
+ * is FedAvg-blended straight into the resident copy; any other shard is
+ * written to a flash staging sector and handed over from there.
+ *
+ * Small meshes flood: every node broadcasts its shards (TTL 3) and merges
+ * everything it hears, which costs O(N^2) airtime once relays are counted.
+ * From CLUSTER_MIN_NEIGHBORS on, nodes elect cluster heads from the
+ * heartbeats instead. Members unicast their shards one hop to their head
+ * and adopt what that head sends; heads merge their members and each
+ * other, and one TTL 3 broadcast per head both forwards the aggregate to
+ * the other heads and pushes it back down to its members.
+ *
+ * Work leases: a hot or busy node offers one resident shard in its
+ * heartbeat. An idle neighbour CLAIMs it, the owner GRANTs the first
+ * claim and stops training that shard, and the holder trains it on its
+ * own samples until the lease runs out, then sends the shard back
+ * (unicast, as a reply) with a RETURN. Policy lives in the engine; this
+ * layer only carries the offers and the three messages.
+ *
+ * Wire encoding, decoding views and the TX gather list: gossip_codec.h.
  */
 
 #ifndef MESH_GOSSIP_H
@@ -17,229 +58,1224 @@
 
 #include "neuron_config.h"
 #include "weight_shard.h"
+#include "hw_scheduler.h"
+#include "trace.h"
+#include "gossip_codec.h"
 #include <string.h>
 
 namespace planetary {
 
-// Vendor Model IDs (Telink's vendor range)
-constexpr uint32_t VENDOR_MODEL_ID = 0x0211;  // Company ID + Model
-constexpr uint16_t COMPANY_ID      = 0x0211;  // Telink
-
-// Opcode definitions (3-byte vendor opcodes)
-enum class GossipOpcode : uint8_t {
-    WEIGHT_UPDATE   = 0xC0,  // Shard data
-    WEIGHT_REQUEST  = 0xC1,  // Request shard
-    HEARTBEAT       = 0xC2,  // I'm alive
-    BACKPRESSURE    = 0xC3,  // Slow down!
-    SHARD_FRAGMENT  = 0xC4,  // Fragmented shard (for large transfers)
-    ACK             = 0xC5   // Acknowledgment
-};
+constexpr uint16_t MESH_ADDR_ALL = 0xFFFF;        // Broadcast destination
 
-// Message headers
-struct GossipHeader {
-    uint8_t  opcode;
-    uint8_t  ttl;            // Hops remaining
-    uint16_t src_addr;       // Originating node
-    uint8_t  seq_num;        // For deduplication
-    uint8_t  flags;
-} __attribute__((packed));
+// Message bodies. Layout only: received bytes are read through the views
+// below, outgoing ones encoded with wire::Writer (see gossip_codec.h).
 
 // Fragment info for large shard transfers
 struct FragmentInfo {
     uint8_t shard_id;
     uint8_t fragment_idx;    // 0-15 (4KB / 256 = 16 fragments)
     uint8_t total_fragments;
-    uint8_t reserved;
+    uint8_t content_tag;     // Low byte of the shard checksum being sent
+} __attribute__((packed));
+
+// Selective-repeat request from a stalled reassembly
+struct NackInfo {
+    uint16_t target_addr;    // Sender asked to repair (NACKs are broadcast)
+    uint8_t  shard_id;
+    uint8_t  content_tag;    // Tag of the fragments already held (GOSSIP_FLAG_DELTA: delta version)
+    uint16_t missing;        // Bit per fragment index (or delta block) to resend
+} __attribute__((packed));
+
+// WEIGHT_REQUEST: MESH_ADDR_ALL asks anyone with the shard in RAM
+struct ShardRequest {
+    uint16_t target_addr;    // Holder chosen from its heartbeat
+    uint8_t  shard_id;
+} __attribute__((packed));
+
+// STATS request; an empty payload means every node, no reset
+struct StatsRequest {
+    uint16_t target_addr;    // 0xFFFF for every node that hears it
+    uint8_t  flags;          // STATS_FLAG_RESET
+} __attribute__((packed));
+
+constexpr uint8_t STATS_FLAG_RESET = 0x01;  // Clear histograms after replying
+
+enum class LeaseOp : uint8_t {
+    CLAIM  = 0,   // Idle node -> owner: I will train the shard you offer
+    GRANT  = 1,   // Owner -> first claimant: it is yours until the lease ends
+    RETURN = 2    // Holder -> owner: lease over, trained shard follows
+};
+
+// LEASE: always unicast, ignored by everyone but target_addr
+struct LeaseInfo {
+    uint16_t target_addr;
+    uint8_t  shard_id;
+    uint8_t  op;             // LeaseOp
+} __attribute__((packed));
+
+// One trace point of a STATS reply
+struct TraceStatWire {
+    uint16_t count;          // Saturates at 0xFFFF
+    uint16_t avg_us;
+    uint16_t max_us;
+    uint16_t hist[TRACE_BUCKETS];  // log2(us) buckets
+} __attribute__((packed));
+
+struct StatsPayload {
+    uint8_t       ai_duty;       // % of the last DUTY_WINDOW_MS spent in AI tasks
+    uint8_t       task_count;
+    uint8_t       point_count;   // TRACE_POINTS
+    uint8_t       reserved;
+    uint8_t       task_duty[TRACE_MAX_TASKS];  // % per task, registration order
+    TraceStatWire points[TRACE_POINTS];        // TracePoint order
+} __attribute__((packed));
+
+static_assert(sizeof(StatsPayload) > sizeof(StatsRequest), "Reply must be longer than a request");
+static_assert(GOSSIP_OVERHEAD + sizeof(StatsPayload) <= MESH_MSG_MAX_SIZE, "STATS reply must fit the MTU");
+
+// Sparse weight delta: one message per dirty block of DELTA_BLOCK_WEIGHTS,
+// followed by a change bitmap and the new value of every marked weight.
+// A NACK repair (GOSSIP_FLAG_RETRANSMIT) resends a missed block dense,
+// every weight marked, and lists only the blocks still missing.
+struct DeltaInfo {
+    uint8_t  shard_id;
+    uint8_t  base_version;   // Sender's version at its previous broadcast
+    uint8_t  version;        // Sender's version now
+    uint8_t  block_idx;      // Weights [block_idx * 256, +256)
+    uint16_t contributors;   // Sender's FedAvg weight
+    uint16_t blocks;         // Every block of this delta, a bit per block_idx
+    uint16_t crc;            // CRC16 over bitmap + values
+} __attribute__((packed));
+
+constexpr uint16_t DELTA_BLOCK_WEIGHTS = 256;
+constexpr uint8_t  DELTA_BITMAP_BYTES  = DELTA_BLOCK_WEIGHTS / 8;
+constexpr uint8_t  DELTA_BLOCKS = (WeightShard::MODEL_WEIGHTS + DELTA_BLOCK_WEIGHTS - 1) /
+                                  DELTA_BLOCK_WEIGHTS;
+
+static_assert(DELTA_BLOCKS <= 16, "DeltaInfo.blocks holds a bit per block");
+
+static_assert(GOSSIP_OVERHEAD + sizeof(DeltaInfo) + DELTA_BITMAP_BYTES +
+              DELTA_BLOCK_WEIGHTS <= MESH_MSG_MAX_SIZE, "Dense delta block must fit the MTU");
+
+// Sender-side record of weights changed since the last broadcast
+struct DeltaTracker {
+    static constexpr size_t BITMAP_BYTES = (WeightShard::MODEL_WEIGHTS + 7) / 8;
+
+    uint8_t changed[BITMAP_BYTES];  // One bit per model weight
+    uint8_t base_version;           // Shard version at the last broadcast
+    bool    needs_full;             // No usable base: send the full shard
+
+    void reset(uint8_t version) {
+        memset(changed, 0, sizeof(changed));
+        base_version = version;
+        needs_full = false;
+    }
+
+    // Weights changed wholesale (FedAvg, reload): deltas no longer apply
+    void invalidate() {
+        needs_full = true;
+    }
+};
+
+enum class DeltaResult : uint8_t {
+    SENT,       // Delta queued; the queue moves the tracker's base
+    UNCHANGED,  // Nothing moved since the base; nothing sent
+    NEED_FULL,  // No base or a full shard is cheaper; send that instead
+    BUSY        // Queue full; retry later
+};
+
+struct ShardVersion {
+    uint8_t shard_id;        // NO_SHARD_ID pads unused entries
+    uint8_t version;
+} __attribute__((packed));
+
+constexpr uint8_t NO_SHARD_ID = 0xFF;
+
+// Resident shards a heartbeat lists; fixed so every SKU shares the format
+constexpr uint8_t HEARTBEAT_RESIDENT_SLOTS = 6;
+
+// Shards a node can serve: a bit per shard in RAM or flash, and the
+// versions of (up to HEARTBEAT_RESIDENT_SLOTS of) the resident ones
+struct HeldShards {
+    uint8_t      bitmap[TOTAL_MODEL_SHARDS / 8];
+    ShardVersion resident[HEARTBEAT_RESIDENT_SLOTS];
+
+    bool has(uint8_t shard_id) const {
+        return shard_id < TOTAL_MODEL_SHARDS && (bitmap[shard_id >> 3] & (1u << (shard_id & 7)));
+    }
+
+    bool hasResident(uint8_t shard_id) const {
+        for (uint8_t i = 0; i < HEARTBEAT_RESIDENT_SLOTS; i++) {
+            if (resident[i].shard_id == shard_id) return true;
+        }
+        return false;
+    }
 } __attribute__((packed));
 
 // Heartbeat payload
 struct HeartbeatPayload {
-    uint8_t  load_percent;   // Current CPU/thermal load
+    uint8_t  load_percent;   // Thermal governor throttle, 100 while AI is killed
     uint8_t  shards_held;    // How many shards in RAM
     uint16_t epoch;          // Training epoch
     uint8_t  neighbors;      // Known neighbor count
-    uint8_t  reserved[3];
+    uint8_t  tx_backlog;     // Shard fragments still queued for transmit
+    uint8_t  ble_guard_x32;  // Adaptive BLE guard band, 32us units
+    uint8_t  ble_overruns;   // BLE events touched since the last heartbeat
+    uint16_t cluster_head;   // Head we aggregate through (own address if head),
+                             // MESH_ADDR_ALL while flooding
+    HeldShards held;
+    uint8_t  temp_c;         // Filtered die temperature
+    uint8_t  temp_ahead_c;   // Predicted THERMAL_LOOKAHEAD samples ahead
+    uint8_t  offer_shard;    // Resident shard up for lease, NO_SHARD_ID if none
 } __attribute__((packed));
 
+static_assert(GOSSIP_OVERHEAD + sizeof(HeartbeatPayload) <= MESH_MSG_MAX_SIZE,
+              "Heartbeat must fit the MTU");
+
+// A received message: what the stack and the GossipHeader said about it
+struct RxMessage {
+    uint16_t src_addr;       // Originating node (network source, kept by relays)
+    uint8_t  opcode;
+    uint8_t  seq_num;
+    uint8_t  flags;
+};
+
+// Views of received bodies, read at the offsets of the structs above
+struct FragmentView : wire::View {
+    using View::View;
+    uint8_t shardId() const        { return u8(offsetof(FragmentInfo, shard_id)); }
+    uint8_t fragmentIdx() const    { return u8(offsetof(FragmentInfo, fragment_idx)); }
+    uint8_t totalFragments() const { return u8(offsetof(FragmentInfo, total_fragments)); }
+    uint8_t contentTag() const     { return u8(offsetof(FragmentInfo, content_tag)); }
+};
+
+struct NackView : wire::View {
+    using View::View;
+    uint16_t targetAddr() const { return u16(offsetof(NackInfo, target_addr)); }
+    uint8_t  shardId() const    { return u8(offsetof(NackInfo, shard_id)); }
+    uint8_t  contentTag() const { return u8(offsetof(NackInfo, content_tag)); }
+    uint16_t missing() const    { return u16(offsetof(NackInfo, missing)); }
+};
+
+struct RequestView : wire::View {
+    using View::View;
+    uint16_t targetAddr() const { return u16(offsetof(ShardRequest, target_addr)); }
+    uint8_t  shardId() const    { return u8(offsetof(ShardRequest, shard_id)); }
+};
+
+struct StatsRequestView : wire::View {
+    using View::View;
+    uint16_t targetAddr() const { return u16(offsetof(StatsRequest, target_addr)); }
+    uint8_t  flags() const      { return u8(offsetof(StatsRequest, flags)); }
+};
+
+struct LeaseView : wire::View {
+    using View::View;
+    uint16_t targetAddr() const { return u16(offsetof(LeaseInfo, target_addr)); }
+    uint8_t  shardId() const    { return u8(offsetof(LeaseInfo, shard_id)); }
+    uint8_t  op() const         { return u8(offsetof(LeaseInfo, op)); }
+};
+
+struct DeltaView : wire::View {
+    using View::View;
+    DeltaInfo info() const {
+        DeltaInfo d;
+        d.shard_id = u8(offsetof(DeltaInfo, shard_id));
+        d.base_version = u8(offsetof(DeltaInfo, base_version));
+        d.version = u8(offsetof(DeltaInfo, version));
+        d.block_idx = u8(offsetof(DeltaInfo, block_idx));
+        d.contributors = u16(offsetof(DeltaInfo, contributors));
+        d.blocks = u16(offsetof(DeltaInfo, blocks));
+        d.crc = u16(offsetof(DeltaInfo, crc));
+        return d;
+    }
+    const uint8_t* bitmap() const { return at(sizeof(DeltaInfo)); }
+};
+
+struct HeartbeatView : wire::View {
+    using View::View;
+    uint8_t  load() const        { return u8(offsetof(HeartbeatPayload, load_percent)); }
+    uint16_t clusterHead() const { return u16(offsetof(HeartbeatPayload, cluster_head)); }
+    uint8_t  offerShard() const  { return u8(offsetof(HeartbeatPayload, offer_shard)); }
+    void held(HeldShards& out) const {
+        memcpy(&out, at(offsetof(HeartbeatPayload, held)), sizeof(out));  // Bytes only
+    }
+};
+
+// Receive rules per opcode, indexed from GOSSIP_OPCODE_FIRST
+struct OpcodeSpec {
+    uint16_t min_body;       // Shorter bodies are dropped
+    bool     shard_data;     // Only taken from senders acceptsShardData() allows
+};
+
+constexpr OpcodeSpec OPCODE_SPECS[GOSSIP_OPCODE_COUNT] = {
+    {0, false},                                         // WEIGHT_UPDATE (reserved)
+    {sizeof(ShardRequest), false},                      // WEIGHT_REQUEST
+    {sizeof(HeartbeatPayload), false},                  // HEARTBEAT
+    {0, false},                                         // BACKPRESSURE
+    {sizeof(FragmentInfo), true},                       // SHARD_FRAGMENT
+    {0, false},                                         // ACK
+    {sizeof(DeltaInfo) + DELTA_BITMAP_BYTES, true},     // WEIGHT_DELTA
+    {sizeof(NackInfo), false},                          // NACK
+    {0, false},                                         // STATS: request or reply
+    {sizeof(LeaseInfo), false},                         // LEASE
+};
+
+inline const OpcodeSpec* opcodeSpec(uint8_t opcode) {
+    uint8_t i = static_cast<uint8_t>(opcode - GOSSIP_OPCODE_FIRST);
+    return i < GOSSIP_OPCODE_COUNT ? &OPCODE_SPECS[i] : nullptr;
+}
+
 // Neighbor tracking
 struct NeighborInfo {
     uint16_t addr;
     uint8_t  rssi;           // Signal strength
     uint8_t  load;           // Their reported load
     uint32_t last_seen_tick;
-    uint8_t  held_shards[8]; // Bitmap of shards they have
+    HeldShards held;         // From their heartbeat
+    uint16_t cluster_head;   // From their heartbeat
+    uint8_t  offer;          // Shard they offer for lease (NO_SHARD_ID: none)
+};
+
+// Replay protection for one source: the newest sequence number seen and
+// a bitmap of the REPLAY_WINDOW numbers up to it (bit k = last_seq - k)
+struct ReplayEntry {
+    uint16_t addr;
+    uint8_t  last_seq;
+    uint32_t window;
+    uint32_t last_tick;
+};
+
+constexpr uint8_t REPLAY_WINDOW = 32;  // Two full shard transfers of one source
+
+// Open-addressed table keyed on mesh address (0, the unassigned address,
+// marks an empty slot). Linear probing with backward-shift deletion, so
+// there are no tombstones and a miss stops at the first empty slot.
+// Inserts are refused past MAX_FILL entries to keep probe chains short.
+template <typename Entry, uint8_t SLOTS, uint8_t MAX_FILL>
+class AddrTable {
+public:
+    static_assert((SLOTS & (SLOTS - 1)) == 0 && SLOTS <= 128, "Slot count must be a power of two");
+    static_assert(MAX_FILL < SLOTS, "At least one slot must stay empty");
+
+    void clear() {
+        memset(slots_, 0, sizeof(slots_));
+        count_ = 0;
+    }
+
+    Entry* find(uint16_t addr) {
+        for (uint8_t i = home(addr);; i = next(i)) {
+            if (slots_[i].addr == addr) return &slots_[i];
+            if (slots_[i].addr == 0) return nullptr;
+        }
+    }
+
+    const Entry* find(uint16_t addr) const {
+        return const_cast<AddrTable*>(this)->find(addr);
+    }
+
+    // Entry for addr, zero-filled if new (created set); nullptr when full
+    Entry* insert(uint16_t addr, bool& created) {
+        created = false;
+        uint8_t i = home(addr);
+        for (; slots_[i].addr != 0; i = next(i)) {
+            if (slots_[i].addr == addr) return &slots_[i];
+        }
+        if (count_ >= MAX_FILL) return nullptr;
+        memset(&slots_[i], 0, sizeof(Entry));
+        slots_[i].addr = addr;
+        count_++;
+        created = true;
+        return &slots_[i];
+    }
+
+    // Pull later members of the probe chain back into the hole, so every
+    // remaining entry stays reachable from its home slot
+    void erase(Entry* e) {
+        uint8_t hole = static_cast<uint8_t>(e - slots_);
+        for (uint8_t i = next(hole); slots_[i].addr != 0; i = next(i)) {
+            uint8_t h = home(slots_[i].addr);
+            if (((i - h) & MASK) >= ((i - hole) & MASK)) {
+                slots_[hole] = slots_[i];
+                hole = i;
+            }
+        }
+        memset(&slots_[hole], 0, sizeof(Entry));
+        count_--;
+    }
+
+    uint8_t size() const { return count_; }
+
+    // Raw slot access for scans; skip entries with addr == 0
+    Entry&       slot(uint8_t i) { return slots_[i]; }
+    const Entry& slot(uint8_t i) const { return slots_[i]; }
+
+    static constexpr uint8_t CAPACITY = SLOTS;
+
+private:
+    static constexpr uint8_t MASK = SLOTS - 1;
+
+    // Fibonacci hash: provisioners hand out sequential addresses
+    static uint8_t home(uint16_t addr) {
+        return static_cast<uint8_t>(static_cast<uint16_t>(addr * 40503u) >> 8) & MASK;
+    }
+    static uint8_t next(uint8_t i) { return (i + 1) & MASK; }
+
+    Entry   slots_[SLOTS];
+    uint8_t count_ = 0;
+};
+
+// Aggregation topology, chosen before every heartbeat
+enum class ClusterRole : uint8_t {
+    FLOOD,   // Broadcast shards, merge everything heard
+    HEAD,    // Merge members and other heads, broadcast the aggregate
+    MEMBER   // Unicast shards to the head, merge only the head's
+};
+
+// Queued shard transmit. Fragments are built from the live shard when
+// sent; if its checksum moves mid-transfer the job starts over so
+// receivers never reassemble a torn shard. A delta job sends a
+// WEIGHT_DELTA per dirty block instead, bitmap and values read from the
+// tracker and the shard when each block goes out; weights that move
+// after their block left stay marked for the next delta. A block repair
+// resends NACKed blocks of a delta dense, from the live weights.
+struct TxJob {
+    const WeightShard* shard;  // Resident shard or a view of its flash record
+    DeltaTracker* tracker;     // Delta job: the shard's change tracker, else nullptr
+    uint32_t deadline_tick;    // Earliest tick for the next fragment
+    uint16_t checksum;         // Shard checksum when the transfer (re)started
+    uint16_t remaining;        // Bit per fragment (or delta block) still to send, lowest first
+    uint16_t blocks;           // Delta job or block repair: every block listed, else 0
+    uint16_t dst;              // MESH_ADDR_ALL, our cluster head or a requester
+    uint8_t  shard_id;         // Slot still holds this shard?
+    uint8_t  version;          // Delta job or block repair: version every block announces
+    bool     retransmit;       // NACK repair only
+    bool     reply;            // Answers a request or NACK (GOSSIP_FLAG_REPLY)
+};
+
+// One in-flight shard reassembly, keyed by (sender, shard)
+struct ReassemblySlot {
+    ShardHeader  header;       // From fragment 0
+    WeightShard* target;       // Resident shard blended in place, else staged
+    uint8_t*     changed;      // target's change bitmap (ChangeLookup), bit per weight
+    uint32_t     last_tick;    // Last fragment or NACK
+    uint16_t     src_addr;
+    uint16_t     received;     // Bit per fragment index
+    uint16_t     crc_acc;      // Order-independent CRC of the incoming weights
+    uint16_t     alpha_q8;     // Blend factor (resident target)
+    uint16_t     merge_total;  // Contributors after the merge
+    uint16_t     disagreed;    // Resident weights that differed from the sender's
+    uint8_t      shard_id;     // 0xFF = free
+    uint8_t      content_tag;
+    uint8_t      total_fragments;
+    uint8_t      nacks_sent;
+    bool         has_header;
+    bool         reply;        // Answers our request (GOSSIP_FLAG_REPLY)
+};
+
+// Last shard version merged from a peer (delta base check)
+struct PeerShardVersion {
+    uint16_t addr;
+    uint8_t  shard_id;
+    uint8_t  version;          // Last complete merge
+    uint16_t pending;          // Blocks of the delta to delta_version not merged yet
+    uint8_t  delta_version;
+    bool     nack_owed;        // Its last block is in: NACK the rest once we can merge it
+    uint8_t  nacks;            // Sent for its gaps (carried ones included)
 };
 
 class MeshGossip {
 public:
-    static constexpr uint8_t MAX_NEIGHBORS = 16;
+    static constexpr uint8_t MAX_NEIGHBORS = NeuronProfile::NEIGHBORS;
+    static constexpr uint8_t NEIGHBOR_SLOTS = 2 * MAX_NEIGHBORS;  // Hash slots, at most half full
+    static constexpr uint8_t REPLAY_SLOTS = 64;        // Sources tracked (up to 48)
+    static constexpr uint8_t EXPIRY_SWEEP_SLOTS = 4;   // Checked per pumpTx()
     static constexpr uint8_t MAX_PENDING_FRAGMENTS = 4;
     static constexpr size_t  FRAGMENT_SIZE = 256;  // Fits in mesh MTU
+    static constexpr uint8_t TOTAL_FRAGMENTS =
+        (WeightShard::WIRE_SIZE + FRAGMENT_SIZE - 1) / FRAGMENT_SIZE;
+    static constexpr uint16_t ALL_FRAGMENTS = (1u << TOTAL_FRAGMENTS) - 1;
+
+    static_assert(TOTAL_FRAGMENTS <= 16, "Fragment bitmaps are 16 bits");
+    static_assert(MAX_PENDING_FRAGMENTS <= 8, "Staging dirty mask is 8 bits");
 
-    MeshGossip() : neighbor_count_(0), my_addr_(0), seq_num_(0) {
-        memset(neighbors_, 0, sizeof(neighbors_));
-        memset(fragment_buffer_, 0, sizeof(fragment_buffer_));
+    MeshGossip() : my_addr_(0), seq_num_(0),
+                   role_(ClusterRole::FLOOD), cluster_head_(MESH_ADDR_ALL) {
+        neighbors_.clear();
+        replay_.clear();
+        for (uint8_t i = 0; i < MAX_PENDING_FRAGMENTS; i++) {
+            freeSlot(reassembly_[i]);
+        }
     }
 
     void init(uint16_t my_mesh_addr) {
         my_addr_ = my_mesh_addr;
     }
 
-    // Called when mesh message received
-    void onReceive(const uint8_t* data, size_t len, uint16_t src, int8_t rssi) {
+    // Called when mesh message received: the parameters of a vendor
+    // message (the stack has stripped the opcode) and its network source
+    void onReceive(uint8_t opcode, const uint8_t* params, size_t len, uint16_t src, int8_t rssi) {
         if (len < sizeof(GossipHeader)) return;
 
-        const GossipHeader* hdr = reinterpret_cast<const GossipHeader*>(data);
+        RxMessage msg;
+        msg.src_addr = src;
+        msg.opcode = opcode;
+        msg.seq_num = params[offsetof(GossipHeader, seq_num)];
+        msg.flags = params[offsetof(GossipHeader, flags)];
+        const uint8_t* body = params + sizeof(GossipHeader);
+        size_t body_len = len - sizeof(GossipHeader);
 
-        // Dedup check
-        if (isDuplicate(hdr->src_addr, hdr->seq_num)) return;
+        // Replay window of the originating node (relays keep the source)
+        if (isDuplicate(msg.src_addr, msg.seq_num)) return;
 
         // Update neighbor info
-        updateNeighbor(src, rssi, data, len);
+        updateNeighbor(src, rssi);
 
-        switch (static_cast<GossipOpcode>(hdr->opcode)) {
-            case GossipOpcode::WEIGHT_UPDATE:
-                handleWeightUpdate(data + sizeof(GossipHeader), len - sizeof(GossipHeader), hdr);
-                break;
+        const OpcodeSpec* spec = opcodeSpec(opcode);
+        if (!spec || body_len < spec->min_body) return;
+        if (spec->shard_data && !acceptsShardData(msg)) return;
+
+        switch (static_cast<GossipOpcode>(opcode)) {
             case GossipOpcode::WEIGHT_REQUEST:
-                handleWeightRequest(data + sizeof(GossipHeader), len - sizeof(GossipHeader), src);
+                handleWeightRequest(RequestView(body), msg);
                 break;
             case GossipOpcode::HEARTBEAT:
-                handleHeartbeat(data + sizeof(GossipHeader), len - sizeof(GossipHeader), src);
+                handleHeartbeat(HeartbeatView(body), src);
                 break;
             case GossipOpcode::SHARD_FRAGMENT:
-                handleFragment(data + sizeof(GossipHeader), len - sizeof(GossipHeader), hdr);
+                handleFragment(body, body_len, msg);
                 break;
             case GossipOpcode::BACKPRESSURE:
                 handleBackpressure(src);
                 break;
+            case GossipOpcode::WEIGHT_DELTA:
+                handleDelta(body, body_len, msg);
+                break;
+            case GossipOpcode::NACK:
+                handleNack(NackView(body), msg);
+                break;
+            case GossipOpcode::STATS:
+                handleStats(body, body_len);
+                break;
+            case GossipOpcode::LEASE:
+                handleLease(LeaseView(body), msg);
+                break;
             default:
                 break;
         }
     }
 
-    // Send a weight shard to the mesh (fragmented)
+    // Queue a weight shard for fragmented transmit (to the cluster head
+    // when we are a member). Only the header and the model's weights go on
+    // air; receivers zero-fill the unused tail.
+    // The shard must stay resident until the job drains (or its slot is
+    // reloaded, which cancels it). Returns false when the queue is full.
     bool broadcastShard(const WeightShard& shard) {
-        uint8_t total_frags = (sizeof(WeightShard) + FRAGMENT_SIZE - 1) / FRAGMENT_SIZE;
-        const uint8_t* shard_bytes = reinterpret_cast<const uint8_t*>(&shard);
+        return queueFragments(shard, ALL_FRAGMENTS, false, shardDst(), false);
+    }
+
+    // Drain queued fragments within budget_us. At most TX_FRAGS_PER_EVENT
+    // go out per BLE connection/advertising interval (so the stack's TX
+    // FIFO never backs up), spaced TX_FRAGMENT_GAP_MS apart and further
+    // when neighbours report load. Stalled reassemblies are NACKed from
+    // here too. Returns true while fragments remain.
+    bool pumpTx(uint32_t budget_us) {
+        uint32_t start = clock_time();
+        serviceReassembly(start);
+        serviceDeltaNacks();
+        expireStale(start);
+
+        // A new upcoming BLE event means the previous interval's packets left
+        uint32_t next_event = blt_get_next_event_tick();
+        if (next_event != tx_event_tick_) {
+            tx_event_tick_ = next_event;
+            tx_event_sent_ = 0;
+        }
+
+        while (tx_count_ > 0 && tx_event_sent_ < TX_FRAGS_PER_EVENT) {
+            TxJob& job = tx_queue_[tx_head_];
+
+            // Slot reloaded with another shard, or the delta's receivers
+            // changed (new cluster head): nothing left to send
+            if (job.shard->header.shard_id != job.shard_id ||
+                (job.tracker && job.tracker->needs_full)) {
+                popTxJob();
+                continue;
+            }
+            // Weights moved under us: restart so the receiver's CRC holds
+            if (!job.blocks && job.shard->header.checksum != job.checksum) {
+                job.checksum = job.shard->header.checksum;
+                job.remaining = ALL_FRAGMENTS;
+                job.retransmit = false;
+            }
+
+            uint32_t now = clock_time();
+            if (static_cast<int32_t>(now - job.deadline_tick) < 0) break;
+            uint32_t elapsed_us = (now - start) / HWScheduler::TICK_PER_US;
+            if (elapsed_us + TX_FRAGMENT_COST_US > budget_us) break;
 
-        for (uint8_t i = 0; i < total_frags; i++) {
-            uint8_t msg[MESH_MSG_MAX_SIZE];
-            size_t offset = 0;
-
-            // Header
-            GossipHeader* hdr = reinterpret_cast<GossipHeader*>(msg);
-            hdr->opcode = static_cast<uint8_t>(GossipOpcode::SHARD_FRAGMENT);
-            hdr->ttl = 3;  // 3 hops max
-            hdr->src_addr = my_addr_;
-            hdr->seq_num = seq_num_++;
-            hdr->flags = 0;
-            offset += sizeof(GossipHeader);
-
-            // Fragment info
-            FragmentInfo* frag = reinterpret_cast<FragmentInfo*>(msg + offset);
-            frag->shard_id = shard.header.shard_id;
-            frag->fragment_idx = i;
-            frag->total_fragments = total_frags;
-            frag->reserved = 0;
-            offset += sizeof(FragmentInfo);
-
-            // Payload
-            size_t payload_start = i * FRAGMENT_SIZE;
-            size_t payload_len = FRAGMENT_SIZE;
-            if (payload_start + payload_len > sizeof(WeightShard)) {
-                payload_len = sizeof(WeightShard) - payload_start;
+            uint8_t idx = static_cast<uint8_t>(__builtin_ctz(job.remaining));
+            if (job.blocks) {
+                sendDeltaBlock(job, idx);
+            } else {
+                sendFragment(job, idx);
             }
-            memcpy(msg + offset, shard_bytes + payload_start, payload_len);
-            offset += payload_len;
+            tx_event_sent_++;
+            job.deadline_tick = now + txGapTicks();
+            job.remaining &= job.remaining - 1;
+            if (job.remaining == 0) {
+                // Every block out: the announced version is the new base
+                if (job.tracker) job.tracker->base_version = job.version;
+                // A requester NACKs what it missed; keep the content it saw
+                if (job.reply && !job.blocks) {
+                    repair_shard_ = job.shard;
+                    repair_until_tick_ = now + 2 * FRAGMENT_NACK_MS * 1000 * HWScheduler::TICK_PER_US;
+                }
+                popTxJob();
+            }
+        }
+        return tx_count_ > 0;
+    }
 
-            // Send via mesh
-            meshSend(msg, offset);
+    // Keep one free slot's staging sector erased for the next non-resident
+    // transfer: erase a used one if none is clean and the window fits an
+    // erase. A scheduler task beside the store's GC, never the sync task:
+    // an erase outlasts its burst. Returns true while the erase is owed.
+    // Sectors still held by the ShardCallback are left alone.
+    bool stagingMaintenanceStep(uint32_t budget_us) {
+        int dirty = -1;
+        for (uint8_t i = 0; i < MAX_PENDING_FRAGMENTS; i++) {
+            if (reassembly_[i].shard_id != 0xFF) continue;
+            if (!(staging_dirty_ & (1u << i))) return false;
+            if (dirty < 0 && !(staging_held_ & (1u << i))) dirty = i;
         }
-        return true;
+        if (dirty < 0) return false;
+        if (budget_us < FLASH_ERASE_US) return true;
+
+        stagingErase(static_cast<uint8_t>(dirty));
+        staging_dirty_ &= ~(1u << dirty);
+        return false;
     }
 
-    // Send heartbeat
-    void sendHeartbeat(uint8_t load, uint8_t shards_held, uint16_t epoch) {
-        uint8_t msg[sizeof(GossipHeader) + sizeof(HeartbeatPayload)];
+    static bool stagingMaintenanceStatic(uint32_t budget_us, void* ctx) {
+        return static_cast<MeshGossip*>(ctx)->stagingMaintenanceStep(budget_us);
+    }
 
-        GossipHeader* hdr = reinterpret_cast<GossipHeader*>(msg);
-        hdr->opcode = static_cast<uint8_t>(GossipOpcode::HEARTBEAT);
-        hdr->ttl = 1;  // Single hop
-        hdr->src_addr = my_addr_;
-        hdr->seq_num = seq_num_++;
-        hdr->flags = 0;
+    // A view the ShardCallback kept, nullptr if none
+    const WeightShard* heldStaged() const {
+        for (uint8_t i = 0; i < MAX_PENDING_FRAGMENTS; i++) {
+            if (staging_held_ & (1u << i)) return stagingShard(i);
+        }
+        return nullptr;
+    }
 
-        HeartbeatPayload* payload = reinterpret_cast<HeartbeatPayload*>(msg + sizeof(GossipHeader));
-        payload->load_percent = load;
-        payload->shards_held = shards_held;
-        payload->epoch = epoch;
-        payload->neighbors = neighbor_count_;
+    // The ShardCallback is done with a view it kept
+    void releaseStaged(const WeightShard& staged) {
+        for (uint8_t i = 0; i < MAX_PENDING_FRAGMENTS; i++) {
+            if (stagingShard(i) == &staged) staging_held_ &= ~(1u << i);
+        }
+    }
 
-        meshSend(msg, sizeof(msg));
+    // True while a queued transfer still references this shard, or a reply
+    // of it may still be repaired
+    bool isTransmitting(const WeightShard& shard) const {
+        for (uint8_t i = 0; i < tx_count_; i++) {
+            if (tx_queue_[(tx_head_ + i) % TX_QUEUE_DEPTH].shard == &shard) return true;
+        }
+        return isRepairable(shard);
     }
 
-    // Request a specific shard from neighbors
-    void requestShard(uint8_t shard_id) {
-        uint8_t msg[sizeof(GossipHeader) + 1];
+    // True while the shard's weights must not change: its fragments are on
+    // air (an edit restarts the transfer) or a reply may still be repaired.
+    // A delta on air does not pin them; an edit rides with the next delta.
+    bool isReadOnly(const WeightShard& shard) const {
+        for (uint8_t i = 0; i < tx_count_; i++) {
+            const TxJob& job = tx_queue_[(tx_head_ + i) % TX_QUEUE_DEPTH];
+            if (job.shard == &shard && !job.blocks) return true;
+        }
+        return isRepairable(shard);
+    }
+
+    // True while an incoming transfer is blending into this shard
+    bool isMerging(const WeightShard& shard) const {
+        for (uint8_t i = 0; i < MAX_PENDING_FRAGMENTS; i++) {
+            if (reassembly_[i].target == &shard) return true;
+        }
+        return false;
+    }
 
-        GossipHeader* hdr = reinterpret_cast<GossipHeader*>(msg);
-        hdr->opcode = static_cast<uint8_t>(GossipOpcode::WEIGHT_REQUEST);
-        hdr->ttl = 2;
-        hdr->src_addr = my_addr_;
-        hdr->seq_num = seq_num_++;
-        hdr->flags = 0;
+    // Fragments still waiting to go out, saturated for the heartbeat
+    uint8_t txBacklog() const {
+        uint16_t total = 0;
+        for (uint8_t i = 0; i < tx_count_; i++) {
+            total += __builtin_popcount(tx_queue_[(tx_head_ + i) % TX_QUEUE_DEPTH].remaining);
+        }
+        return (total > 0xFF) ? 0xFF : static_cast<uint8_t>(total);
+    }
+
+    // Send only the weights changed since the tracker's base version, one
+    // WEIGHT_DELTA per dirty block, paced through the queue like fragments.
+    // Falls back (NEED_FULL) when there is no base or the deltas would
+    // cost more airtime than the full shard. Each block's marks are
+    // cleared as it goes out and the base moves once the last one has, so
+    // the tracker must stay with the shard until isTransmitting() is false.
+    DeltaResult broadcastDelta(const WeightShard& shard, DeltaTracker& t) {
+        if (t.needs_full) return DeltaResult::NEED_FULL;
+
+        uint16_t dirty_mask = 0;
+        size_t changed = 0;
+        for (uint8_t b = 0; b < DELTA_BLOCKS; b++) {
+            size_t block_changed = kernels::count_bits(&t.changed[b * DELTA_BITMAP_BYTES],
+                                                       blockBitmapBytes(b));
+            if (block_changed) dirty_mask |= 1u << b;
+            changed += block_changed;
+        }
+        if (changed == 0) return DeltaResult::UNCHANGED;
 
-        msg[sizeof(GossipHeader)] = shard_id;
+        size_t dirty_blocks = __builtin_popcount(dirty_mask);
+        size_t delta_bytes = dirty_blocks * (GOSSIP_OVERHEAD + sizeof(DeltaInfo) +
+                                             DELTA_BITMAP_BYTES) + changed;
+        size_t full_bytes = TOTAL_FRAGMENTS * (GOSSIP_OVERHEAD + sizeof(FragmentInfo)) +
+                            WeightShard::WIRE_SIZE;
+        if (delta_bytes >= full_bytes) return DeltaResult::NEED_FULL;
 
-        meshSend(msg, sizeof(msg));
+        // One delta on air per tracker: the next one's base is where it ends
+        if (tx_count_ >= TX_QUEUE_DEPTH || isSendingDelta(t)) return DeltaResult::BUSY;
+        TxJob& job = tx_queue_[(tx_head_ + tx_count_) % TX_QUEUE_DEPTH];
+        job.shard = &shard;
+        job.tracker = &t;
+        job.deadline_tick = clock_time();
+        job.checksum = shard.header.checksum;
+        job.remaining = dirty_mask;
+        job.blocks = dirty_mask;
+        job.dst = shardDst();
+        job.shard_id = shard.header.shard_id;
+        job.version = shard.header.version;
+        job.retransmit = false;
+        job.reply = false;
+        tx_count_++;
+        return DeltaResult::SENT;
+    }
+
+    // Send heartbeat; re-elects the cluster role first so the heartbeat
+    // advertises the head we now aggregate through
+    void sendHeartbeat(uint8_t load, uint8_t shards_held, uint16_t epoch,
+                       uint16_t ble_guard_us, uint8_t ble_overruns, const HeldShards& held,
+                       uint8_t temp_c, uint8_t temp_ahead_c) {
+        updateCluster(load);
+
+        // Fields before and after `held`, which is sent from the caller's copy
+        uint8_t head[sizeof(GossipHeader) + offsetof(HeartbeatPayload, held)];
+        wire::Writer w(head, sizeof(head));
+        writeHeader(w, 0);
+        w.u8(load);
+        w.u8(shards_held);
+        w.u16(epoch);
+        w.u8(neighbors_.size());
+        w.u8(txBacklog());
+        w.u8(static_cast<uint8_t>(ble_guard_us >= 255 * 32 ? 255 : ble_guard_us / 32));
+        w.u8(ble_overruns);
+        w.u16(cluster_head_);
+
+        uint8_t tail[sizeof(HeartbeatPayload) - offsetof(HeartbeatPayload, temp_c)];
+        wire::Writer wt(tail, sizeof(tail));
+        wt.u8(temp_c);
+        wt.u8(temp_ahead_c);
+        wt.u8(offer_shard_);
+
+        const TxSegment segs[] = {w.segment(),
+                                  {reinterpret_cast<const uint8_t*>(&held), sizeof(held)},
+                                  wt.segment()};
+        meshSend(GossipOpcode::HEARTBEAT, 1, segs, 3);  // Single hop
+    }
+
+    // Pull a shard from the best neighbour advertising it. Returns false
+    // when no neighbour holds it (nothing is sent: no blind flooding).
+    bool requestShard(uint8_t shard_id) {
+        uint16_t holder = bestHolder(shard_id);
+        if (holder == MESH_ADDR_ALL) return false;
+        requestShardFrom(holder, shard_id);
+        return true;
+    }
+
+    // Unicast WEIGHT_REQUEST to a node known to hold the shard
+    void requestShardFrom(uint16_t holder, uint8_t shard_id) {
+        uint8_t msg[sizeof(GossipHeader) + sizeof(ShardRequest)];
+        wire::Writer w(msg, sizeof(msg));
+        writeHeader(w, 0);
+        w.u16(holder);
+        w.u8(shard_id);
+
+        TxSegment seg = w.segment();
+        meshSend(GossipOpcode::WEIGHT_REQUEST, ttlTo(holder), &seg, 1, holder);
+    }
+
+    // Neighbour to ask for a shard: one holding it in RAM (no flash read),
+    // then the least loaded, then the best RSSI. MESH_ADDR_ALL if none.
+    uint16_t bestHolder(uint8_t shard_id) const {
+        const NeighborInfo* best = nullptr;
+        uint32_t best_key = 0;
+        for (uint8_t i = 0; i < NEIGHBOR_SLOTS; i++) {
+            const NeighborInfo& n = neighbors_.slot(i);
+            if (!n.addr || !n.held.has(shard_id)) continue;
+            uint32_t key = (n.held.hasResident(shard_id) ? 0u : 1u << 16) |
+                           (static_cast<uint32_t>(n.load) << 8) | (255u - n.rssi);
+            if (!best || key < best_key) {
+                best = &n;
+                best_key = key;
+            }
+        }
+        return best ? best->addr : MESH_ADDR_ALL;
+    }
+
+    // Shard advertised for lease in our heartbeats (NO_SHARD_ID: none)
+    void setLeaseOffer(uint8_t shard_id) { offer_shard_ = shard_id; }
+    uint8_t getLeaseOffer() const { return offer_shard_; }
+
+    // The most loaded neighbour offering a shard for lease; false if none
+    bool findLeaseOffer(uint16_t& owner, uint8_t& shard_id) const {
+        const NeighborInfo* best = nullptr;
+        for (uint8_t i = 0; i < NEIGHBOR_SLOTS; i++) {
+            const NeighborInfo& n = neighbors_.slot(i);
+            if (!n.addr || n.offer == NO_SHARD_ID) continue;
+            if (!best || n.load > best->load) best = &n;
+        }
+        if (!best) return false;
+        owner = best->addr;
+        shard_id = best->offer;
+        return true;
+    }
+
+    void sendLease(uint16_t dst, uint8_t shard_id, LeaseOp op) {
+        uint8_t msg[sizeof(GossipHeader) + sizeof(LeaseInfo)];
+        wire::Writer w(msg, sizeof(msg));
+        writeHeader(w, 0);
+        w.u16(dst);
+        w.u8(shard_id);
+        w.u8(static_cast<uint8_t>(op));
+
+        TxSegment seg = w.segment();
+        meshSend(GossipOpcode::LEASE, ttlTo(dst), &seg, 1, dst);
+    }
+
+    // End of a lease we held: RETURN, then the trained shard to its owner
+    // through the paced queue (as a reply, so a cluster member takes it).
+    // False if the queue is full; the holder retries.
+    bool returnShard(uint16_t owner, const WeightShard& shard) {
+        if (!queueFragments(shard, ALL_FRAGMENTS, false, owner, true)) return false;
+        sendLease(owner, shard.header.shard_id, LeaseOp::RETURN);
+        return true;
     }
 
     // Check if we should throttle due to neighbor backpressure
     bool shouldThrottle() const {
-        uint8_t overloaded = 0;
-        for (uint8_t i = 0; i < neighbor_count_; i++) {
-            if (neighbors_[i].load > 80) overloaded++;
+        return overloaded_count_ > neighbors_.size() / 2;
+    }
+
+    uint8_t  getNeighborCount() const { return neighbors_.size(); }
+    uint16_t getAddress() const { return my_addr_; }
+
+    ClusterRole getClusterRole() const { return role_; }
+    uint16_t    getClusterHead() const { return cluster_head_; }
+
+    // Neighbours whose heartbeat says they hold this shard
+    uint8_t holderCount(uint8_t shard_id) const {
+        uint8_t n = 0;
+        for (uint8_t i = 0; i < NEIGHBOR_SLOTS; i++) {
+            const NeighborInfo& nb = neighbors_.slot(i);
+            if (nb.addr && nb.held.has(shard_id)) n++;
         }
-        return overloaded > neighbor_count_ / 2;
+        return n;
     }
 
-    uint8_t getNeighborCount() const { return neighbor_count_; }
+    // Neighbours our shard broadcasts reach (shardDst(), acceptsShardData())
+    // that list the shard resident at a version before `version`. Merging
+    // a copy moves a shard past its version (WeightShard::mergedVersion()),
+    // so these have not merged the copy we sent at `version`.
+    uint8_t laggingNeighbors(uint8_t shard_id, uint8_t version) const {
+        uint8_t n = 0;
+        for (uint8_t i = 0; i < NEIGHBOR_SLOTS; i++) {
+            const NeighborInfo& nb = neighbors_.slot(i);
+            if (!nb.addr) continue;
+            bool reached = role_ == ClusterRole::MEMBER
+                           ? nb.addr == cluster_head_
+                           : nb.cluster_head == MESH_ADDR_ALL || nb.cluster_head == nb.addr ||
+                             nb.cluster_head == my_addr_;
+            if (!reached) continue;
+            for (uint8_t k = 0; k < HEARTBEAT_RESIDENT_SLOTS; k++) {
+                const ShardVersion& r = nb.held.resident[k];
+                if (r.shard_id == shard_id && WeightShard::versionBefore(r.version, version)) {
+                    n++;
+                    break;
+                }
+            }
+        }
+        return n;
+    }
 
     // Callback setters
-    using ShardCallback = void (*)(const WeightShard& shard, void* ctx);
+
+    // A non-resident shard arrived, as a view of its staging sector.
+    // Return true to keep reading the view after the call (a write-behind
+    // save); the sector is not erased until releaseStaged().
+    using ShardCallback = bool (*)(const WeightShard& shard, void* ctx);
     void setOnShardReceived(ShardCallback cb, void* ctx) {
         on_shard_cb_ = cb;
         on_shard_ctx_ = ctx;
     }
 
+    // Delta block for a shard; return true if it was applied locally.
+    // `complete`: every other block of the delta has been applied too.
+    using DeltaCallback = bool (*)(const DeltaInfo& info, const uint8_t* bitmap,
+                                   const int8_t* values, size_t value_count, bool complete,
+                                   void* ctx);
+    void setOnDeltaReceived(DeltaCallback cb, void* ctx) {
+        on_delta_cb_ = cb;
+        on_delta_ctx_ = ctx;
+    }
+
+    // Resident shard by ID (nullptr if not held): serves repairs and is
+    // the in-place merge target for incoming fragments
+    using ShardLookup = WeightShard* (*)(uint8_t shard_id, void* ctx);
+    void setShardLookup(ShardLookup cb, void* ctx) {
+        shard_lookup_cb_ = cb;
+        shard_lookup_ctx_ = ctx;
+    }
+
+    // Stored (non-resident) shard by ID for serving requests: a read-only
+    // view that stays readable while queued; a record superseded mid-send
+    // changes shard_id/checksum and the job stops or restarts
+    using StoredShardLookup = const WeightShard* (*)(uint8_t shard_id, void* ctx);
+    void setStoredShardLookup(StoredShardLookup cb, void* ctx) {
+        stored_lookup_cb_ = cb;
+        stored_lookup_ctx_ = ctx;
+    }
+
+    // LEASE addressed to us: CLAIM (we are the owner), GRANT or RETURN
+    using LeaseCallback = void (*)(uint16_t src, uint8_t shard_id, LeaseOp op, void* ctx);
+    void setOnLease(LeaseCallback cb, void* ctx) {
+        on_lease_cb_ = cb;
+        on_lease_ctx_ = ctx;
+    }
+
+    // A resident shard finished an in-place merge. Shards that were not
+    // resident arrive through ShardCallback instead, as a view of
+    // memory-mapped flash (don't pass that view to a flash write directly).
+    // `disagreed` counts the weights where the sender's copy differed.
+    using MergeCallback = void (*)(WeightShard& shard, uint16_t disagreed, void* ctx);
+    void setOnShardMerged(MergeCallback cb, void* ctx) {
+        on_merge_cb_ = cb;
+        on_merge_ctx_ = ctx;
+    }
+
+    // A resident shard's in-place merge failed its checksum. Its weights
+    // hold a partial blend of a bad copy: restore them (the version and
+    // contributors were left alone). A fresh copy has been requested.
+    using MergeFailedCallback = void (*)(WeightShard& shard, void* ctx);
+    void setOnMergeFailed(MergeFailedCallback cb, void* ctx) {
+        on_merge_failed_cb_ = cb;
+        on_merge_failed_ctx_ = ctx;
+    }
+
+    // Bitmap (a bit per weight) where an in-place merge into a resident
+    // shard marks the weights the sender's copy differed in, so they go
+    // out with our next delta. nullptr: not tracked.
+    using ChangeLookup = uint8_t* (*)(const WeightShard& shard, void* ctx);
+    void setChangeLookup(ChangeLookup cb, void* ctx) {
+        change_lookup_cb_ = cb;
+        change_lookup_ctx_ = ctx;
+    }
+
 private:
-    // Platform-specific mesh send (implemented in .cpp with Telink SDK)
-    void meshSend(const uint8_t* data, size_t len);
+    // Platform-specific mesh send (implemented in .cpp with Telink SDK).
+    // The parameters are the segments in order; TTL and the destination
+    // go to the network layer.
+    void meshSend(GossipOpcode opcode, uint8_t ttl, const TxSegment* segs, uint8_t count,
+                  uint16_t dst = MESH_ADDR_ALL);
+
+    // The GossipHeader every outgoing message starts with
+    void writeHeader(wire::Writer& w, uint8_t flags) {
+        w.u8(seq_num_++);
+        w.u8(flags);
+    }
+
+    // Platform-specific staging: one flash sector per reassembly slot
+    void stagingErase(uint8_t slot);
+    void stagingWrite(uint8_t slot, size_t offset, const uint8_t* data, size_t len);
+    const WeightShard* stagingShard(uint8_t slot) const;
+
+    // Add fragments of a shard to its queued job (or a new one). A job
+    // wanted by two destinations goes to everyone.
+    bool queueFragments(const WeightShard& shard, uint16_t mask, bool retransmit, uint16_t dst,
+                        bool reply) {
+        // Fragments are read from the live weights: not while a merge edits them
+        if (isMerging(shard)) return false;
+        for (uint8_t i = 0; i < tx_count_; i++) {
+            TxJob& job = tx_queue_[(tx_head_ + i) % TX_QUEUE_DEPTH];
+            if (job.shard == &shard && !job.blocks) {
+                job.remaining |= mask;
+                job.retransmit = job.retransmit && retransmit;
+                if (job.dst != dst) job.dst = MESH_ADDR_ALL;
+                job.reply = job.reply || reply;
+                return true;
+            }
+        }
+        if (tx_count_ >= TX_QUEUE_DEPTH) return false;
+
+        TxJob& job = tx_queue_[(tx_head_ + tx_count_) % TX_QUEUE_DEPTH];
+        job.shard = &shard;
+        job.tracker = nullptr;
+        job.deadline_tick = clock_time();
+        job.checksum = shard.header.checksum;
+        job.remaining = mask;
+        job.blocks = 0;
+        job.dst = dst;
+        job.shard_id = shard.header.shard_id;
+        job.retransmit = retransmit;
+        job.reply = reply;
+        tx_count_++;
+        return true;
+    }
+
+    // Queue a dense resend of delta blocks a receiver missed, to that
+    // receiver; one repair job per shard, announced version and receiver
+    bool queueBlockRepair(const WeightShard& shard, uint16_t missing, uint8_t version,
+                          uint16_t dst) {
+        for (uint8_t i = 0; i < tx_count_; i++) {
+            TxJob& job = tx_queue_[(tx_head_ + i) % TX_QUEUE_DEPTH];
+            if (job.shard == &shard && job.blocks && !job.tracker && job.version == version &&
+                job.dst == dst) {
+                job.remaining |= missing;
+                job.blocks |= missing;
+                return true;
+            }
+        }
+        if (tx_count_ >= TX_QUEUE_DEPTH) return false;
+
+        TxJob& job = tx_queue_[(tx_head_ + tx_count_) % TX_QUEUE_DEPTH];
+        job.shard = &shard;
+        job.tracker = nullptr;
+        job.deadline_tick = clock_time();
+        job.checksum = shard.header.checksum;
+        job.remaining = missing;
+        job.blocks = missing;
+        job.dst = dst;
+        job.shard_id = shard.header.shard_id;
+        job.version = version;
+        job.retransmit = true;
+        job.reply = true;
+        tx_count_++;
+        return true;
+    }
+
+    // One SHARD_FRAGMENT, payload read directly from the shard (RAM or flash)
+    void sendFragment(const TxJob& job, uint8_t idx) {
+        const WeightShard& shard = *job.shard;
+        const uint8_t* shard_bytes = reinterpret_cast<const uint8_t*>(&shard);
+
+        size_t payload_start = static_cast<size_t>(idx) * FRAGMENT_SIZE;
+        size_t payload_len = FRAGMENT_SIZE;
+        if (payload_start + payload_len > WeightShard::WIRE_SIZE) {
+            payload_len = WeightShard::WIRE_SIZE - payload_start;
+        }
+        // Packed only when strictly shorter; else the raw bytes, sent in place
+        uint8_t packed_buf[FRAGMENT_SIZE - 1];
+        TxSegment payload = {shard_bytes + payload_start, payload_len};
+        size_t packed = kernels::pack_s8(reinterpret_cast<const int8_t*>(payload.data),
+                                         payload_len, packed_buf, payload_len - 1);
+        if (packed) payload = {packed_buf, packed};
 
+        uint8_t head[sizeof(GossipHeader) + sizeof(FragmentInfo)];
+        wire::Writer w(head, sizeof(head));
+        writeHeader(w, (job.retransmit ? GOSSIP_FLAG_RETRANSMIT : 0) |
+                       (job.reply ? GOSSIP_FLAG_REPLY : 0) |
+                       (packed ? GOSSIP_FLAG_PACKED : 0));
+        w.u8(shard.header.shard_id);
+        w.u8(idx);
+        w.u8(TOTAL_FRAGMENTS);
+        w.u8(static_cast<uint8_t>(shard.header.checksum));
+
+        const TxSegment segs[] = {w.segment(), payload};
+        meshSend(GossipOpcode::SHARD_FRAGMENT, ttlTo(job.dst), segs, 2, job.dst);
+    }
+
+    // One WEIGHT_DELTA: block b's bitmap straight from the tracker
+    // (zero-padded for the short last block) and the current value of
+    // every marked weight, in index order. The marks are cleared once
+    // sent; later changes mark the block again. A repair marks the whole
+    // block and sends its weights in place.
+    void sendDeltaBlock(const TxJob& job, uint8_t b) {
+        static const uint8_t zeros[DELTA_BITMAP_BYTES] = {};
+        const WeightShard& shard = *job.shard;
+        size_t bitmap_len = blockBitmapBytes(b);
+        size_t first = static_cast<size_t>(b) * DELTA_BLOCK_WEIGHTS;
+
+        uint8_t values[DELTA_BLOCK_WEIGHTS];
+        uint8_t dense[DELTA_BITMAP_BYTES];
+        const uint8_t* bitmap;
+        TxSegment value_seg;
+        if (job.tracker) {
+            bitmap = &job.tracker->changed[b * DELTA_BITMAP_BYTES];
+            size_t count = 0;
+            for (size_t k = 0; k < bitmap_len * 8; k++) {
+                if (bitmap[k >> 3] & (1u << (k & 7))) {
+                    values[count++] = static_cast<uint8_t>(shard.weights[first + k]);
+                }
+            }
+            value_seg = {values, count};
+        } else {
+            size_t n = WeightShard::MODEL_WEIGHTS - first;
+            if (n > DELTA_BLOCK_WEIGHTS) n = DELTA_BLOCK_WEIGHTS;
+            memset(dense, 0xFF, n / 8);
+            if (n % 8) dense[n / 8] = static_cast<uint8_t>((1u << (n % 8)) - 1);
+            bitmap = dense;
+            value_seg = {reinterpret_cast<const uint8_t*>(&shard.weights[first]), n};
+        }
+        uint16_t crc = crc16::update(crc16::INIT, bitmap, bitmap_len);
+        crc = crc16::update(crc, zeros, DELTA_BITMAP_BYTES - bitmap_len);
+        crc = crc16::update(crc, value_seg.data, value_seg.len);
+
+        uint8_t head[sizeof(GossipHeader) + sizeof(DeltaInfo)];
+        wire::Writer w(head, sizeof(head));
+        writeHeader(w, job.tracker ? 0 : (GOSSIP_FLAG_RETRANSMIT | GOSSIP_FLAG_REPLY));
+        w.u8(shard.header.shard_id);
+        w.u8(job.tracker ? job.tracker->base_version : job.version);  // A repair has no base
+        w.u8(job.version);
+        w.u8(b);
+        w.u16(shard.header.contributors);
+        w.u16(job.blocks);
+        w.u16(crc);
+
+        const TxSegment segs[] = {w.segment(), {bitmap, bitmap_len},
+                                  {zeros, DELTA_BITMAP_BYTES - bitmap_len}, value_seg};
+        meshSend(GossipOpcode::WEIGHT_DELTA, ttlTo(job.dst), segs, 4, job.dst);
+        if (job.tracker) memset(&job.tracker->changed[b * DELTA_BITMAP_BYTES], 0, bitmap_len);
+    }
+
+    //-------------------------------------------------------------------------
+    // Cluster aggregation
+    //
+    // Below CLUSTER_MIN_NEIGHBORS we flood. Otherwise a node whose key
+    // (load in CLUSTER_LOAD_STEP buckets, then address) beats every
+    // neighbour's becomes a head; the rest join the advertised head with
+    // the best RSSI. A node that hears no head leads until one appears, so
+    // every node ends up one hop from a head.
+    //-------------------------------------------------------------------------
+    void updateCluster(uint8_t load) {
+        if (neighbors_.size() < CLUSTER_MIN_NEIGHBORS) {
+            role_ = ClusterRole::FLOOD;
+            cluster_head_ = MESH_ADDR_ALL;
+            return;
+        }
+
+        uint32_t my_key = clusterKey(load, my_addr_);
+        bool lowest = true;
+        const NeighborInfo* head = nullptr;
+        for (uint8_t i = 0; i < NEIGHBOR_SLOTS; i++) {
+            const NeighborInfo& n = neighbors_.slot(i);
+            if (!n.addr) continue;
+            if (clusterKey(n.load, n.addr) < my_key) lowest = false;
+            if (n.cluster_head == n.addr && (!head || n.rssi > head->rssi)) head = &n;
+        }
+
+        if (lowest || !head) {
+            role_ = ClusterRole::HEAD;
+            cluster_head_ = my_addr_;
+        } else {
+            role_ = ClusterRole::MEMBER;
+            cluster_head_ = head->addr;
+        }
+    }
+
+    static uint32_t clusterKey(uint8_t load, uint16_t addr) {
+        return (static_cast<uint32_t>(load / CLUSTER_LOAD_STEP) << 16) | addr;
+    }
+
+    // Members hand shards to their head only; one hop, no relay
+    uint16_t shardDst() const {
+        return role_ == ClusterRole::MEMBER ? cluster_head_ : MESH_ADDR_ALL;
+    }
+
+    // A unicast to a neighbour is one hop; anything else may need relays
+    uint8_t ttlTo(uint16_t dst) const {
+        return (dst != MESH_ADDR_ALL && neighbors_.find(dst)) ? 1 : 3;
+    }
+
+    // Heads take uplinks and other heads' aggregates; members only their
+    // own head's aggregate, which they adopt rather than average, and
+    // answers to their own requests
+    bool acceptsShardData(const RxMessage& msg) const {
+        return role_ != ClusterRole::MEMBER || msg.src_addr == cluster_head_ ||
+               (msg.flags & GOSSIP_FLAG_REPLY);
+    }
+
+    bool isSendingDelta(const DeltaTracker& t) const {
+        for (uint8_t i = 0; i < tx_count_; i++) {
+            if (tx_queue_[(tx_head_ + i) % TX_QUEUE_DEPTH].tracker == &t) return true;
+        }
+        return false;
+    }
+
+    bool isRepairable(const WeightShard& shard) const {
+        return repair_shard_ == &shard &&
+               static_cast<int32_t>(clock_time() - repair_until_tick_) < 0;
+    }
+
+    void popTxJob() {
+        tx_head_ = (tx_head_ + 1) % TX_QUEUE_DEPTH;
+        tx_count_--;
+    }
+
+    // Fragment spacing: TX_FRAGMENT_GAP_MS on an idle mesh, up to double
+    // when neighbours report full load (or backpressure)
+    uint32_t txGapTicks() const {
+        uint8_t count = neighbors_.size();
+        uint32_t avg_load = count ? load_sum_ / count : 0;
+        if (avg_load > 100) avg_load = 100;
+        return TX_FRAGMENT_GAP_MS * 1000 * HWScheduler::TICK_PER_US * (100 + avg_load) / 100;
+    }
+
+    // Sliding-window replay check, as the SIG mesh replay protection list
+    // does it: numbers ahead of the newest advance the window, numbers in
+    // it are duplicates if already marked. One further back than the
+    // window means the source restarted its (8-bit) sequence.
     bool isDuplicate(uint16_t src, uint8_t seq) {
-        // Simple ring buffer of recent (src, seq) pairs
-        for (int i = 0; i < 16; i++) {
-            if (seen_src_[i] == src && seen_seq_[i] == seq) return true;
+        bool created;
+        ReplayEntry* e = replay_.insert(src, created);
+        if (!e) return false;  // Table full: cannot tell, so process it
+        e->last_tick = clock_time();
+
+        uint8_t ahead = static_cast<uint8_t>(seq - e->last_seq);
+        if (created || (ahead != 0 && ahead < 128)) {
+            e->window = (created || ahead >= REPLAY_WINDOW) ? 1 : (e->window << ahead) | 1;
+            e->last_seq = seq;
+            return false;
+        }
+
+        uint8_t behind = static_cast<uint8_t>(e->last_seq - seq);
+        if (behind >= REPLAY_WINDOW) {
+            e->window = 1;
+            e->last_seq = seq;
+            return false;
         }
-        seen_src_[seen_idx_] = src;
-        seen_seq_[seen_idx_] = seq;
-        seen_idx_ = (seen_idx_ + 1) % 16;
+        uint32_t bit = 1u << behind;
+        if (e->window & bit) return true;
+        e->window |= bit;
         return false;
     }
 
-    void updateNeighbor(uint16_t addr, int8_t rssi, const uint8_t* data, size_t len) {
-        // Find or create neighbor entry
+    void updateNeighbor(uint16_t addr, int8_t rssi) {
+        // Beyond MAX_NEIGHBORS (or a full table) new peers are not tracked
         NeighborInfo* n = nullptr;
-        for (uint8_t i = 0; i < neighbor_count_; i++) {
-            if (neighbors_[i].addr == addr) {
-                n = &neighbors_[i];
-                break;
+        if (neighbors_.size() < MAX_NEIGHBORS) {
+            bool created;
+            n = neighbors_.insert(addr, created);
+            if (created) {  // Until its first heartbeat
+                n->offer = NO_SHARD_ID;
+                memset(n->held.resident, NO_SHARD_ID, sizeof(n->held.resident));
             }
-        }
-        if (!n && neighbor_count_ < MAX_NEIGHBORS) {
-            n = &neighbors_[neighbor_count_++];
-            n->addr = addr;
+        } else {
+            n = neighbors_.find(addr);
         }
         if (n) {
             n->rssi = static_cast<uint8_t>(rssi + 128);  // Convert to unsigned
@@ -247,98 +1283,529 @@ private:
         }
     }
 
-    void handleWeightUpdate(const uint8_t* payload, size_t len, const GossipHeader* hdr) {
-        // Direct weight update (small model only)
-        if (len >= sizeof(WeightShard)) {
-            const WeightShard* shard = reinterpret_cast<const WeightShard*>(payload);
-            if (on_shard_cb_) {
-                on_shard_cb_(*shard, on_shard_ctx_);
+    // Keep the totals behind shouldThrottle() and txGapTicks() current
+    void setNeighborLoad(NeighborInfo& n, uint8_t load) {
+        load_sum_ += load;
+        load_sum_ -= n.load;
+        overloaded_count_ += (load > 80);
+        overloaded_count_ -= (n.load > 80);
+        n.load = load;
+    }
+
+    // Drop neighbours and replay entries silent for their expiry time,
+    // EXPIRY_SWEEP_SLOTS slots of each table per call
+    void expireStale(uint32_t now) {
+        constexpr uint32_t neighbor_ticks = NEIGHBOR_EXPIRY_MS * 1000 * HWScheduler::TICK_PER_US;
+        constexpr uint32_t replay_ticks = REPLAY_EXPIRY_MS * 1000 * HWScheduler::TICK_PER_US;
+
+        for (uint8_t k = 0; k < EXPIRY_SWEEP_SLOTS; k++) {
+            NeighborInfo& n = neighbors_.slot(neighbor_sweep_);
+            if (n.addr && now - n.last_seen_tick > neighbor_ticks) {
+                setNeighborLoad(n, 0);
+                neighbors_.erase(&n);  // Pulls a later entry here; next sweep sees it
             }
+            neighbor_sweep_ = (neighbor_sweep_ + 1) % NEIGHBOR_SLOTS;
+
+            ReplayEntry& r = replay_.slot(replay_sweep_);
+            if (r.addr && now - r.last_tick > replay_ticks) replay_.erase(&r);
+            replay_sweep_ = (replay_sweep_ + 1) % REPLAY_SLOTS;
         }
     }
 
-    void handleWeightRequest(const uint8_t* payload, size_t len, uint16_t requester) {
-        // TODO: Check if we have the requested shard and send it
+    // Bitmap bytes that belong to block b (the last block is short)
+    static size_t blockBitmapBytes(uint8_t b) {
+        size_t start = static_cast<size_t>(b) * DELTA_BITMAP_BYTES;
+        size_t n = DeltaTracker::BITMAP_BYTES - start;
+        return (n < DELTA_BITMAP_BYTES) ? n : DELTA_BITMAP_BYTES;
     }
 
-    void handleHeartbeat(const uint8_t* payload, size_t len, uint16_t src) {
-        if (len < sizeof(HeartbeatPayload)) return;
-        const HeartbeatPayload* hb = reinterpret_cast<const HeartbeatPayload*>(payload);
+    // Length checked against OPCODE_SPECS; bitmap and values are used in place
+    void handleDelta(const uint8_t* payload, size_t len, const RxMessage& msg) {
+        DeltaView view(payload);
+        DeltaInfo info = view.info();
+        const uint8_t* bitmap = view.bitmap();
+        size_t value_count = len - sizeof(DeltaInfo) - DELTA_BITMAP_BYTES;
 
-        for (uint8_t i = 0; i < neighbor_count_; i++) {
-            if (neighbors_[i].addr == src) {
-                neighbors_[i].load = hb->load_percent;
-                break;
+        if (crc16::update(crc16::INIT, bitmap, DELTA_BITMAP_BYTES + value_count) != info.crc) return;
+
+        if (info.block_idx >= DELTA_BLOCKS) return;  // Off the air: never shift by it first
+        uint16_t bit = 1u << info.block_idx;
+        if (!(info.blocks & bit)) return;
+
+        // A shard the store holds but RAM does not is no more worth a
+        // staging erase here than an overheard transfer of it (openSlot())
+        if (!(shard_lookup_cb_ && shard_lookup_cb_(info.shard_id, shard_lookup_ctx_)) &&
+            stored_lookup_cb_ && stored_lookup_cb_(info.shard_id, stored_lookup_ctx_)) {
+            return;
+        }
+
+        // A repair resends, dense, blocks of the delta we are part-way
+        // through; it has no base of its own
+        bool repair = msg.flags & GOSSIP_FLAG_RETRANSMIT;
+        PeerShardVersion* pv = findPeerVersion(msg.src_addr, info.shard_id);
+        if (repair) {
+            if (!pv || pv->delta_version != info.version || !(pv->pending & bit)) return;
+        } else {
+            // Deltas only make sense on top of the sender's base version,
+            // or a later copy of its shard (an overheard reply): the changes
+            // since the base cover everything since. A delta on top of one
+            // we are still short of carries that one's gaps, until they have
+            // been NACKed FRAGMENT_MAX_NACKS times. Else the sender holds the
+            // full shard, so ask it (once, on the last block).
+            bool ongoing = pv && pv->pending && pv->delta_version == info.version;
+            bool carried = pv && pv->pending && pv->delta_version == info.base_version &&
+                           pv->nacks < FRAGMENT_MAX_NACKS;
+            if (!ongoing && !carried &&
+                (!pv || WeightShard::versionBefore(pv->version, info.base_version))) {
+                if ((info.blocks >> info.block_idx) == 1) requestShardFrom(msg.src_addr, info.shard_id);
+                return;
+            }
+            if (!ongoing) {
+                if (!WeightShard::versionBefore(pv->version, info.version)) return;  // Nothing new
+                pv->pending = (carried ? pv->pending : 0) | info.blocks;
+                pv->delta_version = info.version;
+                pv->nack_owed = false;
+                if (!carried) pv->nacks = 0;
+            }
+        }
+
+        // The peer version only moves once every listed block is in.
+        // Blocks lost or refused are NACKed once the last listed one (of
+        // the delta or its repair) is in, up to FRAGMENT_MAX_NACKS times.
+        bool fresh = pv->pending & bit;  // Else merged already; never blend twice
+        if (fresh) {
+            uint16_t left = pv->pending & ~bit;
+            const int8_t* values = reinterpret_cast<const int8_t*>(bitmap + DELTA_BITMAP_BYTES);
+            if (on_delta_cb_ &&
+                on_delta_cb_(info, bitmap, values, value_count, left == 0, on_delta_ctx_)) {
+                pv->pending = left;
+                if (left == 0) pv->version = info.version;
             }
         }
+        if (fresh && (info.blocks >> info.block_idx) == 1) {
+            pv->nack_owed = pv->pending != 0 && pv->nacks < FRAGMENT_MAX_NACKS;
+        }
     }
 
-    void handleFragment(const uint8_t* payload, size_t len, const GossipHeader* hdr) {
-        if (len < sizeof(FragmentInfo)) return;
-        const FragmentInfo* frag = reinterpret_cast<const FragmentInfo*>(payload);
+    // Last shard version merged from each peer, for delta base checks
+    PeerShardVersion* findPeerVersion(uint16_t addr, uint8_t shard_id) {
+        for (uint8_t i = 0; i < PEER_VERSION_SLOTS; i++) {
+            if (peer_versions_[i].addr == addr && peer_versions_[i].shard_id == shard_id) {
+                return &peer_versions_[i];
+            }
+        }
+        return nullptr;
+    }
+
+    void notePeerVersion(uint16_t addr, uint8_t shard_id, uint8_t version) {
+        PeerShardVersion* pv = findPeerVersion(addr, shard_id);
+        if (!pv) {
+            pv = &peer_versions_[peer_version_next_];
+            peer_version_next_ = (peer_version_next_ + 1) % PEER_VERSION_SLOTS;
+            pv->addr = addr;
+            pv->shard_id = shard_id;
+        }
+        pv->version = version;
+        pv->pending = 0;
+        pv->nack_owed = false;
+    }
+
+    // Serve a requested shard to the requester through the paced queue:
+    // from RAM if resident, else straight from its flash record. Open
+    // (MESH_ADDR_ALL) requests are only answered from RAM.
+    void handleWeightRequest(const RequestView& req, const RxMessage& msg) {
+        bool addressed = req.targetAddr() == my_addr_;
+        if (!addressed && req.targetAddr() != MESH_ADDR_ALL) return;
+
+        uint8_t shard_id = req.shardId();
+        const WeightShard* shard = shard_lookup_cb_ ? shard_lookup_cb_(shard_id, shard_lookup_ctx_)
+                                                    : nullptr;
+        if (!shard && addressed && stored_lookup_cb_) {
+            shard = stored_lookup_cb_(shard_id, stored_lookup_ctx_);
+        }
+        if (!shard) return;
+        queueFragments(*shard, ALL_FRAGMENTS, false, msg.src_addr, true);
+    }
+
+    void handleHeartbeat(const HeartbeatView& hb, uint16_t src) {
+        NeighborInfo* n = neighbors_.find(src);
+        if (n) {
+            setNeighborLoad(*n, hb.load());
+            n->cluster_head = hb.clusterHead();
+            hb.held(n->held);
+            n->offer = hb.offerShard();
+        }
+    }
 
-        // Find or allocate reassembly buffer
-        int buf_idx = -1;
+    void handleLease(const LeaseView& lease, const RxMessage& msg) {
+        if (lease.targetAddr() != my_addr_ || lease.op() > static_cast<uint8_t>(LeaseOp::RETURN)) {
+            return;
+        }
+        if (on_lease_cb_) {
+            on_lease_cb_(msg.src_addr, lease.shardId(), static_cast<LeaseOp>(lease.op()),
+                         on_lease_ctx_);
+        }
+    }
+
+    void handleFragment(const uint8_t* payload, size_t len, const RxMessage& msg) {
+        PLANETARY_TRACE_SCOPE(TracePoint::FRAGMENT);
+        FragmentView frag(payload);
+        if (frag.totalFragments() == 0 || frag.totalFragments() > 16 ||
+            frag.fragmentIdx() >= frag.totalFragments()) return;
+
+        // Repairs only fill transfers already in progress
+        bool retransmit = msg.flags & GOSSIP_FLAG_RETRANSMIT;
+        int buf_idx = findSlot(msg.src_addr, frag.shardId(), !retransmit);
+        if (buf_idx < 0) return;
+        ReassemblySlot& slot = reassembly_[buf_idx];
+
+        // Fresh transfer, or the sender's shard changed: start over
+        if (slot.shard_id != frag.shardId() || slot.content_tag != frag.contentTag()) {
+            if (!openSlot(buf_idx, msg, frag)) return;
+        }
+        slot.last_tick = clock_time();
+        slot.nacks_sent = 0;
+
+        uint16_t bit = 1u << frag.fragmentIdx();
+        if (slot.received & bit) return;  // Duplicate; never blend twice
+
+        size_t offset = frag.fragmentIdx() * FRAGMENT_SIZE;
+        const uint8_t* data = payload + sizeof(FragmentInfo);
+        size_t data_len = len - sizeof(FragmentInfo);
+        alignas(4) int8_t unpacked[FRAGMENT_SIZE];
+        if (msg.flags & GOSSIP_FLAG_PACKED) {
+            if (offset >= WeightShard::WIRE_SIZE) return;
+            size_t raw_len = WeightShard::WIRE_SIZE - offset;
+            if (raw_len > FRAGMENT_SIZE) raw_len = FRAGMENT_SIZE;
+            if (!data_len || kernels::unpack_s8(data, data_len, unpacked, raw_len) != data_len) return;
+            data = reinterpret_cast<const uint8_t*>(unpacked);
+            data_len = raw_len;
+        }
+        if (offset + data_len > WeightShard::WIRE_SIZE) return;
+        if (!storeFragment(buf_idx, offset, data, data_len)) return;
+        slot.received |= bit;
+
+        uint16_t complete_mask = (1u << slot.total_fragments) - 1;
+        if (slot.received == complete_mask) completeSlot(buf_idx);
+    }
+
+    // Start a transfer in slot i. Resident shards merge in place; others
+    // need an erased staging sector (stagingMaintenanceStep() provides one).
+    bool openSlot(int i, const RxMessage& msg, const FragmentView& frag) {
+        ReassemblySlot& slot = reassembly_[i];
+        WeightShard* target = shard_lookup_cb_ ? shard_lookup_cb_(frag.shardId(), shard_lookup_ctx_)
+                                               : nullptr;
+        freeSlot(slot);
+
+        // A shard whose fragments are on air is read-only (an edit restarts
+        // the transfer); the sender NACKs or resends once ours has drained
+        if (target && isReadOnly(*target)) return false;
+        // An overheard copy of a shard the store already holds is not worth
+        // a staging erase; requested ones (replies) always are
+        if (!target && !(msg.flags & GOSSIP_FLAG_REPLY) && stored_lookup_cb_ &&
+            stored_lookup_cb_(frag.shardId(), stored_lookup_ctx_)) return false;
+        // On a content change, fragments already blended in place were
+        // genuine sender weights and stay merged; a staging sector that has
+        // been written must be erased before it can take a new transfer
+        if (!target && (staging_dirty_ & (1u << i))) return false;
+        if (!target) {
+            staging_dirty_ |= 1u << i;
+            // Bytes past WIRE_SIZE are never sent; program their zeros now
+            static const uint8_t tail[sizeof(WeightShard) - WeightShard::WIRE_SIZE] = {};
+            stagingWrite(i, WeightShard::WIRE_SIZE, tail, sizeof(tail));
+        }
+
+        slot.target = target;
+        slot.changed = target && change_lookup_cb_ ? change_lookup_cb_(*target, change_lookup_ctx_)
+                                                   : nullptr;
+        slot.src_addr = msg.src_addr;
+        slot.shard_id = frag.shardId();
+        slot.content_tag = frag.contentTag();
+        slot.total_fragments = frag.totalFragments();
+        slot.reply = msg.flags & GOSSIP_FLAG_REPLY;
+        return true;
+    }
+
+    // Fold one fragment (wire bytes [offset, offset + len)) into the slot
+    bool storeFragment(int i, size_t offset, const uint8_t* data, size_t len) {
+        ReassemblySlot& slot = reassembly_[i];
+        size_t skip = 0;
+
+        if (offset == 0) {
+            if (len < sizeof(ShardHeader)) return false;
+            memcpy(&slot.header, data, sizeof(ShardHeader));
+            if (slot.header.shard_id != slot.shard_id) return false;
+            if (slot.target && role_ == ClusterRole::MEMBER && slot.src_addr == cluster_head_) {
+                // The head's aggregate already holds our update: adopt it
+                slot.merge_total = slot.header.contributors;
+                slot.alpha_q8 = 256;
+            } else if (slot.target) {
+                uint16_t local_n = slot.target->header.contributors;
+                slot.merge_total = WeightShard::mergeCount(local_n, slot.header.contributors);
+                if (slot.merge_total == 0) return false;
+                slot.alpha_q8 = WeightShard::blendFactor(local_n, slot.header.contributors);
+            }
+            slot.has_header = true;
+            skip = sizeof(ShardHeader);
+        } else if (slot.target && !slot.has_header) {
+            return false;  // No blend factor yet; a NACK fetches it again
+        }
+
+        // Weight bytes of this fragment, as offsets into the payload
+        size_t begin = offset + skip - sizeof(ShardHeader);
+        size_t n = len - skip;
+        slot.crc_acc ^= crc16::shiftZeros(crc16::update(0, data + skip, n),
+                                         sizeof(WeightShard::weights) - (begin + n));
+
+        if (slot.target) {
+            if (slot.target->header.shard_id != slot.shard_id) {
+                freeSlot(slot);  // Slot rotated to another shard mid-transfer
+                return false;
+            }
+            const int8_t* incoming = reinterpret_cast<const int8_t*>(data + skip);
+            slot.disagreed += static_cast<uint16_t>(kernels::mark_diff_s8(
+                slot.target->weights + begin, incoming, n, slot.changed, begin));
+            slot.target->blendRange(incoming, begin, n, slot.alpha_q8);
+        } else {
+            stagingWrite(i, offset, data, len);
+        }
+        return true;
+    }
+
+    // All fragments in. The order-independent CRC stands in for
+    // verifyChecksum(): crc(payload) = INIT * x^(8 len) ^ (sum of pieces).
+    // A corrupt copy is never committed: a resident blend is handed back
+    // for restoring, and the sender is asked once for a clean copy (not
+    // again if that reply fails too).
+    void completeSlot(int i) {
+        ReassemblySlot& slot = reassembly_[i];
+        const uint16_t seed = crc16::shiftZeros(crc16::INIT, sizeof(WeightShard::weights));
+        bool intact = slot.has_header && (seed ^ slot.crc_acc) == slot.header.checksum;
+
+        if (!intact) {
+            if (slot.target && on_merge_failed_cb_) {
+                on_merge_failed_cb_(*slot.target, on_merge_failed_ctx_);
+            }
+            if (!slot.reply) requestShardFrom(slot.src_addr, slot.shard_id);
+        } else if (slot.target) {
+            slot.target->finishMerge(slot.header, slot.merge_total);
+            notePeerVersion(slot.src_addr, slot.shard_id, slot.header.version);
+            if (on_merge_cb_) on_merge_cb_(*slot.target, slot.disagreed, on_merge_ctx_);
+        } else {
+            notePeerVersion(slot.src_addr, slot.shard_id, slot.header.version);
+            if (on_shard_cb_ && on_shard_cb_(*stagingShard(i), on_shard_ctx_)) {
+                staging_held_ |= 1u << i;
+            }
+        }
+        freeSlot(slot);  // A staging sector stays dirty until erased
+    }
+
+    // Slot for (src, shard); with allocate, prefer a free slot whose
+    // staging sector is erased, then any free slot, then the least
+    // recently active transfer
+    int findSlot(uint16_t src, uint8_t shard_id, bool allocate) {
+        int best = -1;
+        uint8_t best_rank = 0;
         for (int i = 0; i < MAX_PENDING_FRAGMENTS; i++) {
-            if (pending_shards_[i] == frag->shard_id ||
-                (pending_shards_[i] == 0xFF && buf_idx < 0)) {
-                buf_idx = i;
-                if (pending_shards_[i] == frag->shard_id) break;
+            const ReassemblySlot& s = reassembly_[i];
+            if (s.shard_id == shard_id && s.src_addr == src) return i;
+
+            uint8_t rank = (s.shard_id != 0xFF) ? 0 : (staging_dirty_ & (1u << i)) ? 1 : 2;
+            if (best < 0 || rank > best_rank ||
+                (rank == 0 && best_rank == 0 &&
+                 static_cast<int32_t>(s.last_tick - reassembly_[best].last_tick) < 0)) {
+                best = i;
+                best_rank = rank;
             }
         }
-        if (buf_idx < 0) return;  // No buffer space
+        if (!allocate) return -1;
+        freeSlot(reassembly_[best]);  // Evicted transfer is abandoned
+        return best;
+    }
 
-        pending_shards_[buf_idx] = frag->shard_id;
+    static void freeSlot(ReassemblySlot& slot) {
+        slot.target = nullptr;
+        slot.changed = nullptr;
+        slot.shard_id = 0xFF;
+        slot.received = 0;
+        slot.crc_acc = 0;
+        slot.disagreed = 0;
+        slot.nacks_sent = 0;
+        slot.has_header = false;
+    }
 
-        // Copy fragment data
-        size_t data_offset = frag->fragment_idx * FRAGMENT_SIZE;
-        size_t data_len = len - sizeof(FragmentInfo);
-        if (data_offset + data_len <= sizeof(WeightShard)) {
-            memcpy(fragment_buffer_[buf_idx] + data_offset,
-                   payload + sizeof(FragmentInfo), data_len);
-            pending_masks_[buf_idx] |= (1 << frag->fragment_idx);
-        }
-
-        // Check if complete
-        uint16_t complete_mask = (1 << frag->total_fragments) - 1;
-        if (pending_masks_[buf_idx] == complete_mask) {
-            const WeightShard* shard = reinterpret_cast<const WeightShard*>(fragment_buffer_[buf_idx]);
-            if (shard->verifyChecksum() && on_shard_cb_) {
-                on_shard_cb_(*shard, on_shard_ctx_);
+    // NACK reassemblies idle for FRAGMENT_NACK_MS; give up after
+    // FRAGMENT_MAX_NACKS unanswered requests
+    void serviceReassembly(uint32_t now) {
+        constexpr uint32_t nack_ticks = FRAGMENT_NACK_MS * 1000 * HWScheduler::TICK_PER_US;
+        for (uint8_t i = 0; i < MAX_PENDING_FRAGMENTS; i++) {
+            ReassemblySlot& slot = reassembly_[i];
+            if (slot.shard_id == 0xFF || now - slot.last_tick < nack_ticks) continue;
+
+            if (slot.nacks_sent >= FRAGMENT_MAX_NACKS) {
+                freeSlot(slot);
+                continue;
             }
-            // Clear buffer
-            pending_shards_[buf_idx] = 0xFF;
-            pending_masks_[buf_idx] = 0;
+            uint16_t complete_mask = (1u << slot.total_fragments) - 1;
+            sendNack(slot.src_addr, slot.shard_id, slot.content_tag,
+                     complete_mask & ~slot.received, 0);
+            slot.nacks_sent++;
+            slot.last_tick = now;
         }
     }
 
-    void handleBackpressure(uint16_t src) {
-        for (uint8_t i = 0; i < neighbor_count_; i++) {
-            if (neighbors_[i].addr == src) {
-                neighbors_[i].load = 100;  // Mark as overloaded
-                break;
+    // NACK the blocks a finished delta left out, once our copy of the
+    // shard takes merges again (its own fragments may be on air); an
+    // evicted shard is past repairing
+    void serviceDeltaNacks() {
+        for (uint8_t i = 0; i < PEER_VERSION_SLOTS; i++) {
+            PeerShardVersion& pv = peer_versions_[i];
+            if (!pv.nack_owed) continue;
+            const WeightShard* shard =
+                shard_lookup_cb_ ? shard_lookup_cb_(pv.shard_id, shard_lookup_ctx_) : nullptr;
+            if (shard && isReadOnly(*shard)) continue;
+            if (shard) {
+                sendNack(pv.addr, pv.shard_id, pv.delta_version, pv.pending, GOSSIP_FLAG_DELTA);
+                pv.nacks++;
+            }
+            pv.nack_owed = false;
+        }
+    }
+
+    void sendNack(uint16_t target, uint8_t shard_id, uint8_t tag, uint16_t missing,
+                  uint8_t flags) {
+        uint8_t msg[sizeof(GossipHeader) + sizeof(NackInfo)];
+        wire::Writer w(msg, sizeof(msg));
+        writeHeader(w, flags);
+        w.u16(target);
+        w.u8(shard_id);
+        w.u8(tag);
+        w.u16(missing);
+
+        TxSegment seg = w.segment();
+        meshSend(GossipOpcode::NACK, 3, &seg, 1);  // Sender may be up to 3 hops away
+    }
+
+    // Resend what a receiver is missing, to that receiver. If the shard
+    // changed since, its fragments no longer fit together: send all of it.
+    // Missed delta blocks go again dense from the resident shard, whose
+    // weights have only moved on since.
+    void handleNack(const NackView& nack, const RxMessage& msg) {
+        if (nack.targetAddr() != my_addr_) return;
+
+        uint8_t shard_id = nack.shardId();
+        const WeightShard* shard = shard_lookup_cb_ ? shard_lookup_cb_(shard_id, shard_lookup_ctx_)
+                                                    : nullptr;
+        if (msg.flags & GOSSIP_FLAG_DELTA) {
+            uint16_t missing = nack.missing() & ((1u << DELTA_BLOCKS) - 1);
+            if (shard && missing) {
+                queueBlockRepair(*shard, missing, nack.contentTag(), msg.src_addr);
             }
+            return;
+        }
+        if (!shard && stored_lookup_cb_) shard = stored_lookup_cb_(shard_id, stored_lookup_ctx_);
+        if (!shard) return;
+
+        if (static_cast<uint8_t>(shard->header.checksum) == nack.contentTag()) {
+            uint16_t missing = nack.missing() & ALL_FRAGMENTS;
+            if (missing) queueFragments(*shard, missing, true, msg.src_addr, true);
+        } else {
+            queueFragments(*shard, ALL_FRAGMENTS, false, msg.src_addr, true);
+        }
+    }
+
+    // Answer a STATS request with this node's profile. Replies from other
+    // nodes are for the gateway/CLI and are ignored here.
+    void handleStats(const uint8_t* payload, size_t len) {
+        if (len >= sizeof(StatsPayload)) return;
+
+        uint8_t flags = 0;
+        if (len >= sizeof(StatsRequest)) {
+            StatsRequestView req(payload);
+            if (req.targetAddr() != 0xFFFF && req.targetAddr() != my_addr_) return;
+            flags = req.flags();
+        }
+
+        uint8_t msg[sizeof(GossipHeader) + sizeof(StatsPayload)];
+        wire::Writer w(msg, sizeof(msg));
+        writeHeader(w, 0);
+        uint8_t tasks = g_trace.taskCount();
+        w.u8(g_trace.aiDuty());
+        w.u8(tasks);
+        w.u8(TRACE_POINTS);
+        w.u8(0);
+        for (uint8_t i = 0; i < TRACE_MAX_TASKS; i++) {
+            w.u8(i < tasks ? g_trace.taskDuty(i) : 0);
+        }
+        for (uint8_t p = 0; p < TRACE_POINTS; p++) {
+            const TraceStat& s = g_trace.stat(static_cast<TracePoint>(p));
+            w.u16(static_cast<uint16_t>(s.count > 0xFFFF ? 0xFFFF : s.count));
+            uint32_t avg = s.count ? s.total_us / s.count : 0;
+            w.u16(static_cast<uint16_t>(avg > 0xFFFF ? 0xFFFF : avg));
+            w.u16(s.max_us);
+            for (uint8_t k = 0; k < TRACE_BUCKETS; k++) w.u16(s.hist[k]);
         }
+
+        TxSegment seg = w.segment();
+        meshSend(GossipOpcode::STATS, 3, &seg, 1);
+        if (flags & STATS_FLAG_RESET) g_trace.reset();
     }
 
-    NeighborInfo neighbors_[MAX_NEIGHBORS];
-    uint8_t      neighbor_count_;
+    void handleBackpressure(uint16_t src) {
+        NeighborInfo* n = neighbors_.find(src);
+        if (n) setNeighborLoad(*n, 100);  // Mark as overloaded
+    }
+
+    AddrTable<NeighborInfo, NEIGHBOR_SLOTS, MAX_NEIGHBORS> neighbors_;
+    uint16_t     load_sum_ = 0;            // Sum of neighbour loads
+    uint8_t      overloaded_count_ = 0;    // Neighbours above 80% load
+    uint8_t      neighbor_sweep_ = 0;
     uint16_t     my_addr_;
     uint8_t      seq_num_;
+    ClusterRole  role_;
+    uint16_t     cluster_head_;
+    uint8_t      offer_shard_ = NO_SHARD_ID;
+
+    // Replay protection per originating node
+    AddrTable<ReplayEntry, REPLAY_SLOTS, REPLAY_SLOTS * 3 / 4> replay_;
+    uint8_t  replay_sweep_ = 0;
+
+    // Fragment reassembly (staging contents unknown at boot)
+    ReassemblySlot reassembly_[MAX_PENDING_FRAGMENTS];
+    uint8_t        staging_dirty_ = (1u << MAX_PENDING_FRAGMENTS) - 1;
+    uint8_t        staging_held_ = 0;  // Views the ShardCallback still reads
 
-    // Dedup tracking
-    uint16_t seen_src_[16] = {0};
-    uint8_t  seen_seq_[16] = {0};
-    uint8_t  seen_idx_ = 0;
+    // Paced fragment transmit ring
+    TxJob    tx_queue_[TX_QUEUE_DEPTH] = {};
+    uint8_t  tx_head_ = 0;
+    uint8_t  tx_count_ = 0;
+    uint8_t  tx_event_sent_ = 0;     // Fragments sent this BLE interval
+    uint32_t tx_event_tick_ = 0;     // Next-event tick that interval ends at
+    const WeightShard* repair_shard_ = nullptr;  // Last reply sent, held for NACKs
+    uint32_t repair_until_tick_ = 0;
 
-    // Fragment reassembly
-    uint8_t  fragment_buffer_[MAX_PENDING_FRAGMENTS][sizeof(WeightShard)];
-    uint8_t  pending_shards_[MAX_PENDING_FRAGMENTS] = {0xFF, 0xFF, 0xFF, 0xFF};
-    uint16_t pending_masks_[MAX_PENDING_FRAGMENTS] = {0};
+    // Delta base tracking
+    static constexpr uint8_t PEER_VERSION_SLOTS = 16;
+    PeerShardVersion peer_versions_[PEER_VERSION_SLOTS] = {};
+    uint8_t          peer_version_next_ = 0;
 
     // Callbacks
     ShardCallback on_shard_cb_ = nullptr;
     void*         on_shard_ctx_ = nullptr;
+    DeltaCallback on_delta_cb_ = nullptr;
+    void*         on_delta_ctx_ = nullptr;
+    ShardLookup   shard_lookup_cb_ = nullptr;
+    void*         shard_lookup_ctx_ = nullptr;
+    StoredShardLookup stored_lookup_cb_ = nullptr;
+    void*         stored_lookup_ctx_ = nullptr;
+    MergeCallback on_merge_cb_ = nullptr;
+    void*         on_merge_ctx_ = nullptr;
+    MergeFailedCallback on_merge_failed_cb_ = nullptr;
+    void*         on_merge_failed_ctx_ = nullptr;
+    ChangeLookup  change_lookup_cb_ = nullptr;
+    void*         change_lookup_ctx_ = nullptr;
+    LeaseCallback on_lease_cb_ = nullptr;
+    void*         on_lease_ctx_ = nullptr;
 };
 
 }  // namespace planetary
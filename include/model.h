@@ -0,0 +1,71 @@
+/**
+ * Model Layout - Maps the shard payload onto a compact MLP
+ *
+ * Every shard holds a full copy of the same small network; the mesh
+ * averages shards with the same ID. The layer descriptor table below
+ * is the single source of truth for where each layer's weights and
+ * biases live inside WeightShard::weights.
+ *
+ *   16 features -> 56 (ReLU) -> 48 (ReLU) -> 8 prediction heads
+ *
+ * 16x56 + 56 + 56x48 + 48 + 48x8 + 8 = 4080 of the 4084 payload bytes.
+ * Each layer requantizes its int32 accumulator back to int8 with a
+ * power-of-two scale (right shift); weights and biases are stored as
+ * int8, biases in output units.
+ */
+
+#ifndef MODEL_H
+#define MODEL_H
+
+#include "neuron_config.h"
+
+namespace planetary {
+
+struct LayerDesc {
+    uint16_t weight_offset;  // Row-major [out][in] weights in the payload
+    uint16_t bias_offset;    // One bias per output
+    uint8_t  in;
+    uint8_t  out;
+    uint8_t  shift;          // Requantization: y = (acc >> shift) + bias
+    bool     relu;           // Hidden layers only
+};
+
+namespace model {
+
+constexpr uint8_t INPUT_SIZE  = 16;   // sizeof(LocalFeatures)
+constexpr uint8_t HIDDEN1     = 56;
+constexpr uint8_t HIDDEN2     = 48;
+constexpr uint8_t OUTPUT_SIZE = 8;    // sizeof(PredictionTargets)
+constexpr uint8_t MAX_WIDTH   = 56;   // Widest layer (activation buffers)
+
+constexpr uint16_t L0_W = 0;
+constexpr uint16_t L0_B = L0_W + INPUT_SIZE * HIDDEN1;
+constexpr uint16_t L1_W = L0_B + HIDDEN1;
+constexpr uint16_t L1_B = L1_W + HIDDEN1 * HIDDEN2;
+constexpr uint16_t L2_W = L1_B + HIDDEN2;
+constexpr uint16_t L2_B = L2_W + HIDDEN2 * OUTPUT_SIZE;
+
+constexpr LayerDesc LAYERS[] = {
+    {L0_W, L0_B, INPUT_SIZE, HIDDEN1,     4, true},
+    {L1_W, L1_B, HIDDEN1,    HIDDEN2,     4, true},
+    {L2_W, L2_B, HIDDEN2,    OUTPUT_SIZE, 4, false},
+};
+constexpr uint8_t LAYER_COUNT = sizeof(LAYERS) / sizeof(LAYERS[0]);
+
+// Weights actually used by the model; the rest of the payload stays zero
+// and is neither trained nor gossiped.
+constexpr uint16_t PARAM_COUNT = L2_B + OUTPUT_SIZE;
+
+// Gradient scale: dW = (delta * x) >> GRAD_SHIFT
+constexpr uint8_t GRAD_SHIFT = 4;
+
+// Per-head loss weights (some predictions matter more), reserved heads 0
+constexpr int8_t HEAD_LOSS_WEIGHT[OUTPUT_SIZE] = {2, 1, 1, 2, 3, 1, 0, 0};
+
+static_assert(PARAM_COUNT <= WEIGHT_SHARD_SIZE - 12, "Model must fit in a shard payload");
+static_assert(L1_W % 4 == 0 && L2_W % 4 == 0, "Layer rows must stay word aligned");
+
+}  // namespace model
+}  // namespace planetary
+
+#endif  // MODEL_H
@@ -4,6 +4,12 @@
  *   - SRAM: 64KB total, ~40KB usable after BLE stack
  *   - Flash: 512KB, ~256KB for weights/state
  *   - CPU: 48MHz RISC, no FPU
+ *
+ * RAM-sized limits come from a NeuronProfile chosen at build time
+ * (-DPLANETARY_PROFILE_<SKU>, CMake PLANETARY_PROFILE). A build holds one
+ * profile, so every array and loop bound stays a compile-time constant;
+ * src/core/main.cpp checks the static objects against its SRAM budget,
+ * less the stack's reserve.
  */
 
 #ifndef NEURON_CONFIG_H
@@ -13,31 +19,130 @@
 
 namespace planetary {
 
+// Per-SKU sizing. Flash layout and wire formats are shared by every SKU.
+struct ProfileTLSR8258 {
+    static constexpr uint32_t SRAM_BUDGET    = 40 * 1024;  // 64KB, ~40KB after the BLE stack
+    static constexpr uint32_t STACK_RESERVE  = 3840;       // Of SRAM_BUDGET: train_sample_stack 3736
+    static constexpr uint8_t  SHARDS_IN_RAM  = 5;          // 20KB for weights
+    static constexpr uint8_t  NEIGHBORS      = 16;
+    static constexpr uint8_t  TX_QUEUE_DEPTH = 4;
+};
+
+struct ProfileNRF52840 {                                    // USE_ZEPHYR
+    static constexpr uint32_t SRAM_BUDGET    = 128 * 1024; // 256KB, half left to Zephyr + mesh
+    static constexpr uint32_t STACK_RESERVE  = 4 * 1024;   // Of SRAM_BUDGET: the main thread's stack
+    static constexpr uint8_t  SHARDS_IN_RAM  = 16;         // 64KB for weights
+    static constexpr uint8_t  NEIGHBORS      = 32;
+    static constexpr uint8_t  TX_QUEUE_DEPTH = 8;
+};
+
+#if defined(PLANETARY_PROFILE_NRF52840)
+using NeuronProfile = ProfileNRF52840;
+#else
+using NeuronProfile = ProfileTLSR8258;
+#endif
+
 // Memory budget (bytes)
-constexpr uint32_t SRAM_BUDGET         = 40 * 1024;  // 40KB for neuron
+constexpr uint32_t SRAM_BUDGET         = NeuronProfile::SRAM_BUDGET;  // For the neuron
+constexpr uint32_t STACK_RESERVE       = NeuronProfile::STACK_RESERVE;  // Not for static objects
 constexpr uint32_t WEIGHT_SHARD_SIZE   = 4 * 1024;   // 4KB per shard
 constexpr uint32_t GRADIENT_BUFFER_SIZE = 2 * 1024;  // 2KB gradient ring
 constexpr uint32_t MESH_MSG_MAX_SIZE   = 380;        // BLE mesh MTU limit
 
 // Model sharding
-constexpr uint8_t  MAX_SHARDS_IN_RAM   = 4;          // 16KB for weights
+constexpr uint8_t  MAX_SHARDS_IN_RAM   = NeuronProfile::SHARDS_IN_RAM;
 constexpr uint8_t  TOTAL_MODEL_SHARDS  = 64;         // 256KB full model
-constexpr uint8_t  SHARD_ROTATION_MS   = 100;        // Swap shards every 100ms
+constexpr uint32_t SHARD_ROTATION_MS   = 60000;      // Swap one resident shard per period
+constexpr uint16_t SHARD_LOAD_US       = 1500;       // Prefetch: 4KB flash read + CRC
+
+// Flash layout (see the memory map in BUILD_NOTES.md)
+constexpr uint32_t FLASH_SECTOR_SIZE   = 4096;
+constexpr uint32_t FLASH_CHECKPOINT_BASE = 0x38000;  // Training-state checkpoint, two slots
+constexpr uint8_t  FLASH_CHECKPOINT_SLOT_SECTORS = 2;
+constexpr uint32_t FLASH_STAGING_BASE  = 0x3C000;    // Fragment staging, one sector per slot
+constexpr uint32_t FLASH_STORE_BASE    = 0x40000;    // Shard log, up to mesh config
+constexpr uint8_t  FLASH_STORE_SECTORS = 48;         // 192KB, one record per sector
+constexpr uint8_t  FLASH_STORE_RESERVE = 2;          // Kept free so rewrites never stall
+constexpr uint32_t FLASH_ERASE_US      = 4500;       // Sector erase time (tune per flash part)
+constexpr uint16_t FLASH_PROGRAM_US    = 1200;       // 256-byte page program time
+
+static_assert(FLASH_CHECKPOINT_BASE + 2u * FLASH_CHECKPOINT_SLOT_SECTORS * FLASH_SECTOR_SIZE <=
+              FLASH_STAGING_BASE, "Checkpoint slots must end below fragment staging");
 
 // Federated learning
-constexpr float    LEARNING_RATE       = 0.001f;
+constexpr float    LEARNING_RATE       = 0.001f;     // Applied in Q24: 16777 / 2^24
+constexpr uint8_t  GRAD_BLOCK          = 32;         // Weights per gradient exponent (BFP)
+constexpr uint16_t SAMPLE_PERIOD_MS    = 100;        // Feature ring fill cadence
+constexpr uint8_t  SAMPLE_RING_SIZE    = 12;         // Newest (features, targets) pairs
+constexpr uint8_t  SAMPLE_RESERVOIR_SIZE = 4;        // Uniform replay of older samples
+constexpr uint8_t  BATCH_NEW_SAMPLES   = 8;          // Fresh samples that start a pass
+constexpr uint8_t  BATCH_REPLAY_SAMPLES = 2;         // Reservoir samples added per batch
+static_assert(BATCH_NEW_SAMPLES <= SAMPLE_RING_SIZE, "A batch's fresh samples must fit the ring");
+constexpr uint8_t  FEATURE_CHANGE_L1   = 4;          // Sample-to-sample distance that wakes training
+constexpr uint16_t DORMANT_AFTER_MS    = 60000;      // Unchanged this long: training goes dormant
+constexpr uint16_t DORMANT_SAMPLE_MS   = 30000;      // Dormant: one sample per period
 constexpr uint8_t  LOCAL_EPOCHS        = 1;          // Train before sync
 constexpr uint8_t  MIN_NEIGHBORS_SYNC  = 2;          // Min peers for FedAvg
-constexpr uint16_t GOSSIP_INTERVAL_MS  = 5000;       // Weight broadcast period
+constexpr uint16_t HEARTBEAT_INTERVAL_MS = 5000;     // Heartbeat and lease round
+constexpr uint16_t GOSSIP_INTERVAL_MIN_MS = 2500;    // Shard gossip after a disagreement
+constexpr uint8_t  GOSSIP_INTERVAL_DOUBLINGS = 6;    // Converged: backs off to 64x (160s)
+constexpr uint8_t  GOSSIP_REDUNDANCY   = 2;          // Agreeing copies heard that suppress ours
+constexpr uint16_t GOSSIP_DISAGREE_WEIGHTS = 192;    // Weights one merge or pass moves to reset
+constexpr uint8_t  GOSSIP_SCORE_PER_VERSION = 16;    // Shard score: weights' worth per update
+constexpr uint8_t  GOSSIP_SCORE_PER_LAG = 128;       // ... per neighbour that missed our copy
+constexpr uint8_t  CLUSTER_MIN_NEIGHBORS = 6;        // Flood below, cluster heads from here
+constexpr uint8_t  CLUSTER_LOAD_STEP   = 25;         // Load % per head-election bucket
+
+// Work leases: a hot or busy node hands one shard's training to an idle neighbour
+constexpr uint8_t  LEASE_OFFER_LOAD    = 50;         // Throttle % from which a shard is offered
+constexpr uint8_t  LEASE_CLAIM_LOAD    = 20;         // Claim only at or below this throttle
+constexpr uint32_t LEASE_MS            = 3 * SHARD_ROTATION_MS;  // Term of one lease
+constexpr uint32_t NEIGHBOR_EXPIRY_MS  = 6 * HEARTBEAT_INTERVAL_MS;  // Six missed heartbeats
+constexpr uint32_t REPLAY_EXPIRY_MS    = 60000;      // Forget a silent source's sequence
+
+// Mesh transmit pacing
+constexpr uint8_t  TX_QUEUE_DEPTH      = NeuronProfile::TX_QUEUE_DEPTH;  // Shards queued for transmit
+constexpr uint8_t  TX_FRAGS_PER_EVENT  = 2;          // Fragments per BLE event interval
+constexpr uint16_t TX_FRAGMENT_GAP_MS  = 20;         // Min fragment spacing (idle mesh)
+constexpr uint16_t TX_FRAGMENT_COST_US = 400;        // CPU per fragment (encrypt + queue)
+constexpr uint16_t FRAGMENT_NACK_MS    = 250;        // Reassembly idle before NACK
+constexpr uint8_t  FRAGMENT_MAX_NACKS  = 3;          // Unanswered NACKs before drop
 
 // Hardware safety
 constexpr uint8_t  MAX_CPU_DUTY_CYCLE  = 30;         // % for AI tasks
 constexpr uint8_t  TEMP_THROTTLE_C     = 55;         // Throttle above this
 constexpr uint8_t  TEMP_SHUTDOWN_C     = 70;         // Kill AI above this
+constexpr uint8_t  TEMP_SETPOINT_C     = 50;         // Thermal governor holds the die here
+static_assert(TEMP_SETPOINT_C < TEMP_THROTTLE_C, "Governor must settle before the throttle point");
+constexpr uint16_t THERMAL_SAMPLE_MS   = 1000;       // Temperature sensor read period
+constexpr uint8_t  THERMAL_LOOKAHEAD   = 8;          // Samples of slope the controller acts on
+constexpr uint8_t  THERMAL_KP          = 12;         // Throttle % per degree over setpoint
+constexpr uint8_t  THERMAL_KI_Q8       = 96;         // Integral gain, % per degree-sample (Q8)
+constexpr uint8_t  THERMAL_MAX_THROTTLE = 90;        // Controller ceiling; only shutdown kills
+constexpr uint16_t CPU_ACTIVE_MW       = 16;         // MCU while an AI task runs
+constexpr uint16_t FLASH_ACTIVE_MW     = 28;         // MCU plus flash erase/program current
 
 // Scheduler timeslots (microseconds)
-constexpr uint32_t BLE_GUARD_US        = 2000;       // Don't touch near BLE events
+constexpr uint32_t BLE_GUARD_US        = 2000;       // Initial guard before BLE events
+constexpr uint16_t BLE_GUARD_MIN_US    = 250;        // Adaptive guard floor
+constexpr uint16_t BLE_GUARD_MAX_US    = 4000;       // Adaptive guard ceiling
+constexpr uint16_t BLE_GUARD_MARGIN_US = 150;        // Added on top of the measured p99
+constexpr uint16_t BLE_SLIP_BUCKET_US  = 64;         // Slippage histogram resolution
 constexpr uint32_t AI_TIMESLOT_US      = 5000;       // Max AI burst
+constexpr uint16_t DUTY_WINDOW_MS      = 1000;       // Rolling duty-cycle window
+
+// Task periods and max bursts (HWScheduler EDF)
+constexpr uint16_t TRAIN_PERIOD_MS     = 20;         // Poll for a batch / resume a pass
+constexpr uint16_t TRAIN_BURST_US      = 3000;
+constexpr uint16_t SYNC_PERIOD_MS      = TX_FRAGMENT_GAP_MS;  // Keep fragment pacing
+constexpr uint16_t SYNC_BURST_US       = 2000;
+constexpr uint16_t RESIDENCY_PERIOD_MS = 100;
+constexpr uint16_t RESIDENCY_BURST_US  = 2 * FLASH_PROGRAM_US + 500;
+constexpr uint16_t STORE_GC_PERIOD_MS  = 200;
+constexpr uint16_t STORE_GC_BURST_US   = FLASH_ERASE_US + 300;
+constexpr uint32_t CHECKPOINT_INTERVAL_MS = 15 * 60000u;  // Two sector erases each
+constexpr uint16_t CHECKPOINT_PERIOD_MS = 200;
+constexpr uint16_t CHECKPOINT_BURST_US = FLASH_ERASE_US + 300;
 
 // Quantization
 using weight_t = int8_t;                             // INT8 quantized
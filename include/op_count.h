@@ -0,0 +1,66 @@
+/**
+ * Op Count - kernel work counters for the host cycle model
+ *
+ * The kernels, the CRC engine and the gradient accumulator report how
+ * many elements they process, split into word-wide work (four byte lanes
+ * per step) and byte-at-a-time work (the reference loops, tails and
+ * unaligned fallbacks). A host build turns the counts into tc32 cycle
+ * estimates (sim/tc32_model.h) without running on the core, so a change
+ * that adds a pass over the shard or knocks a buffer off word alignment
+ * shows up as a deterministic number.
+ *
+ * Only HOST_SIM builds set PLANETARY_OP_COUNT=1; on the bulb every
+ * PLANETARY_OPS() compiles to nothing.
+ */
+
+#ifndef OP_COUNT_H
+#define OP_COUNT_H
+
+#include <stdint.h>
+#include <string.h>
+
+#ifndef PLANETARY_OP_COUNT
+#define PLANETARY_OP_COUNT 0
+#endif
+
+namespace planetary {
+
+enum class KernelOp : uint8_t {
+    DOT    = 0,   // dot_s8
+    SCALE  = 1,   // scale_s8
+    AXPY   = 2,   // axpy_s8
+    SGD    = 3,   // sgd_s8 (draw, round, saturate, diff CRC)
+    BLEND  = 4,   // blend_s8
+    DIFF   = 5,   // mark_diff_s8
+    PACK   = 6,   // pack_s8
+    UNPACK = 7,   // unpack_s8
+    CRC    = 8,   // crc16::update
+    ACCUM  = 9,   // GradientAccum::accumulateAt
+    COUNT
+};
+
+constexpr uint8_t KERNEL_OPS = static_cast<uint8_t>(KernelOp::COUNT);
+
+struct OpCounts {
+    uint64_t words[KERNEL_OPS];   // Four-lane steps
+    uint64_t bytes[KERNEL_OPS];   // Single elements
+
+    void reset() { memset(this, 0, sizeof(*this)); }
+
+    void add(KernelOp op, uint64_t w, uint64_t b) {
+        words[static_cast<uint8_t>(op)] += w;
+        bytes[static_cast<uint8_t>(op)] += b;
+    }
+};
+
+#if PLANETARY_OP_COUNT
+inline OpCounts g_ops{};
+#define PLANETARY_OPS(op, words, bytes) \
+    ::planetary::g_ops.add(::planetary::KernelOp::op, (words), (bytes))
+#else
+#define PLANETARY_OPS(op, words, bytes) ((void)0)
+#endif
+
+}  // namespace planetary
+
+#endif  // OP_COUNT_H
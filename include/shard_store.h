@@ -0,0 +1,328 @@
+/**
+ * Shard Store - Log-structured, wear-leveled flash storage for shards
+ *
+ * One append-only log over the weight region. Each record is a 4-byte
+ * header plus the shard's wire bytes (header + model weights), exactly
+ * one flash sector:
+ *
+ *   [state][seq:24][ShardHeader][weights 0..MODEL_WEIGHTS)
+ *
+ * A write takes the next pre-erased sector after the log head, programs
+ * it (all at once, or a page per writeStep() for write-behind), then
+ * flips `state` to COMMITTED; the shard's previous record
+ * becomes garbage. The newest committed record per shard (highest seq)
+ * wins, recorded in a RAM index built by mount() at boot, so lookups are
+ * O(1). Because records never share a sector, garbage collection is just
+ * erasing unreferenced sectors - done one per run by maintenanceStep(),
+ * a scheduler task, so erases stay off the training path.
+ *
+ * Programming only clears bits, so the state byte moves
+ * ERASED (0xFF) -> WRITING -> COMMITTED without an erase, and a record
+ * cut short by power loss is never mistaken for a valid one.
+ */
+
+#ifndef SHARD_STORE_H
+#define SHARD_STORE_H
+
+#include "neuron_config.h"
+#include "weight_shard.h"
+#include <string.h>
+
+namespace planetary {
+
+struct StoreRecordHeader {
+    uint8_t state;           // STORE_WRITING, then STORE_COMMITTED
+    uint8_t seq[3];          // 24-bit write sequence, little-endian
+} __attribute__((packed));
+
+constexpr uint8_t STORE_ERASED    = 0xFF;
+constexpr uint8_t STORE_WRITING   = 0xA5;
+constexpr uint8_t STORE_COMMITTED = 0x25;  // WRITING with bit 7 cleared
+
+static_assert((STORE_COMMITTED & STORE_WRITING) == STORE_COMMITTED,
+              "Commit must only clear bits");
+static_assert(sizeof(StoreRecordHeader) + WeightShard::WIRE_SIZE <= FLASH_SECTOR_SIZE,
+              "A record must fit one sector");
+// 48 sectors x 100K erase cycles stays far below 2^24 writes: seq never wraps
+static_assert(static_cast<uint32_t>(FLASH_STORE_SECTORS) * 100000u < (1u << 24),
+              "Write sequence must not wrap within flash endurance");
+
+class ShardStore {
+public:
+    static constexpr uint8_t  NO_SECTOR = 0xFF;
+    static constexpr uint8_t  CAPACITY = FLASH_STORE_SECTORS - FLASH_STORE_RESERVE;
+    static constexpr uint32_t PAGE_SIZE = 256;
+
+    ShardStore() : head_(0), next_seq_(0), sync_erases_(0),
+                   write_src_(nullptr), write_sector_(0), write_off_(0) {
+        memset(index_, NO_SECTOR, sizeof(index_));
+        memset(state_, SECTOR_GARBAGE, sizeof(state_));
+        memset(seq_, 0, sizeof(seq_));
+    }
+
+    // Scan every sector's record header and rebuild the index. Unknown or
+    // half-written sectors, and records superseded by a newer one, become
+    // garbage for maintenanceStep() to erase.
+    void mount() {
+        memset(index_, NO_SECTOR, sizeof(index_));
+        uint32_t newest = 0;
+        bool any = false;
+
+        for (uint8_t s = 0; s < FLASH_STORE_SECTORS; s++) {
+            uint8_t prologue[sizeof(StoreRecordHeader) + sizeof(ShardHeader)];
+            flashRead(sectorAddr(s), sizeof(prologue), prologue);
+            const StoreRecordHeader* rec = reinterpret_cast<const StoreRecordHeader*>(prologue);
+            const ShardHeader* hdr = reinterpret_cast<const ShardHeader*>(prologue + sizeof(*rec));
+
+            state_[s] = SECTOR_GARBAGE;
+            if (isBlank(prologue, sizeof(prologue))) {
+                // Record headers are programmed first, so a blank prologue
+                // means nothing was written here since the last erase
+                state_[s] = SECTOR_ERASED;
+                continue;
+            }
+            if (rec->state != STORE_COMMITTED || hdr->shard_id >= TOTAL_MODEL_SHARDS) continue;
+
+            seq_[s] = decodeSeq(*rec);
+            if (!any || seq_[s] > newest) {
+                newest = seq_[s];
+                head_ = s;
+                any = true;
+            }
+
+            uint8_t& slot = index_[hdr->shard_id];
+            if (slot != NO_SECTOR && seq_[slot] > seq_[s]) continue;
+            if (slot != NO_SECTOR) state_[slot] = SECTOR_GARBAGE;
+            slot = s;
+            state_[s] = SECTOR_LIVE;
+        }
+        next_seq_ = any ? newest + 1 : 0;
+    }
+
+    // Append a new record for the shard, all at once. `shard` may be a
+    // view of flash (e.g. a staged reassembly), so pages are bounced
+    // through RAM. Blocking: a chunked write in progress is finished first,
+    // so this is for callers outside the scheduler's time slots.
+    bool save(const WeightShard& shard) {
+        while (writeStep()) {}
+        if (!beginWrite(shard)) return false;
+        while (writeStep()) {}
+        return true;
+    }
+
+    // Chunked save for write-behind: beginWrite() reserves a sector and
+    // each writeStep() programs one page, committing after the last.
+    // `shard` must not change until writing() turns false. Returns false
+    // while another write is in progress; retry once it has committed.
+    bool beginWrite(const WeightShard& shard) {
+        if (writing()) return false;
+
+        uint8_t id = shard.header.shard_id;
+        if (id >= TOTAL_MODEL_SHARDS) return false;
+
+        // Full: the least recently written shards make room (the mesh still
+        // holds them). More than one can be over after mount() revives
+        // evicted records that had not been erased yet.
+        while (index_[id] == NO_SECTOR && liveCount() >= CAPACITY) {
+            evictOldest();
+        }
+
+        uint8_t s = takeErased();
+        if (s == NO_SECTOR) return false;
+
+        state_[s] = SECTOR_WRITING;
+        write_src_ = reinterpret_cast<const uint8_t*>(&shard);
+        write_sector_ = s;
+        write_off_ = 0;
+        return true;
+    }
+
+    // Program the next page; returns true while more remain
+    bool writeStep() {
+        if (!write_src_) return false;
+
+        uint32_t addr = sectorAddr(write_sector_);
+        uint8_t page[PAGE_SIZE];
+        size_t n = 0;
+        size_t done = (write_off_ == 0) ? 0 : write_off_ - sizeof(StoreRecordHeader);
+        if (write_off_ == 0) {
+            StoreRecordHeader rec;
+            rec.state = STORE_WRITING;
+            encodeSeq(rec, next_seq_);
+            memcpy(page, &rec, sizeof(rec));
+            n = sizeof(rec);
+        }
+        size_t chunk = PAGE_SIZE - n;
+        if (chunk > WeightShard::WIRE_SIZE - done) chunk = WeightShard::WIRE_SIZE - done;
+        memcpy(page + n, write_src_ + done, chunk);
+        flashProgram(addr + write_off_, n + chunk, page);
+        write_off_ += PAGE_SIZE;
+
+        if (write_off_ < sizeof(StoreRecordHeader) + WeightShard::WIRE_SIZE) return true;
+
+        // Commit last: a record cut short stays WRITING and is ignored
+        uint8_t commit = STORE_COMMITTED;
+        flashProgram(addr, 1, &commit);
+
+        uint8_t id = reinterpret_cast<const WeightShard*>(write_src_)->header.shard_id;
+        if (index_[id] != NO_SECTOR) state_[index_[id]] = SECTOR_GARBAGE;
+        index_[id] = write_sector_;
+        state_[write_sector_] = SECTOR_LIVE;
+        seq_[write_sector_] = next_seq_++;
+        head_ = write_sector_;
+        write_src_ = nullptr;
+        return false;
+    }
+
+    bool writing() const { return write_src_ != nullptr; }
+
+    // O(1) lookup; false if the shard is absent or its record is corrupt
+    bool load(uint8_t shard_id, WeightShard& shard) {
+        if (shard_id >= TOTAL_MODEL_SHARDS || index_[shard_id] == NO_SECTOR) return false;
+        uint8_t s = index_[shard_id];
+
+        flashRead(sectorAddr(s) + sizeof(StoreRecordHeader), WeightShard::WIRE_SIZE,
+                  reinterpret_cast<uint8_t*>(&shard));
+        memset(reinterpret_cast<uint8_t*>(&shard) + WeightShard::WIRE_SIZE, 0,
+               sizeof(WeightShard) - WeightShard::WIRE_SIZE);
+
+        if (shard.header.shard_id != shard_id || !shard.verifyChecksum()) {
+            state_[s] = SECTOR_GARBAGE;
+            index_[shard_id] = NO_SECTOR;
+            return false;
+        }
+        return true;
+    }
+
+    bool contains(uint8_t shard_id) const {
+        return shard_id < TOTAL_MODEL_SHARDS && index_[shard_id] != NO_SECTOR;
+    }
+
+    // The live record in place, for serving a shard without loading it.
+    // Only WIRE_SIZE bytes are valid (don't verifyChecksum() a view), and
+    // GC may erase the sector once a newer record supersedes it: readers
+    // re-check shard_id and checksum before each use.
+    const WeightShard* view(uint8_t shard_id) const {
+        if (!contains(shard_id)) return nullptr;
+        return reinterpret_cast<const WeightShard*>(
+            flashView(sectorAddr(index_[shard_id]) + sizeof(StoreRecordHeader)));
+    }
+
+    // Garbage collection: erase one unreferenced sector if the window fits
+    // an erase. Returns true while garbage remains.
+    bool maintenanceStep(uint32_t budget_us) {
+        uint8_t s = nextSector(SECTOR_GARBAGE);
+        if (s == NO_SECTOR) return false;
+        if (budget_us < FLASH_ERASE_US) return true;
+
+        flashErase(sectorAddr(s));
+        state_[s] = SECTOR_ERASED;
+        return nextSector(SECTOR_GARBAGE) != NO_SECTOR;
+    }
+
+    static bool maintenanceStatic(uint32_t budget_us, void* ctx) {
+        return static_cast<ShardStore*>(ctx)->maintenanceStep(budget_us);
+    }
+
+    // Stats
+    uint8_t  liveCount() const { return countState(SECTOR_LIVE); }
+    uint8_t  erasedCount() const { return countState(SECTOR_ERASED); }
+    uint16_t getSyncErases() const { return sync_erases_; }  // Writes that had to erase inline
+
+private:
+    enum SectorState : uint8_t {
+        SECTOR_ERASED,
+        SECTOR_WRITING,   // Claimed by a chunked write
+        SECTOR_LIVE,
+        SECTOR_GARBAGE
+    };
+
+    // Platform-specific flash access (implemented in src/flash/persistence.cpp)
+    void flashRead(uint32_t addr, size_t len, uint8_t* buf) const;
+    const uint8_t* flashView(uint32_t addr) const;   // WIRE_SIZE bytes readable
+    void flashProgram(uint32_t addr, size_t len, const uint8_t* data);
+    void flashErase(uint32_t addr);
+
+    static uint32_t sectorAddr(uint8_t s) {
+        return FLASH_STORE_BASE + static_cast<uint32_t>(s) * FLASH_SECTOR_SIZE;
+    }
+
+    static bool isBlank(const uint8_t* p, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            if (p[i] != STORE_ERASED) return false;
+        }
+        return true;
+    }
+
+    static uint32_t decodeSeq(const StoreRecordHeader& rec) {
+        return rec.seq[0] | (static_cast<uint32_t>(rec.seq[1]) << 8) |
+               (static_cast<uint32_t>(rec.seq[2]) << 16);
+    }
+
+    static void encodeSeq(StoreRecordHeader& rec, uint32_t seq) {
+        rec.seq[0] = static_cast<uint8_t>(seq);
+        rec.seq[1] = static_cast<uint8_t>(seq >> 8);
+        rec.seq[2] = static_cast<uint8_t>(seq >> 16);
+    }
+
+    // First sector in `state` after the log head: walking forward from the
+    // head spreads writes (and so erases) evenly over the region
+    uint8_t nextSector(SectorState state) const {
+        for (uint8_t k = 1; k <= FLASH_STORE_SECTORS; k++) {
+            uint8_t s = (head_ + k) % FLASH_STORE_SECTORS;
+            if (state_[s] == state) return s;
+        }
+        return NO_SECTOR;
+    }
+
+    // Erased sector for the next record; erase inline only if GC fell behind
+    uint8_t takeErased() {
+        uint8_t s = nextSector(SECTOR_ERASED);
+        if (s != NO_SECTOR) return s;
+
+        s = nextSector(SECTOR_GARBAGE);
+        if (s == NO_SECTOR) return NO_SECTOR;
+        flashErase(sectorAddr(s));
+        state_[s] = SECTOR_ERASED;
+        sync_erases_++;
+        return s;
+    }
+
+    void evictOldest() {
+        uint8_t oldest = NO_SECTOR;
+        for (uint8_t s = 0; s < FLASH_STORE_SECTORS; s++) {
+            if (state_[s] == SECTOR_LIVE && (oldest == NO_SECTOR || seq_[s] < seq_[oldest])) {
+                oldest = s;
+            }
+        }
+        if (oldest == NO_SECTOR) return;
+        for (uint8_t id = 0; id < TOTAL_MODEL_SHARDS; id++) {
+            if (index_[id] == oldest) index_[id] = NO_SECTOR;
+        }
+        state_[oldest] = SECTOR_GARBAGE;
+    }
+
+    uint8_t countState(SectorState state) const {
+        uint8_t n = 0;
+        for (uint8_t s = 0; s < FLASH_STORE_SECTORS; s++) {
+            if (state_[s] == state) n++;
+        }
+        return n;
+    }
+
+    uint8_t  index_[TOTAL_MODEL_SHARDS];    // Shard ID -> sector, NO_SECTOR if absent
+    uint8_t  state_[FLASH_STORE_SECTORS];   // SectorState
+    uint32_t seq_[FLASH_STORE_SECTORS];     // Write sequence of live records
+    uint8_t  head_;                         // Sector of the newest record
+    uint32_t next_seq_;
+    uint16_t sync_erases_;
+
+    // Chunked write in progress
+    const uint8_t* write_src_;
+    uint8_t        write_sector_;
+    uint16_t       write_off_;
+};
+
+}  // namespace planetary
+
+#endif  // SHARD_STORE_H
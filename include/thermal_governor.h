@@ -0,0 +1,99 @@
+/**
+ * Thermal Governor - Filtered die temperature and PI throttle
+ *
+ * The scheduler feeds one temperature sensor reading per
+ * THERMAL_SAMPLE_MS. Readings are filtered in Q8 degrees:
+ *
+ *   temp  += (sample - temp) >> EMA_SHIFT
+ *   slope += ((temp - last temp) - slope) >> SLOPE_SHIFT
+ *
+ * and the controller acts on where the die will be THERMAL_LOOKAHEAD
+ * samples from now (temp + slope * lookahead), so throttling starts while
+ * the die is still heating rather than after it is hot. A PI loop on that
+ * prediction holds TEMP_SETPOINT_C below TEMP_THROTTLE_C: the output is
+ * the percentage of AI budget withheld, capped at THERMAL_MAX_THROTTLE.
+ * The integral is clamped to [0, THERMAL_MAX_THROTTLE] so it neither winds
+ * up while saturated nor goes negative while the die is cool.
+ *
+ * The hard limit stays outside the loop: a raw reading at TEMP_SHUTDOWN_C
+ * kills AI (throttle 100) until the filtered temperature is back below
+ * TEMP_THROTTLE_C.
+ */
+
+#ifndef THERMAL_GOVERNOR_H
+#define THERMAL_GOVERNOR_H
+
+#include "neuron_config.h"
+
+namespace planetary {
+
+class ThermalGovernor {
+public:
+    static constexpr uint8_t EMA_SHIFT = 3;     // ~8 sample time constant
+    static constexpr uint8_t SLOPE_SHIFT = 2;
+
+    ThermalGovernor() : temp_q8_(0), slope_q8_(0), integral_q8_(0), throttle_(0),
+                        primed_(false), shutdown_(false) {}
+
+    // One raw sensor reading; returns the new throttle percentage
+    uint8_t update(uint16_t raw) {
+        int32_t sample = rawToQ8(raw);
+        if (!primed_) {
+            temp_q8_ = sample;
+            primed_ = true;
+        }
+        int32_t last = temp_q8_;
+        temp_q8_ += (sample - temp_q8_) >> EMA_SHIFT;
+        slope_q8_ += ((temp_q8_ - last) - slope_q8_) >> SLOPE_SHIFT;
+
+        if (sample >= static_cast<int32_t>(TEMP_SHUTDOWN_C) << 8) {
+            shutdown_ = true;
+        } else if (shutdown_ && temp_q8_ < static_cast<int32_t>(TEMP_THROTTLE_C) << 8) {
+            shutdown_ = false;
+        }
+
+        int32_t error = predictedQ8() - (static_cast<int32_t>(TEMP_SETPOINT_C) << 8);
+        integral_q8_ += (error * THERMAL_KI_Q8) >> 8;
+        if (integral_q8_ < 0) integral_q8_ = 0;
+        if (integral_q8_ > MAX_Q8) integral_q8_ = MAX_Q8;
+
+        int32_t out = ((error * THERMAL_KP) >> 8) + (integral_q8_ >> 8);
+        if (out < 0) out = 0;
+        if (out > THERMAL_MAX_THROTTLE) out = THERMAL_MAX_THROTTLE;
+        throttle_ = shutdown_ ? 100 : static_cast<uint8_t>(out);
+        return throttle_;
+    }
+
+    bool primed() const { return primed_; }
+    bool shutdown() const { return shutdown_; }
+    uint8_t throttle() const { return throttle_; }
+
+    // Filtered temperature, whole degrees C (0 below freezing)
+    uint8_t temperatureC() const { return toC(temp_q8_); }
+    uint8_t predictedC() const { return toC(predictedQ8()); }
+    int16_t slopeQ8() const { return static_cast<int16_t>(slope_q8_); }  // deg/256 per sample
+
+private:
+    static constexpr int32_t MAX_Q8 = static_cast<int32_t>(THERMAL_MAX_THROTTLE) << 8;
+
+    // TLSR8258 internal sensor, rough calibration: (raw - 1100) / 4 degrees
+    static int32_t rawToQ8(uint16_t raw) { return (static_cast<int32_t>(raw) - 1100) * 64; }
+
+    static uint8_t toC(int32_t q8) {
+        int32_t c = (q8 + 128) >> 8;
+        return static_cast<uint8_t>(c < 0 ? 0 : (c > 255 ? 255 : c));
+    }
+
+    int32_t predictedQ8() const { return temp_q8_ + slope_q8_ * THERMAL_LOOKAHEAD; }
+
+    int32_t temp_q8_;
+    int32_t slope_q8_;
+    int32_t integral_q8_;    // Throttle %, Q8
+    uint8_t throttle_;
+    bool    primed_;
+    bool    shutdown_;
+};
+
+}  // namespace planetary
+
+#endif  // THERMAL_GOVERNOR_H
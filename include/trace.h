@@ -0,0 +1,132 @@
+/**
+ * Trace - Hot-path latency histograms and duty-cycle snapshot
+ *
+ * Scoped timers around the expensive operations (forward/backward
+ * passes, gradient apply, CRC, FedAvg, flash erase/program, fragment
+ * handling) feed one fixed log2 histogram per trace point. The
+ * scheduler publishes its rolling duty-cycle window here as well, so
+ * MeshGossip can answer a STATS request from a single place.
+ *
+ * Cost: two clock_time() reads and a CLZ per scope, on operations that
+ * take tens of microseconds or more. State is ~300 bytes of SRAM.
+ *
+ * Build with PLANETARY_TRACE=0 to compile every scope out.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "neuron_config.h"
+#include <string.h>
+
+#ifndef PLANETARY_TRACE
+#define PLANETARY_TRACE 1
+#endif
+
+namespace planetary {
+
+extern "C" uint32_t clock_time(void);  // Telink system tick (16 per us)
+
+enum class TracePoint : uint8_t {
+    FORWARD     = 0,   // One layer forward
+    BACKWARD    = 1,   // One layer backprop
+    APPLY       = 2,   // One APPLY_CHUNK of the SGD step
+    CRC         = 3,   // Full-shard checksum
+    FEDAVG      = 4,   // Whole-shard FedAvg merge
+    FLASH_ERASE = 5,   // Sector erase (store or staging)
+    FLASH_WRITE = 6,   // Page program (store or staging)
+    FRAGMENT    = 7,   // Receive-side fragment handling
+    COUNT
+};
+
+constexpr uint8_t TRACE_POINTS = static_cast<uint8_t>(TracePoint::COUNT);
+constexpr uint8_t TRACE_BUCKETS = 12;   // <2us, [2,4), ... [1024,2048), >=2048us
+constexpr uint8_t TRACE_MAX_TASKS = 8;  // HWScheduler::MAX_TASKS
+constexpr uint32_t TRACE_TICK_PER_US = 16;  // HWScheduler::TICK_PER_US
+
+struct TraceStat {
+    uint32_t count;
+    uint32_t total_us;
+    uint16_t max_us;
+    uint16_t hist[TRACE_BUCKETS];
+};
+
+class Trace {
+public:
+    Trace() { reset(); }
+
+    void reset() {
+        memset(stats_, 0, sizeof(stats_));
+    }
+
+    void record(TracePoint point, uint32_t us) {
+        TraceStat& s = stats_[static_cast<uint8_t>(point)];
+        s.count++;
+        s.total_us += us;
+        if (us > s.max_us) s.max_us = (us > 0xFFFF) ? 0xFFFF : static_cast<uint16_t>(us);
+
+        uint16_t& bin = s.hist[bucket(us)];
+        if (bin == 0xFFFF) {
+            // Halve the histogram rather than saturate: keeps the shape
+            for (uint8_t b = 0; b < TRACE_BUCKETS; b++) s.hist[b] >>= 1;
+        }
+        bin++;
+    }
+
+    const TraceStat& stat(TracePoint point) const {
+        return stats_[static_cast<uint8_t>(point)];
+    }
+
+    // Rolling duty cycle, published by HWScheduler once per DUTY_WINDOW_MS
+    void publishDuty(uint8_t ai_percent, const uint8_t* task_percent, uint8_t task_count) {
+        ai_duty_ = ai_percent;
+        task_count_ = (task_count > TRACE_MAX_TASKS) ? TRACE_MAX_TASKS : task_count;
+        memcpy(task_duty_, task_percent, task_count_);
+    }
+
+    uint8_t aiDuty() const { return ai_duty_; }
+    uint8_t taskCount() const { return task_count_; }
+    uint8_t taskDuty(uint8_t i) const { return task_duty_[i]; }
+
+    // floor(log2(us)), clamped to the last bucket
+    static uint8_t bucket(uint32_t us) {
+        if (us < 2) return 0;
+        uint8_t b = static_cast<uint8_t>(31 - __builtin_clz(us));
+        return (b >= TRACE_BUCKETS) ? TRACE_BUCKETS - 1 : b;
+    }
+
+private:
+    TraceStat stats_[TRACE_POINTS];
+    uint8_t   task_duty_[TRACE_MAX_TASKS] = {};
+    uint8_t   task_count_ = 0;
+    uint8_t   ai_duty_ = 0;
+};
+
+inline Trace g_trace;
+
+// Times the enclosing block into g_trace
+class TraceScope {
+public:
+    explicit TraceScope(TracePoint point) : point_(point), start_(clock_time()) {}
+    ~TraceScope() { g_trace.record(point_, (clock_time() - start_) / TRACE_TICK_PER_US); }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    TracePoint point_;
+    uint32_t   start_;
+};
+
+#if PLANETARY_TRACE
+#define PLANETARY_TRACE_CAT_(a, b) a##b
+#define PLANETARY_TRACE_CAT(a, b) PLANETARY_TRACE_CAT_(a, b)
+#define PLANETARY_TRACE_SCOPE(point) \
+    ::planetary::TraceScope PLANETARY_TRACE_CAT(trace_scope_, __LINE__)(point)
+#else
+#define PLANETARY_TRACE_SCOPE(point) ((void)0)
+#endif
+
+}  // namespace planetary
+
+#endif  // TRACE_H
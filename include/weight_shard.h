@@ -9,6 +9,10 @@
 #define WEIGHT_SHARD_H
 
 #include "neuron_config.h"
+#include "crc16.h"
+#include "kernels.h"
+#include "model.h"
+#include "trace.h"
 #include <string.h>
 
 namespace planetary {
@@ -18,16 +22,21 @@ struct ShardHeader {
     uint8_t  version;            // Increment on each update
     uint16_t checksum;           // CRC16 for integrity
     uint32_t global_epoch;       // Consensus training epoch
-    uint8_t  contributors;       // How many nodes averaged into this
-    uint8_t  reserved[3];
+    uint16_t contributors;       // FedAvg weight: merges folded in, saturating
+    uint8_t  reserved[2];
 } __attribute__((packed));
 
 static_assert(sizeof(ShardHeader) == 12, "Header must be 12 bytes");
 
-class WeightShard {
+constexpr uint16_t CONTRIBUTORS_MAX = 0xFFFF;
+
+// 4-byte aligned so the weight payload (offset 12) takes word-wide kernels
+class alignas(4) WeightShard {
 public:
     static constexpr size_t PAYLOAD_SIZE = WEIGHT_SHARD_SIZE - sizeof(ShardHeader);
     static constexpr size_t WEIGHT_COUNT = PAYLOAD_SIZE / sizeof(weight_t);
+    static constexpr size_t MODEL_WEIGHTS = model::PARAM_COUNT;  // Used prefix
+    static constexpr size_t WIRE_SIZE = sizeof(ShardHeader) + MODEL_WEIGHTS;
 
     ShardHeader header;
     weight_t    weights[WEIGHT_COUNT];
@@ -43,76 +52,173 @@ public:
         header.shard_id = shard_id;
         header.version = 1;
         header.contributors = 1;
-        // Xavier-ish init: small random in [-8, 8] for int8
-        for (size_t i = 0; i < WEIGHT_COUNT; i++) {
+        // Xavier-ish init: small random in [-8, 8] for int8.
+        // Weights past the model stay zero so a shard sent as WIRE_SIZE
+        // bytes and zero-filled on receipt keeps the same checksum.
+        for (size_t i = 0; i < MODEL_WEIGHTS; i++) {
             weights[i] = (i * 7 + shard_id) % 17 - 8;  // Deterministic pseudo-random
         }
         updateChecksum();
     }
 
-    // CRC16-CCITT
+    // CRC16-CCITT over the weight payload (engine selected in crc16.h)
+    uint16_t computeChecksum() const {
+        PLANETARY_TRACE_SCOPE(TracePoint::CRC);
+        return crc16::update(crc16::INIT, reinterpret_cast<const uint8_t*>(weights),
+                             sizeof(weights));
+    }
+
     void updateChecksum() {
-        uint16_t crc = 0xFFFF;
-        const uint8_t* data = reinterpret_cast<const uint8_t*>(weights);
-        for (size_t i = 0; i < sizeof(weights); i++) {
-            crc ^= data[i] << 8;
-            for (int j = 0; j < 8; j++) {
-                crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
-            }
-        }
-        header.checksum = crc;
+        header.checksum = computeChecksum();
     }
 
     bool verifyChecksum() const {
-        uint16_t crc = 0xFFFF;
-        const uint8_t* data = reinterpret_cast<const uint8_t*>(weights);
-        for (size_t i = 0; i < sizeof(weights); i++) {
-            crc ^= data[i] << 8;
-            for (int j = 0; j < 8; j++) {
-                crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
-            }
-        }
-        return crc == header.checksum;
+        return computeChecksum() == header.checksum;
+    }
+
+    // Fold an in-place edit of a weight range ending at `end` into
+    // header.checksum. `diff_crc` is the CRC (zero init) of old ^ new over
+    // the edited bytes only; untouched bytes before the range cost nothing
+    // and those after it are skipped in O(log n). Requires header.checksum
+    // to be valid for the old weights.
+    void patchChecksum(uint16_t diff_crc, size_t end) {
+        header.checksum ^= crc16::shiftZeros(diff_crc, sizeof(weights) - end);
     }
 
     // Federated Average: merge incoming shard weighted by contributor count
     void fedAvg(const WeightShard& incoming) {
+        PLANETARY_TRACE_SCOPE(TracePoint::FEDAVG);
         if (incoming.header.shard_id != header.shard_id) return;
         if (!incoming.verifyChecksum()) return;
 
-        uint8_t total = header.contributors + incoming.header.contributors;
+        uint16_t total = mergeCount(header.contributors, incoming.header.contributors);
         if (total == 0) return;
 
-        // Weighted average: (local * local_n + incoming * incoming_n) / total
-        for (size_t i = 0; i < WEIGHT_COUNT; i++) {
-            accum_t local_contrib = static_cast<accum_t>(weights[i]) * header.contributors;
-            accum_t remote_contrib = static_cast<accum_t>(incoming.weights[i]) * incoming.header.contributors;
-            weights[i] = static_cast<weight_t>((local_contrib + remote_contrib) / total);
-        }
+        kernels::blend_s8(weights, incoming.weights, MODEL_WEIGHTS,
+                          blendFactor(header.contributors, incoming.header.contributors));
+        finishMerge(incoming.header, total);
+        updateChecksum();
+    }
+
+    // Contributor count after a merge. Saturates instead of wrapping: at
+    // the ceiling both sides weigh the same, where a wrapped count would
+    // hand a long-merged shard to whichever newcomer it met next.
+    static uint16_t mergeCount(uint16_t local_n, uint16_t incoming_n) {
+        uint32_t total = static_cast<uint32_t>(local_n) + incoming_n;
+        return static_cast<uint16_t>(total > CONTRIBUTORS_MAX ? CONTRIBUTORS_MAX : total);
+    }
+
+    // Weighted average: (local * local_n + incoming * incoming_n) / total,
+    // as a single Q8 blend factor instead of a divide per weight. Taken
+    // from the unsaturated sum so the ratio stays exact up to the ceiling.
+    static uint16_t blendFactor(uint16_t local_n, uint16_t incoming_n) {
+        uint32_t total = static_cast<uint32_t>(local_n) + incoming_n;
+        if (total == 0) return 0;
+        return static_cast<uint16_t>((static_cast<uint32_t>(incoming_n) * 256 + total / 2) / total);
+    }
 
+    // Streaming FedAvg: blend weights [begin, begin + n) toward `src` as a
+    // shard arrives fragment by fragment. The checksum is patched with
+    // raw(old) ^ raw(new), so it stays valid between fragments.
+    void blendRange(const int8_t* src, size_t begin, size_t n, uint16_t alpha_q8) {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(weights + begin);
+        uint16_t before = crc16::update(0, bytes, n);
+        kernels::blend_s8(weights + begin, src, n, alpha_q8);
+        patchChecksum(before ^ crc16::update(0, bytes, n), begin + n);
+    }
+
+    // Versions wrap at 8 bits; a is older than b within half the range
+    static bool versionBefore(uint8_t a, uint8_t b) {
+        return static_cast<int8_t>(a - b) < 0;
+    }
+
+    // Version after merging a copy at `incoming`: past both, so a
+    // neighbour still reporting an older version than the copy we sent
+    // has not merged it
+    uint8_t mergedVersion(uint8_t incoming) const {
+        return static_cast<uint8_t>((versionBefore(header.version, incoming) ? incoming
+                                                                             : header.version) + 1);
+    }
+
+    // Header bookkeeping once every weight of `incoming` has been blended
+    void finishMerge(const ShardHeader& incoming, uint16_t total) {
         header.contributors = total;
+        header.version = mergedVersion(incoming.version);
+        header.global_epoch = (incoming.global_epoch > header.global_epoch)
+                              ? incoming.global_epoch : header.global_epoch;
+    }
+
+    // Apply local gradient update (SGD step, stochastically rounded)
+    void applyGradient(const int8_t* mantissa, const uint8_t* block_exp, size_t count, float lr,
+                       uint32_t& rng) {
+        // Fixed-point learning rate: Q24 keeps lr = 0.001 at 16777, not 0
+        int32_t scale_q24 = static_cast<int32_t>(lr * (1 << 24));
+
+        size_t apply_count = (count < MODEL_WEIGHTS) ? count : MODEL_WEIGHTS;
+        applyGradientRange(mantissa, block_exp, 0, apply_count, scale_q24, rng);
         header.version++;
-        header.global_epoch = (incoming.header.global_epoch > header.global_epoch)
-                              ? incoming.header.global_epoch : header.global_epoch;
-        updateChecksum();
     }
 
-    // Apply local gradient update (SGD step)
-    void applyGradient(const int8_t* gradients, size_t count, float lr) {
-        // Fixed-point learning rate: lr * 256 for int math
-        int16_t lr_fixed = static_cast<int16_t>(lr * 256);
+    // SGD step over weights[begin, end) only, for chunked updates spread
+    // across several idle windows. The gradient is block floating point:
+    // weight i moves by -(mantissa[i] << block_exp[i / GRAD_BLOCK]) *
+    // scale_q24 / 2^24, stochastically rounded with `rng`; begin must be a
+    // multiple of GRAD_BLOCK. The checksum is patched for the range, so the
+    // shard stays valid between chunks; the caller bumps version.
+    // `changed` (optional, one bit per weight of the shard) records which
+    // weights moved.
+    void applyGradientRange(const int8_t* mantissa, const uint8_t* block_exp, size_t begin,
+                            size_t end, int32_t scale_q24, uint32_t& rng,
+                            uint8_t* changed = nullptr) {
+        if (end > MODEL_WEIGHTS) end = MODEL_WEIGHTS;
+        if (begin >= end) return;
+
+        // Only the touched range is re-hashed; blocks are contiguous, so
+        // the checksum delta chains across them
+        uint16_t diff_crc = 0;
+        for (size_t b = begin; b < end; b += GRAD_BLOCK) {
+            size_t n = (end - b < GRAD_BLOCK) ? end - b : GRAD_BLOCK;
+            diff_crc = kernels::sgd_s8(weights + b, mantissa + b, n,
+                                       scale_q24 << block_exp[b / GRAD_BLOCK], rng, diff_crc,
+                                       changed ? changed + b / 8 : nullptr);
+        }
+        patchChecksum(diff_crc, end);
+    }
 
-        size_t apply_count = (count < WEIGHT_COUNT) ? count : WEIGHT_COUNT;
-        for (size_t i = 0; i < apply_count; i++) {
-            accum_t update = (static_cast<accum_t>(gradients[i]) * lr_fixed) >> 8;
-            accum_t new_val = static_cast<accum_t>(weights[i]) - update;
-            // Clamp to int8 range
-            if (new_val > 127) new_val = 127;
-            if (new_val < -128) new_val = -128;
-            weights[i] = static_cast<weight_t>(new_val);
+    // Sparse FedAvg: blend weights[first + k] toward the next entry of
+    // `values` by alpha_q8 (blendFactor(), or 256 to adopt) for every set
+    // bit k of `bitmap` (k < span). Unmarked weights were already merged at
+    // the sender's base version and are left alone. Returns false if the
+    // value list is shorter than the bitmap claims.
+    bool fedAvgDelta(size_t first, size_t span, const uint8_t* bitmap,
+                     const int8_t* values, size_t value_count,
+                     uint16_t alpha_q8, uint8_t* changed = nullptr) {
+        if (first >= MODEL_WEIGHTS) return false;
+        if (span > MODEL_WEIGHTS - first) span = MODEL_WEIGHTS - first;
+
+        // Validate before touching anything so the checksum never goes stale
+        size_t marked = 0;
+        for (size_t k = 0; k < span; k++) {
+            marked += (bitmap[k >> 3] >> (k & 7)) & 1;
         }
-        header.version++;
-        updateChecksum();
+        if (marked > value_count) return false;
+
+        size_t v = 0;
+        uint16_t diff_crc = 0;
+        for (size_t k = 0; k < span; k++) {
+            uint8_t diff = 0;
+            if (bitmap[k >> 3] & (1u << (k & 7))) {
+                weight_t old_w = weights[first + k];
+                kernels::ref::blend_s8(&weights[first + k], &values[v++], 1, alpha_q8);
+                diff = static_cast<uint8_t>(old_w ^ weights[first + k]);
+                if (changed && diff) {
+                    changed[(first + k) >> 3] |= 1u << ((first + k) & 7);
+                }
+            }
+            diff_crc = crc16::updateByte(diff_crc, diff);
+        }
+        patchChecksum(diff_crc, first + span);
+        return true;
     }
 };
 
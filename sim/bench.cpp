@@ -0,0 +1,418 @@
+/**
+ * Planetary Neuron Benchmarks - host build (HOST_SIM)
+ *
+ *   planetary-bench                  print every metric
+ *   planetary-bench --check FILE     fail if a metric regressed past FILE
+ *   planetary-bench --write FILE     record the current numbers as golden
+ *
+ * Metrics (lower is better for all of them):
+ *   host_ns_per_sample      native cost of one training sample, scheduler
+ *                           included (informational: depends on the host)
+ *   host_cycles_per_sample  same in TSC cycles, on x86 hosts
+ *   bytes_per_epoch         gossip bytes on air (relays included) per local
+ *                           epoch, 4 nodes (flooding)
+ *   bytes_per_epoch_n16     same with 16 nodes (cluster-head aggregation)
+ *   idle_bytes_per_s        gossip bytes on air per second, 4 nodes, over
+ *                           the 20 minutes after 10 with no scene changes
+ *   convergence_s_nN        seconds for FedAvg to shrink the spread of
+ *                           perturbed shards to 10%, N = 2, 4, 8, 16
+ *   flash_erases_per_hour   sector erases per node per hour, 4 nodes
+ *   <path>_cycles           tc32 cycles for one call of a hot path, from
+ *                           the op counts and sim/tc32_model.h
+ *   <path>_stack            host stack the call used (sim/probe.h)
+ *   sram_static_bytes       the firmware's static objects at host sizes
+ *
+ * Hot paths:
+ *   fedavg                  WeightShard::fedAvg, one whole shard
+ *   apply_gradient          WeightShard::applyGradient, one whole shard
+ *   apply_chunk             one APPLY_CHUNK of it, as training applies it
+ *   verify_checksum         WeightShard::verifyChecksum
+ *   train_sample            training, per sample: one node for 120s with
+ *                           every task included, kernel work only
+ *   broadcast_shard         MeshGossip::broadcastShard and the pumpTx
+ *                           calls that send every fragment
+ *   handle_fragment         worst fragment of that shard at a receiver
+ *                           that holds it (the blend and the final merge)
+ *   store_write_step        worst ShardStore::writeStep (one page)
+ *   store_save              ShardStore::save, one whole record
+ *
+ * Work that has to fit one scheduler slice (fedavg, apply_chunk,
+ * verify_checksum, handle_fragment, store_write_step) also fails outright
+ * past AI_TIMESLOT_US, whatever the golden file says.
+ *
+ * Everything except the host_* and *_stack numbers comes from the
+ * deterministic simulator and the op counts, and is reproducible bit for
+ * bit. Stack depths depend on the host compiler and get a wider tolerance.
+ *
+ * Golden file: one "name value tolerance_percent" per line, '#' comments.
+ * A metric fails when measured > value * (1 + tolerance / 100).
+ */
+
+#include "mesh_sim.h"
+#include "probe.h"
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAVE_TSC 1
+#else
+#define BENCH_HAVE_TSC 0
+#endif
+
+using namespace planetary;
+using namespace planetary::sim;
+
+namespace {
+
+struct Metric {
+    std::string name;
+    double value;
+    bool host_dependent;   // Never gated
+    int tolerance_pct = 5; // Written to the golden file
+    double limit = 0;      // Fails above this regardless of golden (0: none)
+};
+
+constexpr uint64_t SECOND_US = 1000000;
+constexpr int STACK_TOLERANCE_PCT = 25;
+
+// One probe for the whole run: its stack is 256KB
+Probe& probe() {
+    static Probe p;
+    return p;
+}
+
+void addHotPath(std::vector<Metric>& out, const char* path, const ProbeResult& r, bool one_slice) {
+    std::string name(path);
+    out.push_back({name + "_cycles", static_cast<double>(r.cycles()), false, 5,
+                   one_slice ? static_cast<double>(tc32::SLOT_CYCLES) : 0});
+    out.push_back({name + "_stack", static_cast<double>(r.stack_bytes), false,
+                   STACK_TOLERANCE_PCT});
+}
+
+// Cost of a training sample: one node, no mesh traffic
+void benchSampleCost(std::vector<Metric>& out) {
+    SimConfig cfg;
+    cfg.nodes = 1;
+    MeshSim sim(cfg);
+
+    g_trace.reset();
+    auto t0 = std::chrono::steady_clock::now();
+#if BENCH_HAVE_TSC
+    uint64_t c0 = __rdtsc();
+#endif
+    ProbeResult r = probe().run(sim.node(0).hal, [&] { sim.runUntil(120 * SECOND_US); });
+#if BENCH_HAVE_TSC
+    uint64_t cycles = __rdtsc() - c0;
+#endif
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - t0).count();
+
+    uint32_t samples = g_trace.stat(TracePoint::FORWARD).count / model::LAYER_COUNT;
+    if (samples == 0) samples = 1;
+    out.push_back({"host_ns_per_sample", static_cast<double>(ns) / samples, true});
+#if BENCH_HAVE_TSC
+    out.push_back({"host_cycles_per_sample", static_cast<double>(cycles) / samples, true});
+#endif
+    out.push_back({"train_sample_cycles",
+                   static_cast<double>(tc32::kernelCycles(r.ops)) / samples, false});
+    out.push_back({"train_sample_stack", static_cast<double>(r.stack_bytes), false,
+                   STACK_TOLERANCE_PCT});
+}
+
+// Move every model weight by up to +/-amplitude, so merges have real
+// work to do
+void perturbShard(WeightShard& s, uint32_t seed, uint8_t amplitude) {
+    uint32_t rng = seed;
+    for (size_t i = 0; i < WeightShard::MODEL_WEIGHTS; i++) {
+        int32_t d = static_cast<int32_t>(kernels::xorshift32(rng) % (2u * amplitude + 1)) - amplitude;
+        s.weights[i] = kernels::sat8(s.weights[i] + d);
+    }
+    s.header.version++;
+    s.updateChecksum();
+}
+
+void benchShardPaths(std::vector<Metric>& out) {
+    static host::HalNode hal;    // Clock for the trace scopes; the flash image is large
+    host::NodeSelect select(hal);  // init() below traces too, before any probe runs
+    alignas(4) static WeightShard local, incoming;
+    local.init(7);
+    incoming.init(7);
+    perturbShard(incoming, 0x1234u, 4);
+
+    addHotPath(out, "fedavg", probe().run(hal, [&] { local.fedAvg(incoming); }), true);
+
+    alignas(4) static int8_t mantissa[WeightShard::WEIGHT_COUNT];
+    static uint8_t block_exp[GradientAccum::BLOCKS];
+    uint32_t rng = 0x9E3779B9u;
+    for (size_t i = 0; i < WeightShard::WEIGHT_COUNT; i++) {
+        mantissa[i] = static_cast<int8_t>(static_cast<int32_t>(kernels::xorshift32(rng) % 33) - 16);
+    }
+    for (size_t b = 0; b < GradientAccum::BLOCKS; b++) block_exp[b] = static_cast<uint8_t>(b % 3);
+    int32_t scale_q24 = static_cast<int32_t>(LEARNING_RATE * (1 << 24));
+
+    addHotPath(out, "apply_gradient", probe().run(hal, [&] {
+        local.applyGradient(mantissa, block_exp, WeightShard::MODEL_WEIGHTS, LEARNING_RATE, rng);
+    }), false);
+    addHotPath(out, "apply_chunk", probe().run(hal, [&] {
+        local.applyGradientRange(mantissa, block_exp, 0, LearningEngine::APPLY_CHUNK, scale_q24, rng);
+    }), true);
+    addHotPath(out, "verify_checksum", probe().run(hal, [&] {
+        if (!local.verifyChecksum()) abort();
+    }), true);
+}
+
+// One shard from a sender to a receiver that holds it, then into the
+// receiver's shard store
+void benchGossipPaths(std::vector<Metric>& out) {
+    struct Sent {
+        uint8_t opcode;
+        std::vector<uint8_t> params;
+    };
+    std::vector<Sent> sent;
+
+    std::unique_ptr<SimNode> tx(new SimNode(0x0100));
+    std::unique_ptr<SimNode> rx(new SimNode(0x0101));
+    tx->hal.on_send = [](host::HalNode&, uint8_t opcode, uint8_t, const uint8_t* params,
+                         size_t len, uint16_t, void* ctx) {
+        static_cast<std::vector<Sent>*>(ctx)->push_back({opcode, {params, params + len}});
+    };
+    tx->hal.send_ctx = &sent;
+
+    alignas(4) static WeightShard copy;
+    copy = rx->engine.getShard(0);
+    perturbShard(copy, 0x5678u, 4);
+
+    // One pump per BLE interval, as the scheduler would run it
+    constexpr uint32_t INTERVAL_US = 30000;
+    auto pump = [&] {
+        tx->hal.advanceUs(INTERVAL_US);
+        tx->hal.next_ble_tick = tx->hal.ticks + INTERVAL_US * host::TICK_PER_US;
+        return probe().run(tx->hal, [&] { tx->mesh.pumpTx(AI_TIMESLOT_US); });
+    };
+
+    ProbeResult send = probe().run(tx->hal, [&] { tx->mesh.broadcastShard(copy); });
+    while (tx->mesh.isTransmitting(copy)) send.add(pump());
+    addHotPath(out, "broadcast_shard", send, false);
+
+    uint8_t version = rx->engine.getShard(0).header.version;
+    ProbeResult worst{};
+    for (const Sent& m : sent) {
+        if (m.opcode != static_cast<uint8_t>(GossipOpcode::SHARD_FRAGMENT)) continue;
+        ProbeResult r = probe().run(rx->hal, [&] {
+            rx->mesh.onReceive(m.opcode, m.params.data(), m.params.size(), tx->addr, -60);
+        });
+        worst.keepWorst(r);
+    }
+    if (rx->engine.getShard(0).header.version == version) {
+        fprintf(stderr, "bench: the receiver never merged the shard\n");
+        abort();
+    }
+    addHotPath(out, "handle_fragment", worst, true);
+
+    const WeightShard& merged = rx->engine.getShard(0);
+    ProbeResult save = probe().run(rx->hal, [&] { rx->store.beginWrite(merged); });
+    ProbeResult step{};
+    bool more = true;
+    while (more) {
+        ProbeResult r = probe().run(rx->hal, [&] { more = rx->store.writeStep(); });
+        step.keepWorst(r);
+        save.add(r);
+    }
+    addHotPath(out, "store_write_step", step, true);
+    addHotPath(out, "store_save", save, false);
+}
+
+// The static objects src/core/main.cpp checks against SRAM_BUDGET -
+// STACK_RESERVE (meshSend()'s parameter buffer and g_trace included), as
+// laid out on this host
+void benchFootprint(std::vector<Metric>& out) {
+    size_t bytes = sizeof(HWScheduler) + sizeof(MeshGossip) + sizeof(LightController) +
+                   sizeof(ShardStore) + sizeof(CheckpointStore) + sizeof(LearningEngine) +
+                   (MESH_MSG_MAX_SIZE - VENDOR_OPCODE_SIZE) + sizeof(g_trace);
+    out.push_back({"sram_static_bytes", static_cast<double>(bytes), false});
+}
+
+void benchBytesPerEpoch(std::vector<Metric>& out, uint8_t nodes, const char* name) {
+    SimConfig cfg;
+    cfg.nodes = nodes;
+    MeshSim sim(cfg);
+    sim.runUntil(600 * SECOND_US);
+
+    uint32_t epochs = sim.totalEpochs();
+    out.push_back({name, epochs ? static_cast<double>(sim.bytesOnAir()) / epochs : 0, false});
+}
+
+// Steady-state airtime: nobody touches the lights after the first scene
+void benchIdleAirtime(std::vector<Metric>& out) {
+    constexpr uint64_t WARMUP_S = 600;
+    constexpr uint64_t WINDOW_S = 1200;
+
+    SimConfig cfg;
+    cfg.nodes = 4;
+    cfg.light_change_s = 0xFFFF;
+    MeshSim sim(cfg);
+    sim.runUntil(WARMUP_S * SECOND_US);
+    uint64_t before = sim.bytesOnAir();
+    sim.runUntil((WARMUP_S + WINDOW_S) * SECOND_US);
+
+    out.push_back({"idle_bytes_per_s",
+                   static_cast<double>(sim.bytesOnAir() - before) / WINDOW_S, false});
+}
+
+void benchConvergence(std::vector<Metric>& out, uint8_t nodes) {
+    constexpr uint64_t LIMIT_S = 1800;
+
+    SimConfig cfg;
+    cfg.nodes = nodes;
+    cfg.perturb = 16;
+    MeshSim sim(cfg);
+
+    double initial = sim.divergence();
+    uint64_t t = 0;
+    while (t < LIMIT_S && sim.divergence() > initial * 0.1) {
+        t++;
+        sim.runUntil(t * SECOND_US);
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "convergence_s_n%u", nodes);
+    out.push_back({name, static_cast<double>(t), false});
+}
+
+void benchFlashWear(std::vector<Metric>& out) {
+    SimConfig cfg;
+    cfg.nodes = 4;
+    MeshSim sim(cfg);
+    sim.runUntil(3600 * SECOND_US);
+
+    out.push_back({"flash_erases_per_hour",
+                   static_cast<double>(sim.totalFlashErases()) / cfg.nodes, false});
+}
+
+struct Golden {
+    std::string name;
+    double value;
+    double tolerance_pct;
+};
+
+bool readGolden(const char* path, std::vector<Golden>& golden) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return false;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#' || line[0] == '\n') continue;
+        char name[64];
+        double value, tol;
+        if (sscanf(line, "%63s %lf %lf", name, &value, &tol) == 3) {
+            golden.push_back({name, value, tol});
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+bool writeGolden(const char* path, const std::vector<Metric>& metrics) {
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "cannot write %s\n", path);
+        return false;
+    }
+    fprintf(f, "# Golden numbers for planetary-bench --check (lower is better)\n");
+    fprintf(f, "# metric                 value        tolerance_percent\n");
+    for (const Metric& m : metrics) {
+        if (m.host_dependent) continue;
+        fprintf(f, "%-24s %-12.1f %d\n", m.name.c_str(), m.value, m.tolerance_pct);
+    }
+    fclose(f);
+    return true;
+}
+
+int check(const std::vector<Golden>& golden, const std::vector<Metric>& metrics) {
+    int failures = 0;
+    for (const Golden& g : golden) {
+        const Metric* m = nullptr;
+        for (const Metric& candidate : metrics) {
+            if (candidate.name == g.name) m = &candidate;
+        }
+        if (!m) {
+            printf("MISSING %s\n", g.name.c_str());
+            failures++;
+            continue;
+        }
+        double limit = g.value * (1 + g.tolerance_pct / 100);
+        bool ok = m->value <= limit;
+        printf("%-8s %-24s %12.1f  (golden %.1f, limit %.1f)\n", ok ? "ok" : "REGRESSED",
+               g.name.c_str(), m->value, g.value, limit);
+        if (!ok) failures++;
+    }
+    return failures;
+}
+
+// Hard limits hold with or without a golden file
+int checkLimits(const std::vector<Metric>& metrics) {
+    int failures = 0;
+    for (const Metric& m : metrics) {
+        if (m.limit <= 0 || m.value <= m.limit) continue;
+        printf("%-8s %-24s %12.1f  (limit %.1f)\n", "OVER", m.name.c_str(), m.value, m.limit);
+        failures++;
+    }
+    return failures;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const char* check_path = nullptr;
+    const char* write_path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--check") && i + 1 < argc) {
+            check_path = argv[++i];
+        } else if (!strcmp(argv[i], "--write") && i + 1 < argc) {
+            write_path = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--check FILE | --write FILE]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    std::vector<Metric> metrics;
+    benchSampleCost(metrics);
+    benchBytesPerEpoch(metrics, 4, "bytes_per_epoch");
+    benchBytesPerEpoch(metrics, 16, "bytes_per_epoch_n16");
+    benchIdleAirtime(metrics);
+    for (uint8_t n : {2, 4, 8, 16}) benchConvergence(metrics, n);
+    benchFlashWear(metrics);
+    benchShardPaths(metrics);
+    benchGossipPaths(metrics);
+    benchFootprint(metrics);
+
+    for (const Metric& m : metrics) {
+        printf("%-24s %12.1f%s\n", m.name.c_str(), m.value, m.host_dependent ? "  (host)" : "");
+    }
+
+    printf("\n");
+    int over = checkLimits(metrics);
+    if (over) {
+        printf("%d metric(s) over their limit\n", over);
+        return 1;
+    }
+
+    if (write_path) return writeGolden(write_path, metrics) ? 0 : 1;
+    if (check_path) {
+        std::vector<Golden> golden;
+        if (!readGolden(check_path, golden)) return 1;
+        int failures = check(golden, metrics);
+        if (failures) {
+            printf("%d metric(s) regressed\n", failures);
+            return 1;
+        }
+    }
+    return 0;
+}
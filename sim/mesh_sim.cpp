@@ -0,0 +1,204 @@
+/**
+ * Mesh Simulator - see mesh_sim.h
+ */
+
+#include "mesh_sim.h"
+
+namespace planetary {
+namespace sim {
+
+SimNode::SimNode(uint16_t address)
+    : select(hal), engine(scheduler, mesh, light, store, checkpoints), addr(address),
+      next_event_us(0), next_light_us(0), next_scene_us(0) {
+    // Same bring-up as planetary_init() on the bulb
+    mesh.init(address);
+    store.mount();
+    scheduler.registerTask(ShardStore::maintenanceStatic, &store, TaskPriority::LOW,
+                           STORE_GC_PERIOD_MS, STORE_GC_BURST_US, FLASH_ACTIVE_MW);
+    checkpoints.mount();
+    engine.restore();
+    engine.start();
+    scheduler.registerTask(MeshGossip::stagingMaintenanceStatic, &mesh, TaskPriority::LOW,
+                           STORE_GC_PERIOD_MS, STORE_GC_BURST_US, FLASH_ACTIVE_MW);
+}
+
+MeshSim::MeshSim(const SimConfig& config)
+    : config_(config), rng_(config.seed ? config.seed : 1), order_(0),
+      bytes_on_air_(0), messages_(0), lost_(0) {
+    for (uint8_t i = 0; i < config_.nodes; i++) {
+        nodes_.emplace_back(new SimNode(static_cast<uint16_t>(0x0100 + i)));
+        SimNode& n = *nodes_.back();
+        n.hal.on_send = onSendStatic;
+        n.hal.send_ctx = this;
+
+        // Bulbs power up at different moments: spread BLE phase and clocks
+        uint32_t phase_us = random() % (config_.ble_interval_ms * 1000u);
+        n.hal.advanceUs(phase_us);
+        n.next_event_us = n.hal.nowUs() + config_.ble_interval_ms * 1000u;
+        n.next_light_us = n.hal.nowUs();
+        n.next_scene_us = n.hal.nowUs();
+
+        if (config_.perturb) perturb(n, config_.perturb);
+    }
+}
+
+void MeshSim::runUntil(uint64_t t_us) {
+    for (;;) {
+        SimNode* next = nullptr;
+        for (auto& n : nodes_) {
+            if (!next || n->hal.nowUs() < next->hal.nowUs()) next = n.get();
+        }
+        if (!next || next->hal.nowUs() >= t_us) return;
+        step(*next);
+    }
+}
+
+uint64_t MeshSim::now() const {
+    uint64_t t = UINT64_MAX;
+    for (const auto& n : nodes_) {
+        if (n->hal.nowUs() < t) t = n->hal.nowUs();
+    }
+    return nodes_.empty() ? 0 : t;
+}
+
+uint32_t MeshSim::totalEpochs() const {
+    uint32_t total = 0;
+    for (const auto& n : nodes_) total += n->engine.getLocalEpoch();
+    return total;
+}
+
+uint32_t MeshSim::totalFlashErases() const {
+    uint32_t total = 0;
+    for (const auto& n : nodes_) total += n->hal.stats.flash_erases;
+    return total;
+}
+
+double MeshSim::divergence() const {
+    double sum = 0;
+    uint64_t count = 0;
+    const WeightShard* copies[256];
+
+    for (uint16_t id = 0; id < TOTAL_MODEL_SHARDS; id++) {
+        uint8_t n_copies = 0;
+        for (const auto& n : nodes_) {
+            for (uint8_t slot = 0; slot < MAX_SHARDS_IN_RAM; slot++) {
+                const WeightShard& s = n->engine.getShard(slot);
+                if (s.header.shard_id == id) copies[n_copies++] = &s;
+            }
+        }
+        if (n_copies < 2) continue;
+
+        for (size_t w = 0; w < WeightShard::MODEL_WEIGHTS; w++) {
+            double mean = 0;
+            for (uint8_t c = 0; c < n_copies; c++) mean += copies[c]->weights[w];
+            mean /= n_copies;
+            for (uint8_t c = 0; c < n_copies; c++) {
+                double d = copies[c]->weights[w] - mean;
+                sum += d < 0 ? -d : d;
+            }
+            count += n_copies;
+        }
+    }
+    return count ? sum / count : 0;
+}
+
+void MeshSim::onSendStatic(host::HalNode& from, uint8_t opcode, uint8_t ttl,
+                           const uint8_t* params, size_t len, uint16_t dst, void* ctx) {
+    static_cast<MeshSim*>(ctx)->onSend(from, opcode, ttl, params, len, dst);
+}
+
+void MeshSim::onSend(host::HalNode& from, uint8_t opcode, uint8_t ttl, const uint8_t* params,
+                     size_t len, uint16_t dst) {
+    size_t relays = ttl > 1 ? nodes_.size() - 1 : 0;
+    bytes_on_air_ += (VENDOR_OPCODE_SIZE + len) * (1 + relays);
+    messages_++;
+
+    uint16_t src = 0;
+    for (auto& n : nodes_) {
+        if (&n->hal == &from) src = n->addr;
+    }
+
+    for (auto& n : nodes_) {
+        if (&n->hal == &from) continue;
+        if (dst != MESH_ADDR_ALL && dst != n->addr) continue;
+        if (random() % 1000 < config_.loss_permille) {
+            lost_++;
+            continue;
+        }
+        Delivery d;
+        d.arrival_us = from.nowUs() + config_.latency_ms * 1000u +
+                       random() % (config_.jitter_ms * 1000u + 1);
+        d.order = order_++;
+        d.src = src;
+        d.opcode = opcode;
+        d.rssi = static_cast<int8_t>(-45 - static_cast<int>(random() % 40));
+        d.data.assign(params, params + len);
+        n->inbox.push(std::move(d));
+    }
+}
+
+void MeshSim::step(SimNode& n) {
+    host::setCurrentNode(&n.hal);
+
+    // 1. Mesh receive callbacks for everything that has arrived
+    while (!n.inbox.empty() && n.inbox.top().arrival_us <= n.hal.nowUs()) {
+        Delivery d = n.inbox.top();
+        n.inbox.pop();
+        n.mesh.onReceive(d.opcode, d.data.data(), d.data.size(), d.src, d.rssi);
+    }
+
+    // Occasional user scene changes give each node its own training data
+    if (n.hal.nowUs() >= n.next_scene_us) {
+        uint8_t brightness = static_cast<uint8_t>(random() % 256);
+        uint8_t temp = static_cast<uint8_t>(random() % 101);
+        n.light.setTarget(brightness, temp, 1000);
+        uint64_t mean_us = static_cast<uint64_t>(config_.light_change_s) * 1000000;
+        n.next_scene_us = n.hal.nowUs() + mean_us / 2 + random() % (mean_us + 1);
+    }
+
+    // 2. Idle window: the stack calls blt_idle_loop_cb until the next event
+    n.hal.next_ble_tick = n.next_event_us * host::TICK_PER_US;
+    while (n.hal.nowUs() < n.next_event_us) {
+        uint64_t before = n.hal.ticks;
+        n.scheduler.runSlice();
+        if (n.hal.ticks - before < HWScheduler::MIN_BURST_US * host::TICK_PER_US) break;
+    }
+
+    // 3. Radio event, then the 50Hz light loop catches up
+    uint64_t resume = (n.hal.nowUs() > n.next_event_us ? n.hal.nowUs() : n.next_event_us) +
+                      config_.ble_event_us;
+    n.hal.ticks = resume * host::TICK_PER_US;
+    n.next_event_us += config_.ble_interval_ms * 1000u;
+    while (n.next_event_us <= n.hal.nowUs()) n.next_event_us += config_.ble_interval_ms * 1000u;
+
+    while (n.next_light_us <= n.hal.nowUs()) {
+        n.light.update();
+        n.next_light_us += 20000;
+    }
+}
+
+// As if each node had trained on its own data before the run: add noise
+// to every resident shard and reload it through the shard store
+void MeshSim::perturb(SimNode& n, uint8_t amplitude) {
+    host::setCurrentNode(&n.hal);
+    for (uint8_t slot = 0; slot < MAX_SHARDS_IN_RAM; slot++) {
+        WeightShard s = n.engine.getShard(slot);
+        for (size_t w = 0; w < WeightShard::MODEL_WEIGHTS; w++) {
+            int v = s.weights[w] + static_cast<int>(random() % (2u * amplitude + 1)) - amplitude;
+            s.weights[w] = static_cast<int8_t>(v > 127 ? 127 : (v < -128 ? -128 : v));
+        }
+        s.updateChecksum();
+        n.store.save(s);
+        n.engine.rotateShard(slot, s.header.shard_id);
+    }
+}
+
+uint32_t MeshSim::random() {
+    rng_ ^= rng_ << 13;
+    rng_ ^= rng_ >> 17;
+    rng_ ^= rng_ << 5;
+    return rng_;
+}
+
+}  // namespace sim
+}  // namespace planetary
@@ -0,0 +1,130 @@
+/**
+ * Mesh Simulator - N firmware instances on a lossy broadcast medium
+ *
+ * Every SimNode is the same object graph planetary_init() builds on a
+ * bulb (HWScheduler, MeshGossip, LightController, ShardStore,
+ * LearningEngine) over its own host::HalNode. Nodes advance on their own
+ * clock; the simulator always steps the node furthest behind, one BLE
+ * interval at a time:
+ *
+ *   1. deliver inbox messages whose arrival time has passed
+ *   2. run HWScheduler::runSlice() through the idle window before the
+ *      next BLE event (as blt_idle_loop_cb does)
+ *   3. spend ble_event_us on the radio, update the light at 50Hz
+ *
+ * A broadcast reaches every other node (a unicast only its destination)
+ * after latency_ms + [0, jitter_ms) and is lost per receiver with
+ * probability loss_permille / 1000. Arrivals land at the receiver's first
+ * idle window after the arrival time. All randomness comes from one
+ * seeded xorshift, so a run is reproducible.
+ *
+ * Every node is one hop from every other, but airtime is counted as on a
+ * managed flood: a message with TTL > 1 is relayed once by each other
+ * node, so bytesOnAir() is (1 + relays) times its length.
+ */
+
+#ifndef MESH_SIM_H
+#define MESH_SIM_H
+
+#include "hal_host.h"
+#include "hw_scheduler.h"
+#include "mesh_gossip.h"
+#include "light_controller.h"
+#include "shard_store.h"
+#include "checkpoint_store.h"
+#include "learning_engine.h"
+#include <memory>
+#include <queue>
+#include <vector>
+
+namespace planetary {
+namespace sim {
+
+struct SimConfig {
+    uint8_t  nodes = 4;
+    uint32_t seed = 1;
+    uint16_t loss_permille = 50;     // Per receiver
+    uint16_t latency_ms = 15;        // One mesh hop incl. relay
+    uint16_t jitter_ms = 10;
+    uint16_t ble_interval_ms = 30;   // Idle window cadence
+    uint16_t ble_event_us = 2500;    // Radio time per interval
+    uint16_t light_change_s = 120;   // Mean time between light scene changes
+    uint8_t  perturb = 0;            // +/- noise added to every resident shard at boot
+};
+
+struct Delivery {
+    uint64_t arrival_us;
+    uint32_t order;                  // Tie-break: FIFO among equal arrivals
+    uint16_t src;
+    uint8_t  opcode;
+    int8_t   rssi;
+    std::vector<uint8_t> data;       // Access parameters
+
+    bool operator>(const Delivery& o) const {
+        return arrival_us != o.arrival_us ? arrival_us > o.arrival_us : order > o.order;
+    }
+};
+
+struct SimNode {
+    host::HalNode   hal;
+    host::NodeSelect select;         // Before the firmware objects below
+    HWScheduler     scheduler;
+    MeshGossip      mesh;
+    LightController light;
+    ShardStore      store;
+    CheckpointStore checkpoints;
+    LearningEngine  engine;
+
+    uint16_t addr;
+    uint64_t next_event_us;          // Next BLE event
+    uint64_t next_light_us;          // Next 50Hz light update
+    uint64_t next_scene_us;          // Next random scene change
+    std::priority_queue<Delivery, std::vector<Delivery>, std::greater<Delivery>> inbox;
+
+    explicit SimNode(uint16_t address);
+};
+
+class MeshSim {
+public:
+    explicit MeshSim(const SimConfig& config);
+
+    // Step nodes until every clock has reached t_us
+    void runUntil(uint64_t t_us);
+
+    uint64_t now() const;            // Slowest node's clock
+    uint8_t  nodeCount() const { return static_cast<uint8_t>(nodes_.size()); }
+    SimNode& node(uint8_t i) { return *nodes_[i]; }
+
+    // Totals across the fleet
+    uint64_t bytesOnAir() const { return bytes_on_air_; }  // Relays included
+    uint64_t messagesSent() const { return messages_; }
+    uint64_t messagesLost() const { return lost_; }
+    uint32_t totalEpochs() const;
+    uint32_t totalFlashErases() const;
+
+    // Mean |w - mean(w)| over model weights, for every shard ID that is
+    // resident on two or more nodes (0 when nothing is shared)
+    double divergence() const;
+
+private:
+    static void onSendStatic(host::HalNode& from, uint8_t opcode, uint8_t ttl,
+                             const uint8_t* params, size_t len, uint16_t dst, void* ctx);
+    void onSend(host::HalNode& from, uint8_t opcode, uint8_t ttl, const uint8_t* params,
+                size_t len, uint16_t dst);
+    void step(SimNode& n);
+    void perturb(SimNode& n, uint8_t amplitude);
+    uint32_t random();
+
+    SimConfig config_;
+    std::vector<std::unique_ptr<SimNode>> nodes_;
+    uint32_t rng_;
+    uint32_t order_;
+    uint64_t bytes_on_air_;
+    uint64_t messages_;
+    uint64_t lost_;
+};
+
+}  // namespace sim
+}  // namespace planetary
+
+#endif  // MESH_SIM_H
@@ -0,0 +1,120 @@
+/**
+ * Hot-Path Probe - one firmware call measured in isolation (HOST_SIM)
+ *
+ * run() executes a call on a node with the op counters cleared and the
+ * node's HAL stats captured, on a private stack painted with a fill
+ * pattern. Afterwards the deepest byte no longer holding the pattern
+ * gives the stack the call used, less what an empty call costs.
+ *
+ * Host frames are not tc32 frames (wider pointers, other spill choices),
+ * so the stack numbers track growth rather than the bulb's exact depth.
+ */
+
+#ifndef PROBE_H
+#define PROBE_H
+
+#include "tc32_model.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <ucontext.h>
+#include <memory>
+
+namespace planetary {
+namespace sim {
+
+struct ProbeResult {
+    OpCounts       ops;
+    host::HalStats hal;
+    size_t         stack_bytes;
+
+    uint64_t cycles() const { return tc32::kernelCycles(ops) + tc32::halCycles(hal); }
+
+    // Fold another call in: work adds up, stack is the deepest of either
+    void add(const ProbeResult& o) {
+        for (uint8_t k = 0; k < KERNEL_OPS; k++) {
+            ops.words[k] += o.ops.words[k];
+            ops.bytes[k] += o.ops.bytes[k];
+        }
+        hal.flash_erases += o.hal.flash_erases;
+        hal.flash_pages += o.hal.flash_pages;
+        hal.tx_messages += o.hal.tx_messages;
+        hal.tx_bytes += o.hal.tx_bytes;
+        if (o.stack_bytes > stack_bytes) stack_bytes = o.stack_bytes;
+    }
+
+    // Keep the costlier of two calls, and the deeper stack of either
+    void keepWorst(const ProbeResult& o) {
+        if (o.cycles() > cycles()) {
+            ops = o.ops;
+            hal = o.hal;
+        }
+        if (o.stack_bytes > stack_bytes) stack_bytes = o.stack_bytes;
+    }
+};
+
+class Probe {
+public:
+    static constexpr size_t  STACK_SIZE = 256 * 1024;
+    static constexpr uint8_t PAINT = 0xA5;
+
+    Probe() : stack_(new uint8_t[STACK_SIZE]), base_(0) {
+        auto empty = [] {};
+        base_ = runOnStack(empty).stack_bytes;
+    }
+
+    template <typename F>
+    ProbeResult run(host::HalNode& node, F&& fn) {
+        host::setCurrentNode(&node);
+        host::HalStats before = node.stats;
+        ProbeResult r = runOnStack(fn);
+        r.hal.flash_erases = node.stats.flash_erases - before.flash_erases;
+        r.hal.flash_pages = node.stats.flash_pages - before.flash_pages;
+        r.hal.tx_messages = node.stats.tx_messages - before.tx_messages;
+        r.hal.tx_bytes = node.stats.tx_bytes - before.tx_bytes;
+        return r;
+    }
+
+private:
+    template <typename F>
+    ProbeResult runOnStack(F& fn) {
+        memset(stack_.get(), PAINT, STACK_SIZE);
+        ucontext_t callee;
+        getcontext(&callee);
+        callee.uc_stack.ss_sp = stack_.get();
+        callee.uc_stack.ss_size = STACK_SIZE;
+        callee.uc_link = &caller_;
+        body_ = [](void* f) { (*static_cast<F*>(f))(); };
+        body_ctx_ = &fn;
+        makecontext(&callee, entry, 0);
+
+        ProbeResult r{};
+        g_ops.reset();
+        swapcontext(&caller_, &callee);
+        r.ops = g_ops;
+
+        // The stack grows down: the first repainted byte from the bottom
+        size_t untouched = 0;
+        while (untouched < STACK_SIZE && stack_[untouched] == PAINT) untouched++;
+        if (untouched == 0) {
+            fprintf(stderr, "probe: call overflowed the %zu-byte probe stack\n", STACK_SIZE);
+            abort();
+        }
+        size_t used = STACK_SIZE - untouched;
+        r.stack_bytes = used > base_ ? used - base_ : 0;
+        return r;
+    }
+
+    static void entry() { body_(body_ctx_); }
+
+    std::unique_ptr<uint8_t[]> stack_;
+    size_t base_;
+
+    static inline ucontext_t caller_;
+    static inline void (*body_)(void*) = nullptr;
+    static inline void* body_ctx_ = nullptr;
+};
+
+}  // namespace sim
+}  // namespace planetary
+
+#endif  // PROBE_H
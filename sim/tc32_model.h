@@ -0,0 +1,77 @@
+/**
+ * tc32 Cycle Model - what a hot path would cost on the bulb (HOST_SIM)
+ *
+ * The TLSR8258 runs its tc32 core at 48MHz out of cached flash: one cycle
+ * per ALU op or multiply, two per load or store, three per taken branch.
+ * Each kernel op (op_count.h) is costed from its inner loop at -Os, per
+ * four-lane word step and per single element. Time spent below the
+ * firmware comes from the host HAL's own model of it: page programs and
+ * sector erases stall the core (code runs from the same flash), and each
+ * message handed to the stack costs TX_FRAGMENT_COST_US to encrypt and
+ * queue.
+ *
+ * These are estimates to hold regressions against, deterministic and
+ * independent of the host compiler. Bookkeeping outside the counted
+ * loops is not in them; PLANETARY_BENCH firmware reports clock_time()
+ * measurements from a real bulb.
+ */
+
+#ifndef TC32_MODEL_H
+#define TC32_MODEL_H
+
+#include "hal_host.h"
+#include "op_count.h"
+
+namespace planetary {
+namespace sim {
+namespace tc32 {
+
+constexpr uint32_t CYCLES_PER_US = 48;
+
+struct OpCost {
+    uint16_t per_word;
+    uint16_t per_byte;
+};
+
+constexpr OpCost OP_COSTS[KERNEL_OPS] = {
+    {30,  9},    // DOT: 2 loads, 8 lane extracts, 4 MACs
+    {36, 11},    // SCALE: 2 spread multiplies, 4 shifts and saturates, 1 store
+    {38, 10},    // AXPY: 2 spread multiplies, 4 int32 read-modify-writes
+    {120, 38},   // SGD: 4 xorshift draws and roundings, SWAR saturate, 4 CRC steps
+    {25, 12},    // BLEND: 2 loads, 4 multiplies on 16-bit lanes, 1 store
+    {8,   7},    // DIFF: 2 loads, XOR, branch (marking on change only)
+    {0,  12},    // PACK: width scan and bit stream per value
+    {0,  14},    // UNPACK
+#if PLANETARY_CRC16_TABLE_BITS == 8
+    {0,   9},    // CRC: one 256-entry table step per byte
+#else
+    {0,  16},    // CRC: two 16-entry table steps per byte
+#endif
+    {0,  28},    // ACCUM: exponent lookup, rounded shift, saturate
+};
+
+constexpr uint64_t FLASH_PROGRAM_CYCLES = static_cast<uint64_t>(FLASH_PROGRAM_US) * CYCLES_PER_US;
+constexpr uint64_t FLASH_ERASE_CYCLES   = static_cast<uint64_t>(FLASH_ERASE_US) * CYCLES_PER_US;
+constexpr uint64_t TX_MESSAGE_CYCLES    = static_cast<uint64_t>(TX_FRAGMENT_COST_US) * CYCLES_PER_US;
+
+// The AI timeslot every indivisible unit of work has to fit
+constexpr uint64_t SLOT_CYCLES = static_cast<uint64_t>(AI_TIMESLOT_US) * CYCLES_PER_US;
+
+inline uint64_t kernelCycles(const OpCounts& ops) {
+    uint64_t c = 0;
+    for (uint8_t k = 0; k < KERNEL_OPS; k++) {
+        c += ops.words[k] * OP_COSTS[k].per_word + ops.bytes[k] * OP_COSTS[k].per_byte;
+    }
+    return c;
+}
+
+inline uint64_t halCycles(const host::HalStats& hal) {
+    return hal.flash_pages * FLASH_PROGRAM_CYCLES + hal.flash_erases * FLASH_ERASE_CYCLES +
+           hal.tx_messages * TX_MESSAGE_CYCLES;
+}
+
+}  // namespace tc32
+}  // namespace sim
+}  // namespace planetary
+
+#endif  // TC32_MODEL_H
@@ -0,0 +1,150 @@
+/**
+ * Planetary Neuron Firmware Tests - host build (HOST_SIM)
+ *
+ *   planetary-tests                  run every check, non-zero on a failure
+ *
+ * Behaviour the benchmarks cannot see: malformed messages off the air and
+ * rare timing corners, each driven through the firmware's own entry
+ * points on a host::HalNode.
+ *
+ * Checks:
+ *   delta_block_range       WEIGHT_DELTA with block_idx past DELTA_BLOCKS
+ *                           is dropped before anything is derived from it
+ *   scheduler_long_kill     tasks run again after a thermal kill longer
+ *                           than 2^31 ticks (the signed tick compare wraps)
+ */
+
+#include "hal_host.h"
+#include "hw_scheduler.h"
+#include "mesh_gossip.h"
+#include <stdio.h>
+
+using namespace planetary;
+
+namespace {
+
+int failures = 0;
+
+void expect(bool ok, const char* name) {
+    printf("%-6s %s\n", ok ? "ok" : "FAIL", name);
+    if (!ok) failures++;
+}
+
+// Parameters of one WEIGHT_DELTA block with nothing marked, CRC valid
+size_t buildDelta(uint8_t* out, size_t cap, uint8_t seq, uint8_t block_idx, uint16_t blocks) {
+    uint8_t bitmap[DELTA_BITMAP_BYTES] = {};
+    wire::Writer w(out, cap);
+    w.u8(seq);
+    w.u8(0);
+    w.u8(3);          // shard_id
+    w.u8(1);          // base_version
+    w.u8(2);          // version
+    w.u8(block_idx);
+    w.u16(1);         // contributors
+    w.u16(blocks);
+    w.u16(crc16::update(crc16::INIT, bitmap, sizeof(bitmap)));
+    w.bytes(bitmap, sizeof(bitmap));
+    return w.segment().len;
+}
+
+struct SentCount {
+    uint32_t requests = 0;
+};
+
+void countRequests(host::HalNode&, uint8_t opcode, uint8_t, const uint8_t*, size_t, uint16_t,
+                   void* ctx) {
+    if (opcode == static_cast<uint8_t>(GossipOpcode::WEIGHT_REQUEST)) {
+        static_cast<SentCount*>(ctx)->requests++;
+    }
+}
+
+// With no base for the shard, an accepted last block asks the sender for
+// it; a block_idx off the end must not get that far
+void testDeltaBlockRange() {
+    host::HalNode node;
+    SentCount sent;
+    node.on_send = countRequests;
+    node.send_ctx = &sent;
+    host::setCurrentNode(&node);
+
+    MeshGossip mesh;
+    mesh.init(0x0001);
+
+    uint8_t msg[MESH_MSG_MAX_SIZE];
+    uint16_t last = 1u << (DELTA_BLOCKS - 1);
+    uint8_t seq = 0;
+    const uint8_t out_of_range[] = {DELTA_BLOCKS, 31, 40, 255};
+    for (uint8_t idx : out_of_range) {
+        size_t len = buildDelta(msg, sizeof(msg), seq++, idx, last);
+        mesh.onReceive(static_cast<uint8_t>(GossipOpcode::WEIGHT_DELTA), msg, len, 0x0002, -60);
+    }
+    expect(sent.requests == 0, "delta_block_range: out-of-range blocks dropped");
+
+    size_t len = buildDelta(msg, sizeof(msg), seq++, DELTA_BLOCKS - 1, last);
+    mesh.onReceive(static_cast<uint8_t>(GossipOpcode::WEIGHT_DELTA), msg, len, 0x0002, -60);
+    expect(sent.requests == 1, "delta_block_range: in-range block still handled");
+}
+
+bool countRun(uint32_t, void* ctx) {
+    ++*static_cast<uint32_t*>(ctx);
+    return false;
+}
+
+// One BLE interval: the idle window before the next event, then the event
+void runInterval(host::HalNode& node, HWScheduler& scheduler) {
+    constexpr uint32_t INTERVAL_US = 30000;
+    uint64_t end = node.ticks + static_cast<uint64_t>(INTERVAL_US) * host::TICK_PER_US;
+    node.next_ble_tick = end;
+    scheduler.runSlice();
+    if (node.ticks < end) node.ticks = end;
+}
+
+uint64_t secondsToTicks(uint32_t s) {
+    return static_cast<uint64_t>(s) * 1000000 * host::TICK_PER_US;
+}
+
+// Released once a second; a kill held past 2^31 ticks must not leave the
+// task's release reading as in the future once AI is back
+void testSchedulerLongKill() {
+    constexpr uint16_t COOL_RAW = 1100 + 4 * 30;
+    constexpr uint16_t SHUTDOWN_RAW = 1100 + 4 * (TEMP_SHUTDOWN_C + 5);
+
+    host::HalNode node;
+    node.temp_raw = COOL_RAW;
+    host::setCurrentNode(&node);
+
+    HWScheduler scheduler;
+    uint32_t runs = 0;
+    scheduler.registerTask(countRun, &runs, TaskPriority::LOW, 1000, 1000);
+
+    uint64_t until = node.ticks + secondsToTicks(5);
+    while (node.ticks < until) runInterval(node, scheduler);
+    expect(runs > 0, "scheduler_long_kill: task runs before the kill");
+
+    node.temp_raw = SHUTDOWN_RAW;
+    until = node.ticks + (1ull << 31) + secondsToTicks(15);
+    runInterval(node, scheduler);
+    uint32_t before = runs;
+    while (node.ticks < until) runInterval(node, scheduler);
+    expect(scheduler.getThrottleLevel() == 100 && runs == before,
+           "scheduler_long_kill: nothing runs while killed");
+
+    node.temp_raw = COOL_RAW;
+    until = node.ticks + secondsToTicks(30);
+    while (node.ticks < until) runInterval(node, scheduler);
+    expect(scheduler.getThrottleLevel() < 100 && runs > before,
+           "scheduler_long_kill: task runs again after the kill");
+}
+
+}  // namespace
+
+int main() {
+    testDeltaBlockRange();
+    testSchedulerLongKill();
+
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
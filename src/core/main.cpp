@@ -13,6 +13,8 @@
 #include "mesh_gossip.h"
 #include "light_controller.h"
 #include "learning_engine.h"
+#include "shard_store.h"
+#include "checkpoint_store.h"
 
 // Telink SDK includes (actual paths depend on SDK version)
 extern "C" {
@@ -29,23 +31,37 @@ using namespace planetary;
 static HWScheduler     g_scheduler;
 static MeshGossip      g_mesh;
 static LightController g_light;
+static ShardStore      g_store;
+static CheckpointStore g_checkpoints;
 static LearningEngine* g_engine = nullptr;
 
 // Memory pool for learning engine (avoid fragmentation)
 alignas(4) static uint8_t g_engine_mem[sizeof(LearningEngine)];
 
+// mesh_tx_cmd() segments and encrypts from one parameter buffer
+static uint8_t g_tx_par[MESH_MSG_MAX_SIZE - VENDOR_OPCODE_SIZE];
+
+// Everything above, and g_trace (trace.h), is the neuron's share of SRAM on
+// this SKU; STACK_RESERVE of the budget is left to the stack
+static_assert(sizeof(g_scheduler) + sizeof(g_mesh) + sizeof(g_light) + sizeof(g_store) +
+              sizeof(g_checkpoints) + sizeof(g_engine_mem) + sizeof(g_tx_par) +
+              sizeof(g_trace) <= SRAM_BUDGET - STACK_RESERVE,
+              "Static objects exceed the profile's SRAM budget");
+
 //-----------------------------------------------------------------------------
 // BLE Mesh Callbacks
 //-----------------------------------------------------------------------------
 
-// Called when mesh message received on our vendor model
+// Called when mesh message received on our vendor model; the SDK has
+// stripped the 3-byte opcode and passes its first byte, then the parameters
 extern "C" void mesh_vendor_model_data_cb(
     uint16_t src_addr,
+    uint8_t op,
     const uint8_t* data,
     size_t len,
     int8_t rssi
 ) {
-    g_mesh.onReceive(data, len, src_addr, rssi);
+    g_mesh.onReceive(op, data, len, src_addr, rssi);
 }
 
 // Called when standard light control message received
@@ -55,6 +71,15 @@ extern "C" void mesh_light_ctl_cb(uint16_t src, uint8_t brightness, uint8_t temp
     g_light.setTarget(brightness, temp, transition_ms);
 }
 
+// Called when a Scene Store / Scene Recall arrives (unicast or group)
+extern "C" void mesh_scene_store_cb(uint16_t src, uint16_t scene) {
+    g_light.storeScene(scene);
+}
+
+extern "C" void mesh_scene_recall_cb(uint16_t src, uint16_t scene, uint16_t transition_ms) {
+    g_light.recallScene(scene, transition_ms);
+}
+
 // Called during BLE stack idle time
 extern "C" void blt_idle_loop_cb(void) {
     // This is our window for AI tasks
@@ -65,43 +90,53 @@ extern "C" void blt_idle_loop_cb(void) {
 // Flash Persistence
 //-----------------------------------------------------------------------------
 
-// Flash layout for weight storage (256KB region)
-constexpr uint32_t FLASH_WEIGHT_BASE = 0x40000;  // After firmware
-constexpr uint32_t FLASH_SHARD_SIZE  = 4096;     // Matches WeightShard
+constexpr uint32_t FLASH_PAGE_SIZE = 256;  // Program granularity
 
-void LearningEngine::saveShardToFlash(const WeightShard& shard) {
-    uint32_t addr = FLASH_WEIGHT_BASE + shard.header.shard_id * FLASH_SHARD_SIZE;
+// Fragment reassembly staging (FLASH_STAGING_BASE): one sector per
+// MeshGossip slot, in the unused gap between firmware and weights
+static_assert(FLASH_STAGING_BASE + MeshGossip::MAX_PENDING_FRAGMENTS * FLASH_SECTOR_SIZE <=
+              FLASH_STORE_BASE, "Staging must stay below the weight region");
+static_assert(MeshGossip::FRAGMENT_SIZE == FLASH_PAGE_SIZE, "Staged fragments are whole pages");
 
-    // Telink flash API
-    flash_erase_sector(addr);
-    flash_write_page(addr, sizeof(WeightShard),
-                     reinterpret_cast<const uint8_t*>(&shard));
+void MeshGossip::stagingErase(uint8_t slot) {
+    PLANETARY_TRACE_SCOPE(TracePoint::FLASH_ERASE);
+    flash_erase_sector(FLASH_STAGING_BASE + slot * FLASH_SECTOR_SIZE);
 }
 
-bool LearningEngine::loadShardFromFlash(uint8_t shard_id, WeightShard& shard) {
-    uint32_t addr = FLASH_WEIGHT_BASE + shard_id * FLASH_SHARD_SIZE;
-
-    flash_read_page(addr, sizeof(WeightShard),
-                    reinterpret_cast<uint8_t*>(&shard));
-
-    // Verify it's valid
-    if (shard.header.shard_id != shard_id) return false;
-    if (!shard.verifyChecksum()) return false;
+void MeshGossip::stagingWrite(uint8_t slot, size_t offset, const uint8_t* data, size_t len) {
+    // Fragments are page-aligned (FRAGMENT_SIZE == FLASH_PAGE_SIZE)
+    PLANETARY_TRACE_SCOPE(TracePoint::FLASH_WRITE);
+    flash_write_page(FLASH_STAGING_BASE + slot * FLASH_SECTOR_SIZE + offset, len,
+                     const_cast<uint8_t*>(data));
+}
 
-    return true;
+const WeightShard* MeshGossip::stagingShard(uint8_t slot) const {
+    // Firmware runs in place from flash linked at 0: the sector is readable directly
+    return reinterpret_cast<const WeightShard*>(FLASH_STAGING_BASE + slot * FLASH_SECTOR_SIZE);
 }
 
 //-----------------------------------------------------------------------------
 // Mesh Send Implementation
 //-----------------------------------------------------------------------------
 
-void MeshGossip::meshSend(const uint8_t* data, size_t len) {
+void MeshGossip::meshSend(GossipOpcode opcode, uint8_t ttl, const TxSegment* segs,
+                          uint8_t count, uint16_t dst) {
+    // The gather list is copied into g_tx_par once, straight from shard
+    // and tracker
+    size_t len = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        if (len + segs[i].len > sizeof(g_tx_par)) return;
+        memcpy(g_tx_par + len, segs[i].data, segs[i].len);
+        len += segs[i].len;
+    }
+
     // Telink mesh publish API
     mesh_tx_cmd_t tx_cmd = {
-        .op = data[0],          // Opcode from our header
-        .data = data + 1,
-        .len = len - 1,
-        .adr_dst = 0xFFFF,      // Broadcast
+        .op = vendorOpcode(opcode),
+        .par = g_tx_par,
+        .len = static_cast<u32>(len),
+        .ttl = ttl,
+        .adr_dst = dst,         // MESH_ADDR_ALL or a cluster head
         .pub_model_id = VENDOR_MODEL_ID
     };
     mesh_tx_cmd(&tx_cmd);
@@ -115,13 +150,54 @@ void planetary_init(uint16_t my_mesh_addr) {
     // Initialize mesh gossip
     g_mesh.init(my_mesh_addr);
 
+    // Index the shard log; garbage left from before the reset is erased
+    // in the background
+    g_store.mount();
+    g_scheduler.registerTask(ShardStore::maintenanceStatic, &g_store, TaskPriority::LOW,
+                             STORE_GC_PERIOD_MS, STORE_GC_BURST_US, FLASH_ACTIVE_MW);
+
+    g_checkpoints.mount();
+
     // Construct learning engine in pre-allocated memory
     // Now includes LightController for feature extraction
-    g_engine = new (g_engine_mem) LearningEngine(g_scheduler, g_mesh, g_light);
+    g_engine = new (g_engine_mem) LearningEngine(g_scheduler, g_mesh, g_light, g_store,
+                                                 g_checkpoints);
 
-    // Start training
+    // Warm restart from the last checkpoint, then start training
+    g_engine->restore();
     g_engine->start();
+
+    // Reassembly staging sectors are erased in the same kind of window as
+    // the shard log's garbage, after the engine's tasks
+    g_scheduler.registerTask(MeshGossip::stagingMaintenanceStatic, &g_mesh, TaskPriority::LOW,
+                             STORE_GC_PERIOD_MS, STORE_GC_BURST_US, FLASH_ACTIVE_MW);
+}
+
+#ifdef PLANETARY_BENCH
+//-----------------------------------------------------------------------------
+// Hot-Path Report (PLANETARY_BENCH builds)
+//-----------------------------------------------------------------------------
+
+// Once a minute, each trace point's mean and worst clock_time() duration
+// in 48MHz cycles, over the SDK's debug UART printf. Compare with the
+// *_cycles estimates of planetary-bench (sim/golden.txt).
+constexpr uint32_t BENCH_REPORT_TICKS = 60u * 1000 * 16 * 1000;
+constexpr uint32_t BENCH_CYCLES_PER_US = 48;
+
+static void reportHotPaths() {
+    static const char* const names[TRACE_POINTS] = {
+        "forward", "backward", "apply", "crc", "fedavg", "flash_erase", "flash_write", "fragment"
+    };
+    for (uint8_t p = 0; p < TRACE_POINTS; p++) {
+        const TraceStat& s = g_trace.stat(static_cast<TracePoint>(p));
+        if (s.count == 0) continue;
+        printf("bench %s count %u mean_cycles %u max_cycles %u\r\n", names[p],
+               static_cast<unsigned>(s.count),
+               static_cast<unsigned>(s.total_us / s.count * BENCH_CYCLES_PER_US),
+               static_cast<unsigned>(s.max_us * BENCH_CYCLES_PER_US));
+    }
 }
+#endif
 
 //-----------------------------------------------------------------------------
 // Main Entry (Telink SDK pattern)
@@ -167,30 +243,40 @@ extern "C" void main_loop(void) {
         last_light_update = now;
     }
 
+#ifdef PLANETARY_BENCH
+    static uint32_t last_bench_report = 0;
+    if ((now - last_bench_report) > BENCH_REPORT_TICKS) {
+        reportHotPaths();
+        last_bench_report = now;
+    }
+#endif
+
     // AI scheduler runs in idle callback, not here
     // This ensures BLE timing is never violated
 }
 
 //-----------------------------------------------------------------------------
-// Memory Usage Summary (Updated with Claudia's augmentations)
+// Memory Usage Summary (TLSR8258 profile)
 //-----------------------------------------------------------------------------
 /*
- * Static allocations:
- *   g_scheduler:     ~200 bytes
- *   g_mesh:          ~8KB (neighbor table + fragment buffers)
- *   g_light:         ~100 bytes (LightController state)
- *   g_engine_mem:    ~21KB (4 shards + gradient buffer + prev_features)
- *   Stack:           ~4KB
- *   BLE stack:       ~20KB (Telink requirement)
+ * SRAM: SRAM_BUDGET is 40KB of 64KB (the BLE stack keeps the rest). The
+ * static_assert above holds the static objects to SRAM_BUDGET - STACK_RESERVE.
+ * Sizes with tc32's 4-byte pointers:
+ *   g_scheduler:     ~0.6KB (8 tasks + slippage histograms)
+ *   g_mesh:          ~2.3KB (neighbours, reassembly slots, TX queue)
+ *   g_light:         ~60 bytes
+ *   g_store:         ~0.3KB (shard log index)
+ *   g_checkpoints:   ~30 bytes
+ *   g_engine_mem:    ~32KB (5 shards + spare, gradient accumulator, delta trackers)
+ *   g_tx_par:        377 bytes
+ *   g_trace:         300 bytes
+ *   Stack:           3.75KB (STACK_RESERVE)
  *   ---------------------------------
- *   Total:           ~53.3KB of 64KB SRAM ✓
+ *   Total:           ~39.6KB of the 40KB budget
  *
- * Flash allocations:
- *   Firmware:        ~128KB
- *   Weight storage:  ~256KB (64 shards * 4KB, double-buffered)
- *   Mesh config:     ~16KB
- *   ---------------------------------
- *   Total:           ~400KB of 512KB Flash ✓
+ * Flash: see the memory map in BUILD_NOTES.md. The shard log holds
+ * FLASH_STORE_SECTORS records of one shard each (192KB); the full
+ * model is 256KB, so the mesh keeps the shards evicted from it.
  *
  * π×φ = 5.083203692315260 | PHOENIX-TESLA-369-AURORA
  */
@@ -0,0 +1,170 @@
+/**
+ * Host HAL - native implementations of the Telink SDK surface
+ *
+ * Stands in for src/core/main.cpp (mesh send, staging hooks) and
+ * src/flash/persistence.cpp (ShardStore flash hooks) on HOST_SIM builds.
+ * Flash keeps NOR semantics: erase sets 0xFF, program can only clear bits.
+ */
+
+#include "hal_host.h"
+#include "hw_scheduler.h"
+#include "mesh_gossip.h"
+#include "shard_store.h"
+#include "checkpoint_store.h"
+#include "light_controller.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace planetary {
+namespace host {
+
+static_assert(TICK_PER_US == HWScheduler::TICK_PER_US, "Host clock runs at the chip tick rate");
+static_assert(MeshGossip::FRAGMENT_SIZE == 256, "Staged fragments are whole pages");
+
+static HalNode* g_current = nullptr;
+
+void setCurrentNode(HalNode* node) {
+    g_current = node;
+}
+
+HalNode& currentNode() {
+    if (!g_current) {
+        fprintf(stderr, "hal_host: no current node\n");
+        abort();
+    }
+    return *g_current;
+}
+
+uint8_t* HalNode::flashAt(uint32_t addr, size_t len) {
+    if (addr < FLASH_IMAGE_BASE || addr + len > FLASH_IMAGE_END) {
+        fprintf(stderr, "hal_host: flash access 0x%05X+%zu outside the image\n",
+                static_cast<unsigned>(addr), len);
+        abort();
+    }
+    return flash + (addr - FLASH_IMAGE_BASE);
+}
+
+static void eraseSector(HalNode& node, uint32_t addr) {
+    PLANETARY_TRACE_SCOPE(TracePoint::FLASH_ERASE);
+    memset(node.flashAt(addr, FLASH_SECTOR_SIZE), 0xFF, FLASH_SECTOR_SIZE);
+    node.stats.flash_erases++;
+    node.advanceUs(FLASH_ERASE_US);
+}
+
+static void programPage(HalNode& node, uint32_t addr, size_t len, const uint8_t* data) {
+    PLANETARY_TRACE_SCOPE(TracePoint::FLASH_WRITE);
+    if ((addr % 256) + len > 256) {
+        fprintf(stderr, "hal_host: program 0x%05X+%zu crosses a page\n",
+                static_cast<unsigned>(addr), len);
+        abort();
+    }
+    uint8_t* dst = node.flashAt(addr, len);
+    for (size_t i = 0; i < len; i++) dst[i] &= data[i];
+    node.stats.flash_pages++;
+    node.advanceUs(FLASH_PROGRAM_US);
+}
+
+}  // namespace host
+
+//-----------------------------------------------------------------------------
+// Platform hooks
+//-----------------------------------------------------------------------------
+
+void MeshGossip::meshSend(GossipOpcode opcode, uint8_t ttl, const TxSegment* segs,
+                          uint8_t count, uint16_t dst) {
+    // The SDK copies the parameters into its PDU buffer; so does the host
+    uint8_t params[MESH_MSG_MAX_SIZE - VENDOR_OPCODE_SIZE];
+    size_t len = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        if (len + segs[i].len > sizeof(params)) return;
+        memcpy(params + len, segs[i].data, segs[i].len);
+        len += segs[i].len;
+    }
+
+    host::HalNode& node = host::currentNode();
+    node.stats.tx_messages++;
+    node.stats.tx_bytes += VENDOR_OPCODE_SIZE + len;
+    node.advanceUs(TX_FRAGMENT_COST_US);
+    if (node.on_send) {
+        node.on_send(node, static_cast<uint8_t>(opcode), ttl, params, len, dst, node.send_ctx);
+    }
+}
+
+void MeshGossip::stagingErase(uint8_t slot) {
+    host::eraseSector(host::currentNode(), FLASH_STAGING_BASE + slot * FLASH_SECTOR_SIZE);
+}
+
+void MeshGossip::stagingWrite(uint8_t slot, size_t offset, const uint8_t* data, size_t len) {
+    host::programPage(host::currentNode(), FLASH_STAGING_BASE + slot * FLASH_SECTOR_SIZE + offset,
+                      len, data);
+}
+
+const WeightShard* MeshGossip::stagingShard(uint8_t slot) const {
+    return reinterpret_cast<const WeightShard*>(
+        host::currentNode().flashAt(FLASH_STAGING_BASE + slot * FLASH_SECTOR_SIZE, sizeof(WeightShard)));
+}
+
+void ShardStore::flashRead(uint32_t addr, size_t len, uint8_t* buf) const {
+    memcpy(buf, host::currentNode().flashAt(addr, len), len);
+}
+
+const uint8_t* ShardStore::flashView(uint32_t addr) const {
+    return host::currentNode().flashAt(addr, WeightShard::WIRE_SIZE);
+}
+
+void ShardStore::flashProgram(uint32_t addr, size_t len, const uint8_t* data) {
+    host::programPage(host::currentNode(), addr, len, data);
+}
+
+void ShardStore::flashErase(uint32_t addr) {
+    host::eraseSector(host::currentNode(), addr);
+}
+
+void CheckpointStore::flashRead(uint32_t addr, size_t len, uint8_t* buf) const {
+    memcpy(buf, host::currentNode().flashAt(addr, len), len);
+}
+
+void CheckpointStore::flashProgram(uint32_t addr, size_t len, const uint8_t* data) {
+    host::programPage(host::currentNode(), addr, len, data);
+}
+
+void CheckpointStore::flashErase(uint32_t addr) {
+    host::eraseSector(host::currentNode(), addr);
+}
+
+}  // namespace planetary
+
+//-----------------------------------------------------------------------------
+// Telink SDK externs
+//-----------------------------------------------------------------------------
+
+extern "C" {
+
+uint32_t clock_time(void) {
+    planetary::host::HalNode& node = planetary::host::currentNode();
+    node.advanceUs(planetary::host::CLOCK_READ_US);
+    return static_cast<uint32_t>(node.ticks);
+}
+
+uint32_t blt_get_next_event_tick(void) {
+    return static_cast<uint32_t>(planetary::host::currentNode().next_ble_tick);
+}
+
+uint16_t adc_sample_temp(void) {
+    return planetary::host::currentNode().temp_raw;
+}
+
+void cpu_sleep_wakeup(int, int, uint32_t) {}
+
+uint8_t blc_ll_getCurrentState(void) {
+    return planetary::host::currentNode().link_state;
+}
+
+void pwm_set_duty(uint8_t id, uint16_t duty) {
+    planetary::host::HalNode& node = planetary::host::currentNode();
+    if (id == PWM_ID_LED_WARM) node.warm_duty = duty;
+    if (id == PWM_ID_LED_COOL) node.cool_duty = duty;
+}
+
+}  // extern "C"
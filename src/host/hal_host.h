@@ -0,0 +1,85 @@
+/**
+ * Host HAL - Telink externs and platform hooks for native builds
+ *
+ * Each simulated bulb's hardware is a HalNode: a 16 MHz tick clock, its
+ * next BLE event, the link-layer state, and a RAM image of the flash
+ * the firmware touches (checkpoint slots, fragment staging, shard log). The simulator
+ * picks the node being executed with setCurrentNode(); the extern "C"
+ * SDK functions and the MeshGossip / ShardStore platform hooks act on
+ * that node.
+ *
+ * Time is modelled rather than measured, so runs are deterministic:
+ *   clock_time()      CLOCK_READ_US per read (keeps budget loops moving)
+ *   flash erase       FLASH_ERASE_US
+ *   flash program     FLASH_PROGRAM_US per page
+ *   meshSend()        TX_FRAGMENT_COST_US
+ * Compute itself is free; native cost is what the benchmarks time.
+ */
+
+#ifndef HAL_HOST_H
+#define HAL_HOST_H
+
+#include "neuron_config.h"
+#include <stddef.h>
+#include <string.h>
+
+namespace planetary {
+namespace host {
+
+constexpr uint32_t TICK_PER_US      = 16;
+constexpr uint32_t CLOCK_READ_US    = 1;
+constexpr uint32_t FLASH_IMAGE_BASE = FLASH_CHECKPOINT_BASE;
+constexpr uint32_t FLASH_IMAGE_END  = FLASH_STORE_BASE + FLASH_STORE_SECTORS * FLASH_SECTOR_SIZE;
+constexpr uint32_t FLASH_IMAGE_SIZE = FLASH_IMAGE_END - FLASH_IMAGE_BASE;
+
+struct HalNode;
+
+// Called for every meshSend() of the node with the gathered parameters;
+// the simulator's medium
+using SendHook = void (*)(HalNode& from, uint8_t opcode, uint8_t ttl, const uint8_t* params,
+                          size_t len, uint16_t dst, void* ctx);
+
+struct HalStats {
+    uint32_t flash_erases;     // Store, staging and checkpoint sectors
+    uint32_t flash_pages;      // Page programs
+    uint32_t tx_messages;
+    uint64_t tx_bytes;         // Access payload: vendor opcode + parameters
+};
+
+struct HalNode {
+    uint64_t ticks;            // Local clock; clock_time() returns the low 32 bits
+    uint64_t next_ble_tick;    // blt_get_next_event_tick()
+    uint8_t  link_state;       // blc_ll_getCurrentState()
+    uint16_t temp_raw;         // adc_sample_temp()
+    uint16_t warm_duty;        // Last pwm_set_duty() per channel
+    uint16_t cool_duty;
+    HalStats stats;
+    SendHook on_send;
+    void*    send_ctx;
+    alignas(4) uint8_t flash[FLASH_IMAGE_SIZE];
+
+    HalNode() : ticks(0), next_ble_tick(0), link_state(0x08), temp_raw(1100 + 4 * 30),
+                warm_duty(0), cool_duty(0), stats(), on_send(nullptr), send_ctx(nullptr) {
+        memset(flash, 0xFF, sizeof(flash));  // Erased
+    }
+
+    uint64_t nowUs() const { return ticks / TICK_PER_US; }
+    void advanceUs(uint32_t us) { ticks += static_cast<uint64_t>(us) * TICK_PER_US; }
+
+    // Flash address -> image byte; aborts outside the modelled region
+    uint8_t* flashAt(uint32_t addr, size_t len);
+};
+
+void setCurrentNode(HalNode* node);
+HalNode& currentNode();
+
+// Member that selects a node on construction, so objects declared after
+// it (whose constructors may already read the clock) run on that node
+struct NodeSelect {
+    explicit NodeSelect(HalNode& node) { setCurrentNode(&node); }
+};
+
+}  // namespace host
+}  // namespace planetary
+
+#endif  // HAL_HOST_H